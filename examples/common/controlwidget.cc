@@ -40,6 +40,10 @@ public:
             speedCbx->addItem(QString::number(i), i);
             i += step;
         }
+        // Trick play speeds
+        for (auto fast : {4.0, 8.0, 16.0, 32.0}) {
+            speedCbx->addItem(QString::number(fast), fast);
+        }
         speedCbx->setCurrentText("1");
 
         modelButton = new QPushButton(q_ptr);
@@ -156,6 +160,11 @@ QPoint ControlWidget::sliderGlobalPos() const
     return d_ptr->slider->mapToGlobal(d_ptr->slider->pos());
 }
 
+bool ControlWidget::isSliderDown() const
+{
+    return d_ptr->slider->isSliderDown();
+}
+
 void ControlWidget::setSourceFPS(float fps)
 {
     auto fpsStr = QString("FPS: %1").arg(QString::number(fps, 'f', 2));
@@ -274,6 +283,9 @@ void ControlWidget::onModelChanged()
 void ControlWidget::buildConnect()
 {
     connect(d_ptr->slider, &Slider::valueChanged, this, &ControlWidget::seek);
+    connect(d_ptr->slider, &Slider::sliderReleased, this, [this] {
+        emit seek(d_ptr->slider->value());
+    });
     connect(d_ptr->slider, &Slider::onHover, this, &ControlWidget::hoverPosition);
     connect(d_ptr->slider, &Slider::onLeave, this, &ControlWidget::leavePosition);
     connect(d_ptr->playButton, &QToolButton::clicked, this, &ControlWidget::play);
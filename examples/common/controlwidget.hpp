@@ -27,6 +27,7 @@ public:
     void setChapters(const Ffmpeg::Chapters &chapters);
 #endif
     [[nodiscard]] auto sliderGlobalPos() const -> QPoint;
+    [[nodiscard]] auto isSliderDown() const -> bool;
 
     void setSourceFPS(float fps);
     void setCurrentFPS(float fps);
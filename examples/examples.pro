@@ -3,6 +3,7 @@ CONFIG += ordered
 
 SUBDIRS += \
     ffmpegplayer \
+    ffmpegmultiplayer \
     ffmpegtranscoder
 
 win32 {
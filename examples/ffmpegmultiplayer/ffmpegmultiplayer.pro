@@ -0,0 +1,25 @@
+include(../../common.pri)
+
+QT       += core gui widgets network multimedia openglwidgets core5compat
+
+TEMPLATE = app
+
+TARGET = FfmpegMultiPlayer
+
+LIBS += \
+    -l$$replaceLibName(ffmpeg) \
+    -l$$replaceLibName(mediaconfig) \
+    -l$$replaceLibName(thirdparty) \
+    -l$$replaceLibName(dump) \
+    -l$$replaceLibName(utils)
+
+include(../../src/3rdparty/3rdparty.pri)
+
+SOURCES += \
+    main.cc \
+    mainwindow.cc
+
+HEADERS += \
+    mainwindow.hpp
+
+DESTDIR = $$APP_OUTPUT_PATH
@@ -0,0 +1,285 @@
+#include "mainwindow.hpp"
+
+#include <ffmpeg/event/propertychannel.hpp>
+#include <ffmpeg/event/valueevent.hpp>
+#include <ffmpeg/player.h>
+#include <ffmpeg/videorender/videorendercreate.hpp>
+
+#include <QtWidgets>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// User and system time of the whole process, microsecond
+auto processCpuTime() -> qint64
+{
+#ifdef Q_OS_WIN
+    FILETIME creationTime;
+    FILETIME exitTime;
+    FILETIME kernelTime;
+    FILETIME userTime;
+    if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)
+        == 0) {
+        return 0;
+    }
+    auto toUSecs = [](const FILETIME &time) {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return static_cast<qint64>(value.QuadPart / 10);
+    };
+    return toUSecs(kernelTime) + toUSecs(userTime);
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    auto toUSecs = [](const timeval &time) {
+        return static_cast<qint64>(time.tv_sec) * 1000 * 1000 + time.tv_usec;
+    };
+    return toUSecs(usage.ru_utime) + toUSecs(usage.ru_stime);
+#endif
+}
+
+} // namespace
+
+class Tile
+{
+public:
+    explicit Tile(Ffmpeg::VideoRenderCreate::RenderType renderType)
+        : videoRender(Ffmpeg::VideoRenderCreate::create(renderType))
+        , playerPtr(new Ffmpeg::Player)
+    {
+        videoRender->widget()->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+        videoRender->widget()->setMinimumSize(64, 36);
+        playerPtr->setVideoRenders({videoRender.data()});
+        auto *propertyChannel = playerPtr->propertyChannel();
+        QObject::connect(propertyChannel,
+                         &Ffmpeg::PropertyChannel::changed,
+                         propertyChannel,
+                         [this, propertyChannel] {
+                             auto snapshot = propertyChannel->takeSnapshot();
+                             bool loop = snapshot.changed.testFlag(Ffmpeg::PropertyChannel::State)
+                                         && snapshot.mediaState == Ffmpeg::MediaState::Playing;
+                             // The other events are not shown
+                             while (propertyChannel->eventSize() > 0) {
+                                 auto eventPtr = propertyChannel->takeEvent();
+                                 loop = loop
+                                        || eventPtr->type()
+                                               == Ffmpeg::PropertyChangeEvent::EventType::MediaChanged;
+                             }
+                             if (loop) {
+                                 // Loops without stopping
+                                 playerPtr->setNextMedia(filepath);
+                             }
+                         });
+    }
+
+    ~Tile()
+    {
+        playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::CloseMediaEvent));
+        playerPtr->setVideoRenders({});
+    }
+
+    void open(const QString &path, bool mute, bool gpuDecode)
+    {
+        filepath = path;
+        playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::GpuEvent(gpuDecode)));
+        if (mute) {
+            playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::VolumeEvent(0)));
+        }
+        playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::OpenMediaEvent(filepath)));
+    }
+
+    [[nodiscard]] auto isPlaying() const -> bool
+    {
+        return playerPtr->mediaState() == Ffmpeg::MediaState::Playing;
+    }
+
+    QString filepath;
+    // The render outlives the player that draws into it
+    QScopedPointer<Ffmpeg::VideoRender> videoRender;
+    QScopedPointer<Ffmpeg::Player> playerPtr;
+};
+
+class MainWindow::MainWindowPrivate
+{
+public:
+    explicit MainWindowPrivate(MainWindow *q)
+        : q_ptr(q)
+    {
+        tileSpinBox = new QSpinBox(q_ptr);
+        tileSpinBox->setRange(1, 64);
+        tileSpinBox->setValue(16);
+
+        renderComboBox = new QComboBox(q_ptr);
+        renderComboBox->addItem("Opengl", Ffmpeg::VideoRenderCreate::Opengl);
+        renderComboBox->addItem("Widget", Ffmpeg::VideoRenderCreate::Widget);
+
+        gpuCheckBox = new QCheckBox(QObject::tr("GPU Decode"), q_ptr);
+        gpuCheckBox->setChecked(false);
+
+        openButton = new QPushButton(QObject::tr("Open Files"), q_ptr);
+        restartButton = new QPushButton(QObject::tr("Restart"), q_ptr);
+
+        gridWidget = new QWidget(q_ptr);
+        gridLayout = new QGridLayout(gridWidget);
+        gridLayout->setContentsMargins(QMargins());
+        gridLayout->setSpacing(2);
+
+        statsLabel = new QLabel(q_ptr);
+        statsTimer = new QTimer(q_ptr);
+        statsTimer->setInterval(1000);
+    }
+
+    void clearTiles()
+    {
+        // Close all players first, so they shut down in parallel
+        for (auto *tile : std::as_const(tiles)) {
+            tile->playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::CloseMediaEvent));
+        }
+        qDeleteAll(tiles);
+        tiles.clear();
+    }
+
+    void createTiles()
+    {
+        clearTiles();
+        if (files.isEmpty()) {
+            return;
+        }
+        auto count = tileSpinBox->value();
+        auto columns = qCeil(qSqrt(count));
+        auto renderType = static_cast<Ffmpeg::VideoRenderCreate::RenderType>(
+            renderComboBox->currentData().toInt());
+        for (int i = 0; i < count; ++i) {
+            auto *tile = new Tile(renderType);
+            gridLayout->addWidget(tile->videoRender->widget(), i / columns, i % columns);
+            // Only the first tile is audible
+            tile->open(files.at(i % files.size()), i != 0, gpuCheckBox->isChecked());
+            tiles.append(tile);
+        }
+        lastCpuTime = processCpuTime();
+        elapsedTimer.start();
+        statsTimer->start();
+    }
+
+    MainWindow *q_ptr;
+
+    QSpinBox *tileSpinBox;
+    QComboBox *renderComboBox;
+    QCheckBox *gpuCheckBox;
+    QPushButton *openButton;
+    QPushButton *restartButton;
+    QWidget *gridWidget;
+    QGridLayout *gridLayout;
+    QLabel *statsLabel;
+    QTimer *statsTimer;
+
+    QStringList files;
+    QList<Tile *> tiles;
+
+    qint64 lastCpuTime = 0;
+    QElapsedTimer elapsedTimer;
+};
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+    , d_ptr(new MainWindowPrivate(this))
+{
+    setupUI();
+    buildConnect();
+    resize(1280, 800);
+}
+
+MainWindow::~MainWindow()
+{
+    d_ptr->clearTiles();
+}
+
+void MainWindow::setTileCount(int count)
+{
+    d_ptr->tileSpinBox->setValue(count);
+}
+
+void MainWindow::openFiles(const QStringList &files)
+{
+    d_ptr->files = files;
+    d_ptr->createTiles();
+}
+
+void MainWindow::onOpenFiles()
+{
+    const auto path = QStandardPaths::standardLocations(QStandardPaths::MoviesLocation)
+                          .value(0, QDir::homePath());
+    const auto files = QFileDialog::getOpenFileNames(this,
+                                                     tr("Open Media"),
+                                                     path,
+                                                     tr("Audio Video (*.mp3 *.mp4 *.mkv *.rmvb)"));
+    if (files.isEmpty()) {
+        return;
+    }
+    openFiles(files);
+}
+
+void MainWindow::onRestart()
+{
+    d_ptr->createTiles();
+}
+
+void MainWindow::onUpdateStats()
+{
+    auto cpuTime = processCpuTime();
+    auto elapsed = d_ptr->elapsedTimer.restart() * 1000;
+    auto cpuUsage = elapsed > 0 ? (cpuTime - d_ptr->lastCpuTime) * 100.0 / elapsed : 0.0;
+    d_ptr->lastCpuTime = cpuTime;
+
+    int playing = 0;
+    double fps = 0;
+    for (auto *tile : std::as_const(d_ptr->tiles)) {
+        if (tile->isPlaying()) {
+            playing++;
+            fps += tile->videoRender->fps();
+        }
+    }
+    // 100% is one core
+    d_ptr->statsLabel->setText(tr("Playing: %1/%2  CPU: %3%  CPU per tile: %4%  FPS per tile: %5")
+                                   .arg(playing)
+                                   .arg(d_ptr->tiles.size())
+                                   .arg(cpuUsage, 0, 'f', 1)
+                                   .arg(playing > 0 ? cpuUsage / playing : 0.0, 0, 'f', 1)
+                                   .arg(playing > 0 ? fps / playing : 0.0, 0, 'f', 1));
+}
+
+void MainWindow::setupUI()
+{
+    auto *toolLayout = new QHBoxLayout;
+    toolLayout->addWidget(new QLabel(tr("Tiles:"), this));
+    toolLayout->addWidget(d_ptr->tileSpinBox);
+    toolLayout->addWidget(new QLabel(tr("Render:"), this));
+    toolLayout->addWidget(d_ptr->renderComboBox);
+    toolLayout->addWidget(d_ptr->gpuCheckBox);
+    toolLayout->addWidget(d_ptr->openButton);
+    toolLayout->addWidget(d_ptr->restartButton);
+    toolLayout->addStretch();
+
+    auto *widget = new QWidget(this);
+    auto *layout = new QVBoxLayout(widget);
+    layout->addLayout(toolLayout);
+    layout->addWidget(d_ptr->gridWidget);
+    setCentralWidget(widget);
+
+    statusBar()->addWidget(d_ptr->statsLabel);
+}
+
+void MainWindow::buildConnect()
+{
+    connect(d_ptr->openButton, &QPushButton::clicked, this, &MainWindow::onOpenFiles);
+    connect(d_ptr->restartButton, &QPushButton::clicked, this, &MainWindow::onRestart);
+    connect(d_ptr->statsTimer, &QTimer::timeout, this, &MainWindow::onUpdateStats);
+}
@@ -0,0 +1,30 @@
+#ifndef MAINWINDOW_HPP
+#define MAINWINDOW_HPP
+
+#include <QMainWindow>
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+public:
+    explicit MainWindow(QWidget *parent = nullptr);
+    ~MainWindow() override;
+
+    void setTileCount(int count);
+    // Tiles play the files round robin
+    void openFiles(const QStringList &files);
+
+private slots:
+    void onOpenFiles();
+    void onRestart();
+    void onUpdateStats();
+
+private:
+    void setupUI();
+    void buildConnect();
+
+    class MainWindowPrivate;
+    QScopedPointer<MainWindowPrivate> d_ptr;
+};
+
+#endif // MAINWINDOW_HPP
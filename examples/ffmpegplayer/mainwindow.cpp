@@ -9,6 +9,7 @@
 #include <examples/common/titlewidget.hpp>
 #include <ffmpeg/averror.h>
 #include <ffmpeg/event/errorevent.hpp>
+#include <ffmpeg/event/propertychannel.hpp>
 #include <ffmpeg/event/seekevent.hpp>
 #include <ffmpeg/event/trackevent.hpp>
 #include <ffmpeg/event/valueevent.hpp>
@@ -194,6 +195,16 @@ public:
             controlWidget->setVolume(controlWidget->volume() - 5);
         });
         new QShortcut(Qt::Key_Space, q_ptr, q_ptr, [this] { controlWidget->clickPlayButton(); });
+        new QShortcut(Qt::Key_Period, q_ptr, q_ptr, [this] {
+            playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::StepFrameEvent(true)));
+        });
+        new QShortcut(Qt::Key_Comma, q_ptr, q_ptr, [this] {
+            playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::StepFrameEvent(false)));
+        });
+        new QShortcut(Qt::Key_R, q_ptr, q_ptr, [this] {
+            playerPtr->addEvent(
+                Ffmpeg::EventPtr(new Ffmpeg::ReverseEvent(!playerPtr->isReversePlaying())));
+        });
     }
 
     void setControlWidgetVisible(bool visible) const
@@ -235,6 +246,15 @@ public:
         fpsTimer->start(1000);
     }
 
+    // The player opens it while the current media drains and goes on without a gap
+    void setNextMedia()
+    {
+        auto *playlist = playlistModel->playlist();
+        nextMediaIndex = playlist->nextIndex();
+        auto url = playlist->media(nextMediaIndex);
+        playerPtr->setNextMedia(url.isLocalFile() ? url.toLocalFile() : url.toString());
+    }
+
     void finished() const
     {
         fpsTimer->stop();
@@ -254,6 +274,8 @@ public:
 
     PlayListView *playlistView;
     PlaylistModel *playlistModel;
+    int nextMediaIndex = -1;
+    bool mediaChanged = false;
 
     QMenu *menu;
 
@@ -410,6 +432,9 @@ void MainWindow::playlistPositionChanged(int currentItem)
     }
     auto url = d_ptr->playlistModel->playlist()->currentMedia();
     d_ptr->playlistView->setCurrentIndex(d_ptr->playlistModel->index(currentItem, 0));
+    if (d_ptr->mediaChanged) {
+        return; // already playing
+    }
 
     d_ptr->playerPtr->addEvent(Ffmpeg::EventPtr(
         new Ffmpeg::OpenMediaEvent(url.isLocalFile() ? url.toLocalFile() : url.toString())));
@@ -444,42 +469,38 @@ void MainWindow::onShowMediaInfo()
 
 void MainWindow::onProcessEvents()
 {
-    while (d_ptr->playerPtr->propertyChangeEventSize() > 0) {
-        auto eventPtr = d_ptr->playerPtr->takePropertyChangeEvent();
+    auto *propertyChannel = d_ptr->playerPtr->propertyChannel();
+    auto snapshot = propertyChannel->takeSnapshot();
+    if (snapshot.changed.testFlag(Ffmpeg::PropertyChannel::Position)) {
+        d_ptr->controlWidget->setPosition(snapshot.position / AV_TIME_BASE);
+    }
+    if (snapshot.changed.testFlag(Ffmpeg::PropertyChannel::CacheSpeed)) {
+        d_ptr->controlWidget->setCacheSpeed(snapshot.cacheSpeed);
+    }
+    if (snapshot.changed.testFlag(Ffmpeg::PropertyChannel::State)) {
+        switch (snapshot.mediaState) {
+        case Ffmpeg::MediaState::Stopped:
+            d_ptr->controlWidget->setPlayButtonChecked(false);
+            d_ptr->finished();
+            break;
+        case Ffmpeg::MediaState::Pausing: d_ptr->controlWidget->setPlayButtonChecked(false); break;
+        case Ffmpeg::MediaState::Opening: d_ptr->controlWidget->setPlayButtonChecked(true); break;
+        case Ffmpeg::MediaState::Playing:
+            d_ptr->controlWidget->setPlayButtonChecked(true);
+            d_ptr->started();
+            d_ptr->setNextMedia();
+            break;
+        default: break;
+        }
+    }
+    while (propertyChannel->eventSize() > 0) {
+        auto eventPtr = propertyChannel->takeEvent();
         switch (eventPtr->type()) {
         case Ffmpeg::PropertyChangeEvent::EventType::Duration: {
             auto *durationEvent = dynamic_cast<Ffmpeg::DurationEvent *>(eventPtr.data());
             d_ptr->controlWidget->setDuration(durationEvent->duration() / AV_TIME_BASE);
             d_ptr->controlWidget->setChapters(d_ptr->playerPtr->mediaInfo().chapters);
         } break;
-        case Ffmpeg::PropertyChangeEvent::EventType::Position: {
-            auto *positionEvent = dynamic_cast<Ffmpeg::PositionEvent *>(eventPtr.data());
-            d_ptr->controlWidget->setPosition(positionEvent->position() / AV_TIME_BASE);
-        } break;
-        case Ffmpeg::PropertyChangeEvent::EventType::MediaState: {
-            auto *stateEvent = dynamic_cast<Ffmpeg::MediaStateEvent *>(eventPtr.data());
-            switch (stateEvent->state()) {
-            case Ffmpeg::MediaState::Stopped:
-                d_ptr->controlWidget->setPlayButtonChecked(false);
-                d_ptr->finished();
-                break;
-            case Ffmpeg::MediaState::Pausing:
-                d_ptr->controlWidget->setPlayButtonChecked(false);
-                break;
-            case Ffmpeg::MediaState::Opening:
-                d_ptr->controlWidget->setPlayButtonChecked(true);
-                break;
-            case Ffmpeg::MediaState::Playing:
-                d_ptr->controlWidget->setPlayButtonChecked(true);
-                d_ptr->started();
-                break;
-            default: break;
-            }
-        } break;
-        case Ffmpeg::PropertyChangeEvent::EventType::CacheSpeed: {
-            auto *speedEvent = dynamic_cast<Ffmpeg::CacheSpeedEvent *>(eventPtr.data());
-            d_ptr->controlWidget->setCacheSpeed(speedEvent->speed());
-        } break;
         case Ffmpeg::PropertyChangeEvent::EventType::MediaTrack: {
             d_ptr->resetTrackMenu();
 
@@ -523,6 +544,26 @@ void MainWindow::onProcessEvents()
                                  QString::number(value));
             d_ptr->setTitleWidgetText(text);
         } break;
+        case Ffmpeg::PropertyChangeEvent::EventType::MediaChanged: {
+            d_ptr->mediaChanged = true;
+            d_ptr->playlistModel->playlist()->setCurrentIndex(d_ptr->nextMediaIndex);
+            d_ptr->mediaChanged = false;
+            d_ptr->started();
+            d_ptr->setNextMedia();
+        } break;
+        case Ffmpeg::PropertyChangeEvent::EventType::OpenProgress: {
+            auto *progressEvent = dynamic_cast<Ffmpeg::OpenProgressEvent *>(eventPtr.data());
+            switch (progressEvent->stage()) {
+            case Ffmpeg::OpenProgressEvent::Opening: d_ptr->setTitleWidgetText(tr("Opening...")); break;
+            case Ffmpeg::OpenProgressEvent::Probing:
+                d_ptr->setTitleWidgetText(tr("Probing... (%1 ms)").arg(progressEvent->elapsed()));
+                break;
+            case Ffmpeg::OpenProgressEvent::Failed:
+                d_ptr->setTitleWidgetText(tr("Open failed (%1 ms)").arg(progressEvent->elapsed()));
+                break;
+            default: break;
+            }
+        } break;
         case Ffmpeg::PropertyChangeEvent::EventType::AVError: {
             auto *errorEvent = dynamic_cast<Ffmpeg::AVErrorEvent *>(eventPtr.data());
             const auto text = tr("Error[%1]:%2.")
@@ -626,8 +667,8 @@ void MainWindow::setupUI()
 
 void MainWindow::buildConnect()
 {
-    connect(d_ptr->playerPtr.data(),
-            &Ffmpeg::Player::eventIncrease,
+    connect(d_ptr->playerPtr->propertyChannel(),
+            &Ffmpeg::PropertyChannel::changed,
             this,
             &MainWindow::onProcessEvents);
 
@@ -643,7 +684,10 @@ void MainWindow::buildConnect()
     connect(d_ptr->controlWidget, &ControlWidget::leavePosition, this, &MainWindow::onLeaveSlider);
     connect(d_ptr->controlWidget, &ControlWidget::seek, d_ptr->playerPtr.data(), [this](int value) {
         qint64 position = value;
-        d_ptr->playerPtr->addEvent(Ffmpeg::EventPtr(new Ffmpeg::SeekEvent(position * AV_TIME_BASE)));
+        auto mode = d_ptr->controlWidget->isSliderDown() ? Ffmpeg::SeekMode::Scrub
+                                                         : Ffmpeg::SeekMode::Fast;
+        d_ptr->playerPtr->addEvent(
+            Ffmpeg::EventPtr(new Ffmpeg::SeekEvent(position * AV_TIME_BASE, mode)));
     });
     connect(d_ptr->controlWidget, &ControlWidget::play, this, [this](bool checked) {
         if (checked && !d_ptr->playerPtr->isRunning()) {
@@ -10,6 +10,7 @@
 #include <ffmpeg/averror.h>
 #include <ffmpeg/encodecontext.hpp>
 #include <ffmpeg/event/errorevent.hpp>
+#include <ffmpeg/event/propertychannel.hpp>
 #include <ffmpeg/event/trackevent.hpp>
 #include <ffmpeg/event/valueevent.hpp>
 #include <ffmpeg/ffmpegutils.hpp>
@@ -244,14 +245,15 @@ void MainWindow::onShowMediaInfo()
 
 void MainWindow::onProcessEvents()
 {
-    while (d_ptr->transcoder->propertyChangeEventSize() > 0) {
-        auto eventPtr = d_ptr->transcoder->takePropertyChangeEvent();
+    auto *propertyChannel = d_ptr->transcoder->propertyChannel();
+    auto snapshot = propertyChannel->takeSnapshot();
+    if (snapshot.changed.testFlag(Ffmpeg::PropertyChannel::Position)) {
+        d_ptr->statusWidget->setProgress(snapshot.position * 100.0
+                                         / d_ptr->transcoder->duration());
+    }
+    while (propertyChannel->eventSize() > 0) {
+        auto eventPtr = propertyChannel->takeEvent();
         switch (eventPtr->type()) {
-        case Ffmpeg::PropertyChangeEvent::EventType::Position: {
-            auto *positionEvent = dynamic_cast<Ffmpeg::PositionEvent *>(eventPtr.data());
-            d_ptr->statusWidget->setProgress(positionEvent->position() * 100.0
-                                             / d_ptr->transcoder->duration());
-        } break;
         case Ffmpeg::PropertyChangeEvent::EventType::MediaTrack: {
             d_ptr->initUI();
 
@@ -329,8 +331,8 @@ void MainWindow::setupUI()
 
 void MainWindow::buildConnect()
 {
-    connect(d_ptr->transcoder,
-            &Ffmpeg::Transcoder::eventIncrease,
+    connect(d_ptr->transcoder->propertyChannel(),
+            &Ffmpeg::PropertyChannel::changed,
             this,
             &MainWindow::onProcessEvents);
     connect(d_ptr->transcoder, &Ffmpeg::Transcoder::finished, this, [this] {
@@ -1,12 +1,18 @@
 #include "audiodecoder.h"
 #include "audiodisplay.hpp"
 #include "avcontextinfo.h"
+#include "clock.hpp"
+#include "codeccontext.h"
 #include "ffmpegutils.hpp"
 
 #include <event/seekevent.hpp>
 
 #include <QDebug>
 
+extern "C" {
+#include <libavutil/mathematics.h>
+}
+
 namespace Ffmpeg {
 
 class AudioDecoder::AudioDecoderPrivate
@@ -18,7 +24,7 @@ public:
         decoderAudioFrame = new AudioDisplay(q_ptr);
     }
 
-    void processEvent() const
+    void processEvent()
     {
         while (q_ptr->m_runing.load() && !q_ptr->m_eventQueue.empty()) {
             auto eventPtr = q_ptr->m_eventQueue.take();
@@ -26,8 +32,7 @@ public:
             case Event::EventType::Pause: decoderAudioFrame->addEvent(eventPtr); break;
             case Event::EventType::Seek: {
                 auto *seekEvent = static_cast<SeekEvent *>(eventPtr.data());
-                seekEvent->countDown();
-                q_ptr->clear();
+                seekTarget = seekEvent->mode() == SeekMode::Exact ? seekEvent->position() : -1;
                 decoderAudioFrame->addEvent(eventPtr);
             } break;
             default: break;
@@ -35,8 +40,77 @@ public:
         }
     }
 
+    // The first packet of a new serial. After a seek, whose event is always queued before it,
+    // the codec is flushed. The next media starts once the current one is drained.
+    void processSerialChanged(qint64 packetSerial)
+    {
+        processEvent();
+        if (serial >= 0 && !q_ptr->m_clockDomain->isStale(serial)) {
+            drainCodec();
+            seekTarget = -1;
+            q_ptr->switchMedia(packetSerial);
+        } else {
+            q_ptr->switchMedia(packetSerial);
+            q_ptr->m_contextInfo->codecCtx()->flush();
+            decoderAudioFrame->clear();
+        }
+        serial = packetSerial;
+    }
+
+    void decodePacket(const PacketPtr &packetPtr)
+    {
+        q_ptr->m_contextInfo->decodeFrame(packetPtr, [this](const FramePtr &framePtr) {
+            framePtr->setSerial(serial);
+            calculatePts(framePtr.data(), q_ptr->m_contextInfo, q_ptr->m_formatContext);
+            if (discardBeforeTarget(framePtr)) {
+                return;
+            }
+            decoderAudioFrame->append(framePtr);
+        });
+    }
+
+    // The frames left in the codec keep the serial of the current media
+    void drainCodec()
+    {
+        if (serial < 0) {
+            return;
+        }
+        decodePacket(PacketPtr(new Packet));
+        q_ptr->m_contextInfo->codecCtx()->flush();
+    }
+
+    // Exact seek, drops whole frames before the target and trims the one containing it
+    auto discardBeforeTarget(const FramePtr &framePtr) -> bool
+    {
+        if (seekTarget < 0) {
+            return false;
+        }
+        auto *avFrame = framePtr->avFrame();
+        if (avFrame->sample_rate <= 0) {
+            seekTarget = -1;
+            return false;
+        }
+        auto pts = framePtr->pts();
+        auto duration = av_rescale(avFrame->nb_samples, AV_TIME_BASE, avFrame->sample_rate);
+        if (pts + duration <= seekTarget) {
+            return true;
+        }
+        if (pts < seekTarget) {
+            auto count = static_cast<int>(
+                av_rescale(seekTarget - pts, avFrame->sample_rate, AV_TIME_BASE));
+            if (framePtr->trimSamples(count)) {
+                framePtr->setPts(pts + av_rescale(count, AV_TIME_BASE, avFrame->sample_rate));
+            }
+        }
+        seekTarget = -1;
+        return false;
+    }
+
     AudioDecoder *q_ptr;
 
+    qint64 seekTarget = -1;
+    qint64 serial = -1;
+
     AudioDisplay *decoderAudioFrame;
 };
 
@@ -47,7 +121,12 @@ AudioDecoder::AudioDecoder(QObject *parent)
     connect(d_ptr->decoderAudioFrame,
             &AudioDisplay::positionChanged,
             this,
-            &AudioDecoder::positionChanged);
+            &AudioDecoder::positionChanged,
+            Qt::DirectConnection);
+    connect(d_ptr->decoderAudioFrame,
+            &AudioDisplay::seekLanded,
+            this,
+            &AudioDecoder::seekLanded);
 }
 
 AudioDecoder::~AudioDecoder()
@@ -55,11 +134,93 @@ AudioDecoder::~AudioDecoder()
     stopDecoder();
 }
 
+void AudioDecoder::setClockDomain(ClockDomain *clockDomain)
+{
+    Decoder<PacketPtr>::setClockDomain(clockDomain);
+    d_ptr->decoderAudioFrame->setClockDomain(clockDomain);
+}
+
+auto AudioDecoder::waitForFinished(QDeadlineTimer deadline) -> bool
+{
+    return Decoder<PacketPtr>::waitForFinished(deadline)
+           && d_ptr->decoderAudioFrame->waitForFinished(deadline);
+}
+
+void AudioDecoder::wakeFinished()
+{
+    Decoder<PacketPtr>::wakeFinished();
+    d_ptr->decoderAudioFrame->wakeFinished();
+}
+
 void AudioDecoder::setVolume(qreal volume)
 {
     d_ptr->decoderAudioFrame->setVolume(volume);
 }
 
+void AudioDecoder::setHoldOutput(bool hold)
+{
+    d_ptr->decoderAudioFrame->setHoldOutput(hold);
+}
+
+auto AudioDecoder::frameQueueSize() -> size_t
+{
+    return d_ptr->decoderAudioFrame->size();
+}
+
+void AudioDecoder::setNextMedia(qint64 serial,
+                                FormatContext *formatContext,
+                                AVContextInfo *contextInfo)
+{
+    d_ptr->decoderAudioFrame->setNextMedia(serial, formatContext, contextInfo);
+    Decoder<PacketPtr>::setNextMedia(serial, formatContext, contextInfo);
+}
+
+auto AudioDecoder::isMediaChangePending() -> bool
+{
+    return Decoder<PacketPtr>::isMediaChangePending()
+           || d_ptr->decoderAudioFrame->isMediaChangePending();
+}
+
+void AudioDecoder::setLatencyCompensation(qint64 latency)
+{
+    d_ptr->decoderAudioFrame->setLatencyCompensation(latency);
+}
+
+auto AudioDecoder::latencyCompensation() const -> qint64
+{
+    return d_ptr->decoderAudioFrame->latencyCompensation();
+}
+
+void AudioDecoder::setOutputProfile(const AudioOutputProfile &profile)
+{
+    d_ptr->decoderAudioFrame->setOutputProfile(profile);
+}
+
+auto AudioDecoder::outputProfile() const -> AudioOutputProfile
+{
+    return d_ptr->decoderAudioFrame->outputProfile();
+}
+
+auto AudioDecoder::outputStats() const -> AudioOutputStats
+{
+    return d_ptr->decoderAudioFrame->outputStats();
+}
+
+void AudioDecoder::setSoftSyncEnabled(bool enabled)
+{
+    d_ptr->decoderAudioFrame->setSoftSyncEnabled(enabled);
+}
+
+auto AudioDecoder::isSoftSyncEnabled() const -> bool
+{
+    return d_ptr->decoderAudioFrame->isSoftSyncEnabled();
+}
+
+auto AudioDecoder::syncStats() const -> AudioSyncStats
+{
+    return d_ptr->decoderAudioFrame->syncStats();
+}
+
 void AudioDecoder::setMasterClock()
 {
     d_ptr->decoderAudioFrame->setMasterClock();
@@ -68,6 +229,7 @@ void AudioDecoder::setMasterClock()
 void AudioDecoder::runDecoder()
 {
     d_ptr->decoderAudioFrame->startDecoder(m_formatContext, m_contextInfo);
+    d_ptr->serial = -1;
 
     while (m_runing) {
         d_ptr->processEvent();
@@ -76,16 +238,21 @@ void AudioDecoder::runDecoder()
         if (packetPtr.isNull()) {
             continue;
         }
-        auto framePtrs = m_contextInfo->decodeFrame(packetPtr);
-        for (const auto &framePtr : framePtrs) {
-            calculatePts(framePtr.data(), m_contextInfo, m_formatContext);
-            d_ptr->decoderAudioFrame->append(framePtr);
+        if (isEndOfStream(packetPtr)) {
+            d_ptr->drainCodec();
+            d_ptr->decoderAudioFrame->appendEndOfStream();
+            setFinished();
+            continue;
         }
+        // Stale packets of an earlier seek
+        if (m_clockDomain->isStale(packetPtr->serial())) {
+            continue;
+        }
+        if (packetPtr->serial() != d_ptr->serial) {
+            d_ptr->processSerialChanged(packetPtr->serial());
+        }
+        d_ptr->decodePacket(packetPtr);
     }
-    while (m_runing && d_ptr->decoderAudioFrame->size() != 0) {
-        msleep(s_waitQueueEmptyMilliseconds);
-    }
-
     d_ptr->decoderAudioFrame->stopDecoder();
 }
 
@@ -1,6 +1,8 @@
 #ifndef AUDIODECODER_H
 #define AUDIODECODER_H
 
+#include "audiooutputprofile.hpp"
+#include "audiosync.hpp"
 #include "decoder.h"
 #include "packet.h"
 
@@ -13,12 +15,40 @@ public:
     explicit AudioDecoder(QObject *parent = nullptr);
     ~AudioDecoder() override;
 
+    void setClockDomain(ClockDomain *clockDomain) override;
+
+    // Also waits for the display behind the decoder
+    auto waitForFinished(QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever))
+        -> bool override;
+    void wakeFinished() override;
+
     void setVolume(qreal volume);
 
+    void setLatencyCompensation(qint64 latency);
+    [[nodiscard]] auto latencyCompensation() const -> qint64;
+
+    void setOutputProfile(const AudioOutputProfile &profile);
+    [[nodiscard]] auto outputProfile() const -> AudioOutputProfile;
+    [[nodiscard]] auto outputStats() const -> AudioOutputStats;
+
+    void setSoftSyncEnabled(bool enabled);
+    [[nodiscard]] auto isSoftSyncEnabled() const -> bool;
+    [[nodiscard]] auto syncStats() const -> AudioSyncStats;
+
     void setMasterClock();
 
+    // Also hands the next media to the display stage
+    void setNextMedia(qint64 serial, FormatContext *formatContext, AVContextInfo *contextInfo);
+    auto isMediaChangePending() -> bool;
+
+    void setHoldOutput(bool hold);
+
+    // Decoded frames not played yet
+    auto frameQueueSize() -> size_t;
+
 signals:
     void positionChanged(qint64 position); // ms
+    void seekLanded(const Ffmpeg::EventPtr &eventPtr, qint64 position);
 
 protected:
     void runDecoder() override;
@@ -1,6 +1,8 @@
 #include "audiodisplay.hpp"
+#include "audiotempo.hpp"
 #include "clock.hpp"
 
+#include <audiorender/audiooutput.hpp>
 #include <audiorender/audiooutputthread.hpp>
 #include <event/seekevent.hpp>
 #include <event/valueevent.hpp>
@@ -9,6 +11,8 @@
 #include <QWaitCondition>
 
 extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/mathematics.h>
 #include <libavutil/time.h>
 }
 
@@ -21,11 +25,12 @@ public:
         : q_ptr(q)
     {
         clock = new Clock(q);
+        audioTempo = new AudioTempo(q);
     }
 
     ~AudioDisplayPrivate() = default;
 
-    void processEvent(bool &firstFrame) const
+    void processEvent(bool &firstFrame)
     {
         while (q_ptr->m_runing.load() && !q_ptr->m_eventQueue.empty()) {
             qDebug() << "AudioFramePrivate::processEvent";
@@ -37,20 +42,160 @@ public:
                 clock->setPaused(paused);
             } break;
             case Event::EventType::Seek: {
-                q_ptr->clear();
                 firstFrame = false;
+                seekEventPtr = eventPtr;
             }
             default: break;
             }
         }
     }
 
+    // The clock follows what the device plays once it plays this serial, stretched to the
+    // speed of the clock
+    [[nodiscard]] auto followsPlayback(const AudioPlayback &playback, qint64 serial) const -> bool
+    {
+        auto *domain = clock->domain();
+        return playback.serial == serial && domain->master() == clock
+               && domain->speed() == audioTempo->tempo();
+    }
+
+    // Media time the device plays now, extrapolated no further than it has samples for
+    [[nodiscard]] auto playedPosition(const AudioPlayback &playback, qint64 now) const -> qint64
+    {
+        auto elapsed = qMin(now - playback.time, playback.buffered);
+        return playback.pts + static_cast<qint64>(elapsed * audioTempo->tempo());
+    }
+
+    // What the frame plays longer to close the drift of the audio heard to the master,
+    // microsecond of played time
+    auto compensate(const AudioPlayback &playback,
+                    qint64 serial,
+                    const FramePtr &framePtr,
+                    qint64 now) -> qint64
+    {
+        auto *domain = clock->domain();
+        auto *avFrame = framePtr->avFrame();
+        if (playback.serial != serial || domain->master() == clock || avFrame->sample_rate <= 0) {
+            return 0;
+        }
+        auto tempo = audioTempo->tempo();
+        auto heard = playedPosition(playback, now) - static_cast<qint64>(latency.load() * tempo);
+        auto drift = heard - domain->master()->position(now);
+        auto duration = av_rescale(avFrame->nb_samples, AV_TIME_BASE, avFrame->sample_rate);
+        auto correction = compensator.update(drift, static_cast<qint64>(duration * tempo));
+        if (!softSync.load()) {
+            correction = 0;
+        }
+        syncStats.update([&](AudioSyncStats &stats) {
+            stats.drift = compensator.drift();
+            stats.maxDrift = qMax(stats.maxDrift, qAbs(drift));
+            if (correction != 0) {
+                stats.compensated += correction;
+                stats.softCorrections++;
+            }
+        });
+        return static_cast<qint64>(correction / tempo);
+    }
+
+    // Paces one frame out of the time stretch and writes it
+    void play(AudioOutputThread *audioOutputThread,
+              const FramePtr &framePtr,
+              qint64 serial,
+              quint64 &dropNum)
+    {
+        applyProfile(audioOutputThread);
+        auto pts = framePtr->pts();
+        auto now = av_gettime_relative();
+        auto tempo = audioTempo->tempo();
+        qint64 delay = 0;
+        auto playback = audioOutputThread->playback();
+        auto follows = followsPlayback(playback, serial);
+        qint64 correction = 0;
+        if (follows) {
+            auto played = playedPosition(playback, now);
+            clock->sync(played - static_cast<qint64>(latency.load() * tempo), now);
+            delay = static_cast<qint64>((pts - played) / tempo) - maxLead();
+        } else {
+            clock->update(pts, now);
+            if (!clock->getDelayWithMaster(delay)) {
+                writeFrame(audioOutputThread, framePtr);
+                return;
+            }
+            correction = compensate(playback, serial, framePtr, now);
+        }
+        auto emitPosition = qScopeGuard([=]() { emit q_ptr->positionChanged(pts); });
+        if (!follows && !clock->adjustDelay(delay)) {
+            qDebug() << "Audio Delay: " << delay;
+            dropNum++;
+            compensator.reset();
+            syncStats.update([](AudioSyncStats &stats) { stats.hardCorrections++; });
+            return;
+        }
+        delay /= 1000;
+        if (delay > 0) {
+            QMutexLocker locker(&mutex);
+            waitCondition.wait(&mutex, delay);
+        }
+        // qDebug() << "Audio PTS:"
+        //          << QTime::fromMSecsSinceStartOfDay(pts / 1000).toString("hh:mm:ss.zzz");
+        writeFrame(audioOutputThread, framePtr, correction);
+    }
+
+    // Low latency writes no further ahead than the sink buffers, plus a margin
+    [[nodiscard]] auto maxLead() const -> qint64
+    {
+        auto value = stats.load();
+        if (!profile.load().lowLatency || value.bufferDuration <= 0) {
+            return s_maxLead;
+        }
+        return qMin(s_maxLead, value.bufferDuration + s_lowLatencyMargin);
+    }
+
+    // Hands a changed profile to the output, on the decoder thread which owns it
+    void applyProfile(AudioOutputThread *audioOutputThread)
+    {
+        auto sequence = profile.sequence();
+        if (sequence != appliedProfile) {
+            appliedProfile = sequence;
+            audioOutputThread->setProfile(profile.load());
+        }
+        stats.store(audioOutputThread->stats());
+    }
+
+    // Waits while the ring is full, the sink drains it in real time
+    void writeFrame(AudioOutputThread *audioOutputThread,
+                    const FramePtr &framePtr,
+                    qint64 correction = 0)
+    {
+        while (q_ptr->m_runing.load()
+               && !audioOutputThread->write(framePtr, audioTempo->tempo(), correction)) {
+            QMutexLocker locker(&mutex);
+            waitCondition.wait(&mutex, s_writeRetryInterval);
+        }
+    }
+
+    // Written ahead of what is heard, keeps seeks and pauses quick
+    static constexpr qint64 s_maxLead = 100 * 1000;         // microsecond
+    static constexpr qint64 s_lowLatencyMargin = 10 * 1000; // microsecond
+    static constexpr int s_writeRetryInterval = 5;          // milliseconds
+
     AudioDisplay *q_ptr;
 
     qreal volume = 0.5;
+    std::atomic<qint64> latency = 0;
+    Utils::SeqLock<AudioOutputProfile> profile;
+    quint64 appliedProfile = 0;
+    Utils::SeqLock<AudioOutputStats> stats;
+    AudioDriftCompensator compensator;
+    std::atomic_bool softSync = true;
+    Utils::SeqLock<AudioSyncStats> syncStats;
     QPointer<AudioOutputThread> audioOutputThreadPtr;
+    std::atomic_bool holdOutput = false;
+    QScopedPointer<AudioOutputThread> heldOutputThreadPtr;
 
     Clock *clock;
+    AudioTempo *audioTempo;
+    EventPtr seekEventPtr;
     QMutex mutex;
     QWaitCondition waitCondition;
 };
@@ -65,6 +210,12 @@ AudioDisplay::~AudioDisplay()
     stopDecoder();
 }
 
+void AudioDisplay::setClockDomain(ClockDomain *clockDomain)
+{
+    Decoder<FramePtr>::setClockDomain(clockDomain);
+    d_ptr->clock->setDomain(clockDomain);
+}
+
 void AudioDisplay::setVolume(qreal volume)
 {
     d_ptr->volume = volume;
@@ -73,18 +224,72 @@ void AudioDisplay::setVolume(qreal volume)
     }
 }
 
+void AudioDisplay::setHoldOutput(bool hold)
+{
+    d_ptr->holdOutput.store(hold);
+}
+
+void AudioDisplay::setLatencyCompensation(qint64 latency)
+{
+    d_ptr->latency.store(latency);
+}
+
+auto AudioDisplay::latencyCompensation() const -> qint64
+{
+    return d_ptr->latency.load();
+}
+
+void AudioDisplay::setOutputProfile(const AudioOutputProfile &profile)
+{
+    d_ptr->profile.store(profile);
+}
+
+auto AudioDisplay::outputProfile() const -> AudioOutputProfile
+{
+    return d_ptr->profile.load();
+}
+
+auto AudioDisplay::outputStats() const -> AudioOutputStats
+{
+    return d_ptr->stats.load();
+}
+
+void AudioDisplay::setSoftSyncEnabled(bool enabled)
+{
+    d_ptr->softSync.store(enabled);
+}
+
+auto AudioDisplay::isSoftSyncEnabled() const -> bool
+{
+    return d_ptr->softSync.load();
+}
+
+auto AudioDisplay::syncStats() const -> AudioSyncStats
+{
+    return d_ptr->syncStats.load();
+}
+
 void AudioDisplay::setMasterClock()
 {
-    Clock::setMaster(d_ptr->clock);
+    m_clockDomain->setMaster(d_ptr->clock);
 }
 
 void AudioDisplay::runDecoder()
 {
     quint64 dropNum = 0;
-    QScopedPointer<AudioOutputThread> audioOutputThreadPtr(new AudioOutputThread);
+    QScopedPointer<AudioOutputThread> audioOutputThreadPtr(d_ptr->heldOutputThreadPtr.take());
+    if (audioOutputThreadPtr.isNull()) {
+        audioOutputThreadPtr.reset(new AudioOutputThread);
+        d_ptr->appliedProfile = d_ptr->profile.sequence();
+        audioOutputThreadPtr->setProfile(d_ptr->profile.load());
+        audioOutputThreadPtr->openOutput(m_contextInfo, d_ptr->volume);
+    } else {
+        audioOutputThreadPtr->resetContextInfo(m_contextInfo);
+    }
     d_ptr->audioOutputThreadPtr = audioOutputThreadPtr.data();
-    audioOutputThreadPtr->openOutput(m_contextInfo, d_ptr->volume);
+    d_ptr->audioTempo->reset();
     bool firstFrame = false;
+    qint64 serial = -1;
     while (m_runing.load()) {
         d_ptr->processEvent(firstFrame);
 
@@ -92,36 +297,43 @@ void AudioDisplay::runDecoder()
         if (framePtr.isNull()) {
             continue;
         }
+        if (isEndOfStream(framePtr)) {
+            setFinished();
+            continue;
+        }
+        if (m_clockDomain->isStale(framePtr->serial())) {
+            continue;
+        }
+        if (framePtr->serial() != serial) {
+            d_ptr->processEvent(firstFrame);
+            d_ptr->compensator.reset();
+            serial = framePtr->serial();
+            if (switchMedia(serial)) {
+                // The samples of the previous media left in the sink play out first
+                audioOutputThreadPtr->resetContextInfo(m_contextInfo);
+                firstFrame = false;
+            }
+        }
         if (!firstFrame) {
             qDebug() << "Audio firstFrame: "
                      << QTime::fromMSecsSinceStartOfDay(framePtr->pts() / 1000)
                             .toString("hh:mm:ss.zzz");
             firstFrame = true;
             d_ptr->clock->reset(framePtr->pts());
+            if (!d_ptr->seekEventPtr.isNull()) {
+                emit seekLanded(d_ptr->seekEventPtr, framePtr->pts());
+                d_ptr->seekEventPtr.reset();
+            }
         }
-        emit audioOutputThreadPtr->convertData(framePtr);
-        auto pts = framePtr->pts();
-        d_ptr->clock->update(pts, av_gettime_relative());
-        qint64 delay = 0;
-        if (!d_ptr->clock->getDelayWithMaster(delay)) {
-            continue;
-        }
-        auto emitPosition = qScopeGuard([=]() { emit positionChanged(pts); });
-        if (!d_ptr->clock->adjustDelay(delay)) {
-            qDebug() << "Audio Delay: " << delay;
-            dropNum++;
-            continue;
+        const auto framePtrs = d_ptr->audioTempo->process(framePtr, m_clockDomain->speed());
+        for (const auto &stretchedPtr : framePtrs) {
+            d_ptr->play(audioOutputThreadPtr.data(), stretchedPtr, serial, dropNum);
         }
-        delay /= 1000;
-        if (delay > 0) {
-            QMutexLocker locker(&d_ptr->mutex);
-            d_ptr->waitCondition.wait(&d_ptr->mutex, delay);
-        }
-        // qDebug() << "Audio PTS:"
-        //          << QTime::fromMSecsSinceStartOfDay(pts / 1000).toString("hh:mm:ss.zzz");
-        emit audioOutputThreadPtr->wirteData();
     }
     qInfo() << "Audio Drop Num:" << dropNum;
+    if (d_ptr->holdOutput.exchange(false)) {
+        d_ptr->heldOutputThreadPtr.reset(audioOutputThreadPtr.take());
+    }
 }
 
 } // namespace Ffmpeg
@@ -1,6 +1,8 @@
 #ifndef AUDIODISPLAY_H
 #define AUDIODISPLAY_H
 
+#include "audiooutputprofile.hpp"
+#include "audiosync.hpp"
 #include "decoder.h"
 #include "frame.hpp"
 
@@ -13,12 +15,35 @@ public:
     explicit AudioDisplay(QObject *parent = nullptr);
     ~AudioDisplay() override;
 
+    void setClockDomain(ClockDomain *clockDomain) override;
+
     void setVolume(qreal volume);
 
+    // How long the device takes to make a sample it was handed heard, microsecond. The
+    // master clock runs this much behind what the sink reports as played.
+    void setLatencyCompensation(qint64 latency);
+    [[nodiscard]] auto latencyCompensation() const -> qint64;
+
+    // Any thread, applied to the running output with the next frame
+    void setOutputProfile(const AudioOutputProfile &profile);
+    [[nodiscard]] auto outputProfile() const -> AudioOutputProfile;
+    [[nodiscard]] auto outputStats() const -> AudioOutputStats;
+
+    // Small drifts to a master clock of another stream are resampled away instead of
+    // waiting for the clock to reset
+    void setSoftSyncEnabled(bool enabled);
+    [[nodiscard]] auto isSoftSyncEnabled() const -> bool;
+    [[nodiscard]] auto syncStats() const -> AudioSyncStats;
+
     void setMasterClock();
 
+    // Keeps the audio sink open over the next stop, the next start reuses it
+    void setHoldOutput(bool hold);
+
 signals:
     void positionChanged(qint64 position); // microsecond
+    // Reports the first frame after a seek
+    void seekLanded(const Ffmpeg::EventPtr &eventPtr, qint64 position);
 
 protected:
     void runDecoder() override;
@@ -111,6 +111,7 @@ public:
     SwrContext *swrContext = nullptr;
     QAudioFormat format;
     AVSampleFormat avSampleFormat;
+    int sampleDelta = 0; // of the compensation set, output samples
 };
 
 AudioFrameConverter::AudioFrameConverter(CodecContext *codecCtx,
@@ -151,35 +152,83 @@ AudioFrameConverter::~AudioFrameConverter()
 }
 
 auto AudioFrameConverter::convert(Frame *frame) -> QByteArray
+{
+    QByteArray data(convertedSize(frame), Qt::Uninitialized);
+    auto size = convert(frame, data.data(), data.size(), nullptr, 0);
+    data.truncate(qMax<qint64>(0, size));
+    return data;
+}
+
+auto AudioFrameConverter::convert(
+    Frame *frame, char *data, qint64 size, char *wrapData, qint64 wrapSize) -> qint64
 {
     auto *avFrame = frame->avFrame();
-    auto nb_samples = avFrame->nb_samples;
-    auto out_count = static_cast<int64_t>(nb_samples) * d_ptr->format.sampleRate()
-                         / avFrame->sample_rate
-                     + 256; // 256 copy from ffplay
-    auto size = av_samples_get_buffer_size(nullptr,
-                                           d_ptr->format.channelCount(),
-                                           out_count,
-                                           d_ptr->avSampleFormat,
-                                           0);
-
-    QByteArray data(size, Qt::Uninitialized);
-    quint8 *bufPointer[] = {reinterpret_cast<quint8 *>(data.data())};
+    auto bytesPerFrame = d_ptr->format.bytesPerFrame();
+    quint8 *bufPointer[] = {reinterpret_cast<quint8 *>(data)};
+    auto out_count = static_cast<int>(size / bytesPerFrame);
     auto len = swr_convert(d_ptr->swrContext,
                            bufPointer,
                            out_count,
                            const_cast<const uint8_t **>(avFrame->extended_data),
-                           nb_samples);
-    if (len <= 0) {
-        data.clear();
+                           avFrame->nb_samples);
+    if (len < 0) {
         SET_ERROR_CODE(len);
+        return -1;
+    }
+    qint64 bytes = len * bytesPerFrame;
+    if (len == out_count && wrapSize >= bytesPerFrame) {
+        // Drains what the resampler kept back into the start of the ring
+        bufPointer[0] = reinterpret_cast<quint8 *>(wrapData);
+        auto wrapLen = swr_convert(d_ptr->swrContext,
+                                   bufPointer,
+                                   static_cast<int>(wrapSize / bytesPerFrame),
+                                   nullptr,
+                                   0);
+        if (wrapLen > 0) {
+            bytes += wrapLen * bytesPerFrame;
+        }
     } else if (len == out_count) {
         qWarning() << "audio buffer is probably too small";
     }
-    size = len * d_ptr->format.channelCount() * av_get_bytes_per_sample(d_ptr->avSampleFormat);
-    data.truncate(size);
+    return bytes;
+}
 
-    return data;
+auto AudioFrameConverter::convertedSize(Frame *frame) const -> qint64
+{
+    auto *avFrame = frame->avFrame();
+    auto out_count = static_cast<int64_t>(avFrame->nb_samples) * d_ptr->format.sampleRate()
+                         / avFrame->sample_rate
+                     + 256; // 256 copy from ffplay
+    return av_samples_get_buffer_size(nullptr,
+                                      d_ptr->format.channelCount(),
+                                      static_cast<int>(out_count + qAbs(d_ptr->sampleDelta)),
+                                      d_ptr->avSampleFormat,
+                                      0);
+}
+
+auto AudioFrameConverter::setCompensation(Frame *frame, qint64 correction) -> bool
+{
+    auto *avFrame = frame->avFrame();
+    auto sampleRate = d_ptr->format.sampleRate();
+    auto sampleDelta = static_cast<int>(av_rescale(correction, sampleRate, AV_TIME_BASE));
+    if (sampleDelta == d_ptr->sampleDelta && sampleDelta == 0) {
+        return true;
+    }
+    auto distance = static_cast<int>(
+        av_rescale(avFrame->nb_samples, sampleRate, avFrame->sample_rate));
+    if (distance <= 0) {
+        return false;
+    }
+    // Spread over the frame, a delta of zero ends the compensation
+    auto ret = swr_set_compensation(d_ptr->swrContext,
+                                    sampleDelta,
+                                    sampleDelta != 0 ? distance : 0);
+    if (ret < 0) {
+        SET_ERROR_CODE(ret);
+        return false;
+    }
+    d_ptr->sampleDelta = sampleDelta;
+    return true;
 }
 
 auto getAudioFormatFromCodecCtx(CodecContext *codecCtx, int &sampleSize) -> QAudioFormat
@@ -19,6 +19,15 @@ public:
     ~AudioFrameConverter() override;
 
     auto convert(Frame *frame) -> QByteArray;
+    // Converts into data, what does not fit continues at wrapData, returns the bytes written
+    // or -1. Samples fitting neither stay in the resampler and come out with the next frame.
+    auto convert(Frame *frame, char *data, qint64 size, char *wrapData, qint64 wrapSize)
+        -> qint64;
+    // Bytes the converted frame takes at most
+    auto convertedSize(Frame *frame) const -> qint64;
+    // Resamples the next frame to play correction microseconds longer, shorter if negative,
+    // through swr_set_compensation. Zero plays it as it is.
+    auto setCompensation(Frame *frame, qint64 correction) -> bool;
 
 private:
     class AudioFrameConverterPrivate;
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QtCore>
+
+namespace Ffmpeg {
+
+// How much audio the output holds between the decoder and the device. The default keeps
+// a large sink buffer; low latency starts at the target and grows the buffer by a step on
+// every underrun while audio was flowing, up to the maximum.
+struct AudioOutputProfile
+{
+    bool lowLatency = false;
+    int targetBufferMs = 30;
+    int maxBufferMs = 200;
+};
+
+struct AudioOutputStats
+{
+    qint64 latency = 0;        // written until played, averaged, microsecond
+    qint64 bufferDuration = 0; // of the sink, microsecond
+    quint64 underruns = 0;
+};
+
+} // namespace Ffmpeg
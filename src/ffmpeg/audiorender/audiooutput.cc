@@ -1,13 +1,16 @@
 #include "audiooutput.hpp"
+#include "audioring.hpp"
 
-#include <ffmpeg/audioframeconverter.h>
-#include <ffmpeg/avcontextinfo.h>
-#include <utils/threadsafequeue.hpp>
-
-#include <QApplication>
 #include <QAudioSink>
 #include <QDebug>
 #include <QMediaDevices>
+#include <QTimer>
+
+#include <deque>
+
+extern "C" {
+#include <libavutil/time.h>
+}
 
 namespace Ffmpeg {
 
@@ -26,83 +29,197 @@ public:
         : q_ptr(q)
     {
         mediaDevices = new QMediaDevices(q_ptr);
+        measureTimer = new QTimer(q_ptr);
+        measureTimer->setInterval(s_measureInterval);
     }
     ~AudioOutputPrivate() = default;
 
+    // A new sink for the default device, the ring and what it holds stay
     void reset()
     {
         printAudioOuputDevice();
         audioDevice = QMediaDevices::defaultAudioOutput();
 
-        int sampleSize = 0;
-        auto format = getAudioFormatFromCodecCtx(contextInfo->codecCtx(), sampleSize);
-        audioConverterPtr.reset(new AudioFrameConverter(contextInfo->codecCtx(), format));
+        // The old sink stops pulling before its device goes
+        audioSinkPtr.reset();
+        ringDevicePtr.reset(new AudioRingDevice(ring));
+        ringDevicePtr->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
 
-        audioSinkPtr.reset(new QAudioSink(format));
-        audioSinkPtr->setBufferSize(format.sampleRate() * sampleSize / 8);
+        audioSinkPtr.reset(new QAudioSink(audioDevice, format));
         audioSinkPtr->setVolume(volume);
-        ioDevice = audioSinkPtr->start();
-        if (ioDevice == nullptr) {
-            qWarning() << "Create AudioDevice Failed!";
-        }
         QObject::connect(audioSinkPtr.data(),
                          &QAudioSink::stateChanged,
                          q_ptr,
                          &AudioOutput::onStateChanged);
+        start();
+    }
+
+    void start()
+    {
+        auto bufferSize = profile.lowLatency
+                              ? format.bytesForDuration(bufferMs * 1000LL)
+                              : format.sampleRate() * format.bytesPerSample();
+        audioSinkPtr->setBufferSize(qMax(format.bytesPerFrame(), static_cast<int>(bufferSize)));
+        // What the sink reports counts from here
+        readBase = ring->readBytes();
+        audioSinkPtr->start(ringDevicePtr.data());
+        if (audioSinkPtr->error() != QAudio::NoError) {
+            qWarning() << "Create AudioDevice Failed!";
+        }
+        stats.bufferDuration = format.durationForBytes(audioSinkPtr->bufferSize());
+        publishStats();
+    }
+
+    // The buffer size only takes effect on start, what the sink held is dropped
+    void restart()
+    {
+        if (audioSinkPtr.isNull()) {
+            return;
+        }
+        audioSinkPtr->stop();
+        start();
+    }
+
+    // Running dry is an underrun only if the same stream goes on shortly after, and not
+    // its end, a pause or a seek
+    void checkUnderrun()
+    {
+        if (underrunAt == 0) {
+            return;
+        }
+        if (ring->writtenBytes() != underrunBytes) {
+            if (lastSerial == underrunSerial) {
+                underrun();
+            }
+            underrunAt = 0;
+        } else if (av_gettime_relative() - underrunAt > s_flowTimeout) {
+            underrunAt = 0;
+        }
+    }
+
+    void underrun()
+    {
+        stats.underruns++;
+        if (profile.lowLatency && bufferMs < profile.maxBufferMs) {
+            bufferMs = qMin(profile.maxBufferMs, bufferMs + s_bufferStep);
+            qInfo() << "Audio underrun, sink buffer:" << bufferMs << "ms";
+            // Not from within the state change of the sink
+            QMetaObject::invokeMethod(
+                q_ptr, [this] { restart(); }, Qt::QueuedConnection);
+        }
+        publishStats();
+    }
+
+    void publishStats()
+    {
+        if (statsPtr != nullptr) {
+            statsPtr->store(stats);
+        }
+    }
+
+    void publish(const AudioPlayback &value)
+    {
+        if (playback != nullptr) {
+            playback->store(value);
+        }
     }
 
+    // What the device plays: the sink reports what it processed, bounded by what it pulled
+    // on backends counting what they were handed
+    void measurePlayback()
+    {
+        AudioRing::Mark mark;
+        while (ring->takeMark(mark)) {
+            marks.push_back(mark);
+            lastSerial = mark.serial;
+        }
+        checkUnderrun();
+        if (audioSinkPtr.isNull()) {
+            return;
+        }
+        auto pulled = ring->readBytes() - readBase;
+        auto processed = format.bytesForDuration(audioSinkPtr->processedUSecs());
+        auto played = readBase + qBound<qint64>(0, processed, pulled);
+        while (marks.size() > 1 && marks.front().end <= played) {
+            marks.pop_front();
+        }
+        if (marks.empty() || played < marks.front().begin) {
+            return;
+        }
+        const auto &front = marks.front();
+        auto size = qMax<qint64>(1, front.end - front.begin);
+        auto offset = qMin(played, front.end) - front.begin;
+        AudioPlayback value;
+        value.pts = front.pts + offset * front.duration / size;
+        value.buffered = format.durationForBytes(ring->writtenBytes() - played);
+        value.time = av_gettime_relative();
+        value.serial = front.serial;
+        publish(value);
+        stats.latency = stats.latency == 0
+                            ? value.buffered
+                            : stats.latency + (value.buffered - stats.latency) / 8;
+        publishStats();
+    }
+
+    static constexpr int s_measureInterval = 10;        // milliseconds
+    static constexpr int s_bufferStep = 10;             // milliseconds
+    static constexpr qint64 s_flowTimeout = 100 * 1000; // microsecond
+
     AudioOutput *q_ptr;
 
-    AVContextInfo *contextInfo;
+    AudioRing *ring = nullptr;
+    QAudioFormat format;
+    qint64 readBase = 0;
+    std::deque<AudioRing::Mark> marks;
+    Utils::SeqLock<AudioPlayback> *playback = nullptr;
+    QTimer *measureTimer;
 
-    QScopedPointer<AudioFrameConverter> audioConverterPtr;
+    AudioOutputProfile profile;
+    int bufferMs = 0; // low latency, grows on underruns
+    AudioOutputStats stats;
+    Utils::SeqLock<AudioOutputStats> *statsPtr = nullptr;
+    qint64 lastSerial = -1; // of the last frame written
+    qint64 underrunAt = 0;  // waits for the stream to go on, 0 if none
+    qint64 underrunBytes = 0;
+    qint64 underrunSerial = -1;
 
     qreal volume = 0.5;
+    // Declared before the sink, which is destroyed first
+    QScopedPointer<AudioRingDevice> ringDevicePtr;
     QScopedPointer<QAudioSink> audioSinkPtr;
-    QIODevice *ioDevice = nullptr;
     QMediaDevices *mediaDevices;
     QAudioDevice audioDevice;
-    QByteArray audioBuf;
 };
 
-AudioOutput::AudioOutput(AVContextInfo *contextInfo, qreal volume, QObject *parent)
+AudioOutput::AudioOutput(AudioRing *ring,
+                         const QAudioFormat &format,
+                         const AudioOutputProfile &profile,
+                         qreal volume,
+                         QObject *parent)
     : QObject{parent}
     , d_ptr(new AudioOutputPrivate(this))
 {
-    d_ptr->contextInfo = contextInfo;
+    d_ptr->ring = ring;
+    d_ptr->format = format;
+    d_ptr->profile = profile;
+    d_ptr->bufferMs = qMin(profile.targetBufferMs, profile.maxBufferMs);
     d_ptr->volume = volume;
     d_ptr->reset();
     buildConnect();
+    d_ptr->measureTimer->start();
 }
 
 AudioOutput::~AudioOutput() = default;
 
-void AudioOutput::onConvertData(const QSharedPointer<Ffmpeg::Frame> &framePtr)
+void AudioOutput::setPlayback(Utils::SeqLock<AudioPlayback> *playback)
 {
-    if (d_ptr->ioDevice == nullptr) {
-        return;
-    }
-
-    auto audioBuf = d_ptr->audioConverterPtr->convert(framePtr.data());
-    d_ptr->audioBuf += audioBuf;
+    d_ptr->playback = playback;
 }
 
-void AudioOutput::onWrite()
+void AudioOutput::setStats(Utils::SeqLock<AudioOutputStats> *stats)
 {
-    if (d_ptr->ioDevice == nullptr) {
-        return;
-    }
-    while (d_ptr->audioBuf.size() > 0) {
-        auto byteFree = d_ptr->audioSinkPtr->bytesFree();
-        if (byteFree > 0 && byteFree < d_ptr->audioBuf.size()) {
-            d_ptr->ioDevice->write(d_ptr->audioBuf.data(), byteFree);
-            d_ptr->audioBuf = d_ptr->audioBuf.sliced(byteFree);
-        } else {
-            d_ptr->ioDevice->write(d_ptr->audioBuf);
-            d_ptr->audioBuf.clear();
-            break;
-        }
-    }
+    d_ptr->statsPtr = stats;
+    d_ptr->publishStats();
 }
 
 void AudioOutput::onSetVolume(qreal value)
@@ -114,13 +231,39 @@ void AudioOutput::onSetVolume(qreal value)
     d_ptr->audioSinkPtr->setVolume(value);
 }
 
+void AudioOutput::onFormatChanged(const QAudioFormat &format)
+{
+    d_ptr->audioSinkPtr.reset();
+    d_ptr->ringDevicePtr.reset();
+    d_ptr->format = format;
+    d_ptr->ring->reset(format);
+    d_ptr->marks.clear();
+    d_ptr->underrunAt = 0;
+    d_ptr->publish({});
+    d_ptr->reset();
+}
+
+void AudioOutput::onSetProfile(const Ffmpeg::AudioOutputProfile &profile)
+{
+    d_ptr->profile = profile;
+    d_ptr->bufferMs = qMin(profile.targetBufferMs, profile.maxBufferMs);
+    d_ptr->stats.latency = 0;
+    d_ptr->restart();
+}
+
 void AudioOutput::onStateChanged(QAudio::State state)
 {
-    Q_UNUSED(state)
     if (d_ptr->audioSinkPtr.isNull()) {
         return;
     }
-    if (d_ptr->audioSinkPtr->error() != QAudio::NoError) {
+    auto error = d_ptr->audioSinkPtr->error();
+    if (state == QAudio::IdleState && error == QAudio::UnderrunError) {
+        d_ptr->underrunAt = av_gettime_relative();
+        d_ptr->underrunBytes = d_ptr->ring->writtenBytes();
+        d_ptr->underrunSerial = d_ptr->lastSerial;
+        return;
+    }
+    if (error != QAudio::NoError) {
         qWarning() << tr("QAudioSink Error: ") << state << d_ptr->audioSinkPtr->error();
     }
 }
@@ -135,12 +278,23 @@ void AudioOutput::onAudioOutputsChanged()
     d_ptr->reset();
 }
 
+void AudioOutput::onMeasure()
+{
+    d_ptr->measurePlayback();
+    // A sink that ran dry may wait to be told there is data again
+    if (!d_ptr->audioSinkPtr.isNull() && d_ptr->audioSinkPtr->state() == QAudio::IdleState
+        && d_ptr->ring->size() > 0) {
+        emit d_ptr->ringDevicePtr->readyRead();
+    }
+}
+
 void AudioOutput::buildConnect()
 {
     connect(d_ptr->mediaDevices,
             &QMediaDevices::audioOutputsChanged,
             this,
             &AudioOutput::onAudioOutputsChanged);
+    connect(d_ptr->measureTimer, &QTimer::timeout, this, &AudioOutput::onMeasure);
 }
 
 } // namespace Ffmpeg
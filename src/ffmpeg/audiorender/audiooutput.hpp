@@ -1,29 +1,53 @@
 #ifndef AUDIOOUTPUT_HPP
 #define AUDIOOUTPUT_HPP
 
+#include <ffmpeg/audiooutputprofile.hpp>
+#include <utils/seqlock.hpp>
+
 #include <QAudio>
+#include <QAudioFormat>
 #include <QObject>
 
 namespace Ffmpeg {
 
-class AVContextInfo;
-class Frame;
+class AudioRing;
 
+// The sample the audio device plays, measured on the output thread
+struct AudioPlayback
+{
+    qint64 pts = 0;      // microsecond
+    qint64 buffered = 0; // in the ring or the sink but not played yet, microsecond
+    qint64 time = 0;     // when it was measured, av_gettime_relative()
+    qint64 serial = -1;  // of the frame, -1 before anything was played
+};
+
+// Sink in pull mode reading the ring, lives on the output thread
 class AudioOutput : public QObject
 {
     Q_OBJECT
 public:
-    explicit AudioOutput(AVContextInfo *contextInfo, qreal volume = 0.5, QObject *parent = nullptr);
+    explicit AudioOutput(AudioRing *ring,
+                         const QAudioFormat &format,
+                         const AudioOutputProfile &profile,
+                         qreal volume = 0.5,
+                         QObject *parent = nullptr);
     ~AudioOutput() override;
 
+    // Where the measured playback and stats are published, not owned
+    void setPlayback(Utils::SeqLock<AudioPlayback> *playback);
+    void setStats(Utils::SeqLock<AudioOutputStats> *stats);
+
 public slots:
-    void onConvertData(const QSharedPointer<Ffmpeg::Frame> &framePtr);
-    void onWrite();
     void onSetVolume(qreal value);
+    // The producer waits meanwhile, the ring is reset for the new format
+    void onFormatChanged(const QAudioFormat &format);
+    // Restarts the sink with the target buffer of the profile
+    void onSetProfile(const Ffmpeg::AudioOutputProfile &profile);
 
 private slots:
     void onStateChanged(QAudio::State state);
     void onAudioOutputsChanged();
+    void onMeasure();
 
 private:
     void buildConnect();
@@ -1,8 +1,16 @@
 #include "audiooutputthread.hpp"
 #include "audiooutput.hpp"
+#include "audioring.hpp"
 
+#include <ffmpeg/audioframeconverter.h>
+#include <ffmpeg/avcontextinfo.h>
 #include <ffmpeg/frame.hpp>
 
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/mathematics.h>
+}
+
 namespace Ffmpeg {
 
 class AudioOutputThread::AudioOutputThreadPrivate
@@ -12,18 +20,29 @@ public:
         : q_ptr(q)
     {}
 
+    auto formatOf(AVContextInfo *contextInfo) -> QAudioFormat
+    {
+        int sampleSize = 0;
+        return getAudioFormatFromCodecCtx(contextInfo->codecCtx(), sampleSize);
+    }
+
     AudioOutputThread *q_ptr;
 
     AVContextInfo *contextInfo;
     qreal volume = 0.5;
+    QAudioFormat format;
+    // Used by the producer only
+    QScopedPointer<AudioFrameConverter> audioConverterPtr;
+    AudioRing ring;
+    Utils::SeqLock<AudioPlayback> playback;
+    Utils::SeqLock<AudioOutputProfile> profile;
+    Utils::SeqLock<AudioOutputStats> stats;
 };
 
 AudioOutputThread::AudioOutputThread(QObject *parent)
     : QThread{parent}
     , d_ptr(new AudioOutputThreadPrivate(this))
-{
-    qRegisterMetaType<QSharedPointer<Ffmpeg::Frame>>("QSharedPointer<Ffmpeg::Frame>");
-}
+{}
 
 AudioOutputThread::~AudioOutputThread()
 {
@@ -35,9 +54,30 @@ void AudioOutputThread::openOutput(AVContextInfo *contextInfo, qreal volume)
     closeOutput();
     d_ptr->contextInfo = contextInfo;
     d_ptr->volume = volume;
+    d_ptr->format = d_ptr->formatOf(contextInfo);
+    d_ptr->audioConverterPtr.reset(new AudioFrameConverter(contextInfo->codecCtx(), d_ptr->format));
+    d_ptr->ring.reset(d_ptr->format);
+    d_ptr->playback.store({});
+    d_ptr->stats.store({});
     start();
 }
 
+void AudioOutputThread::resetContextInfo(AVContextInfo *contextInfo)
+{
+    if (!isRunning()) {
+        openOutput(contextInfo, d_ptr->volume);
+        return;
+    }
+    d_ptr->contextInfo = contextInfo;
+    auto format = d_ptr->formatOf(contextInfo);
+    if (format != d_ptr->format) {
+        d_ptr->format = format;
+        emit formatChanged(format);
+    }
+    // Same format, the samples left of the previous media keep playing without a gap
+    d_ptr->audioConverterPtr.reset(new AudioFrameConverter(contextInfo->codecCtx(), format));
+}
+
 void AudioOutputThread::closeOutput()
 {
     if (isRunning()) {
@@ -46,18 +86,84 @@ void AudioOutputThread::closeOutput()
     }
 }
 
+auto AudioOutputThread::write(const QSharedPointer<Frame> &framePtr,
+                              double tempo,
+                              qint64 correction) -> bool
+{
+    auto &ring = d_ptr->ring;
+    d_ptr->audioConverterPtr->setCompensation(framePtr.data(), correction);
+    auto size = d_ptr->audioConverterPtr->convertedSize(framePtr.data());
+    // A frame larger than the ring goes in as far as it fits once the ring ran empty
+    if (ring.freeBytes() < qMin(size, ring.capacity())) {
+        return false;
+    }
+    auto spans = ring.writeSpans();
+    auto bytes = d_ptr->audioConverterPtr->convert(framePtr.data(),
+                                                   spans[0].data,
+                                                   spans[0].size,
+                                                   spans[1].data,
+                                                   spans[1].size);
+    if (bytes <= 0) {
+        return true;
+    }
+    AudioRing::Mark mark;
+    mark.begin = ring.writtenBytes();
+    mark.end = mark.begin + bytes;
+    mark.pts = framePtr->pts();
+    // Media time of the frame, what the resampler added or removed does not count
+    auto *avFrame = framePtr->avFrame();
+    auto duration = avFrame->sample_rate > 0
+                        ? av_rescale(avFrame->nb_samples, AV_TIME_BASE, avFrame->sample_rate)
+                        : d_ptr->format.durationForBytes(bytes);
+    mark.duration = qRound64(duration * tempo);
+    mark.serial = framePtr->serial();
+    ring.commitWrite(bytes, mark);
+    return true;
+}
+
+auto AudioOutputThread::playback() const -> AudioPlayback
+{
+    return d_ptr->playback.load();
+}
+
+void AudioOutputThread::setProfile(const AudioOutputProfile &profile)
+{
+    d_ptr->profile.store(profile);
+    if (isRunning()) {
+        emit profileChanged(profile);
+    }
+}
+
+auto AudioOutputThread::profile() const -> AudioOutputProfile
+{
+    return d_ptr->profile.load();
+}
+
+auto AudioOutputThread::stats() const -> AudioOutputStats
+{
+    return d_ptr->stats.load();
+}
+
 void AudioOutputThread::run()
 {
-    QScopedPointer<AudioOutput> audioOutputPtr(new AudioOutput(d_ptr->contextInfo, d_ptr->volume));
+    QScopedPointer<AudioOutput> audioOutputPtr(
+        new AudioOutput(&d_ptr->ring, d_ptr->format, d_ptr->profile.load(), d_ptr->volume));
+    audioOutputPtr->setPlayback(&d_ptr->playback);
+    audioOutputPtr->setStats(&d_ptr->stats);
     connect(this,
-            &AudioOutputThread::convertData,
+            &AudioOutputThread::profileChanged,
             audioOutputPtr.data(),
-            &AudioOutput::onConvertData);
-    connect(this, &AudioOutputThread::wirteData, audioOutputPtr.data(), &AudioOutput::onWrite);
+            &AudioOutput::onSetProfile);
     connect(this,
             &AudioOutputThread::volumeChanged,
             audioOutputPtr.data(),
             &AudioOutput::onSetVolume);
+    // The ring is reset while the producer waits
+    connect(this,
+            &AudioOutputThread::formatChanged,
+            audioOutputPtr.data(),
+            &AudioOutput::onFormatChanged,
+            Qt::BlockingQueuedConnection);
     exec();
 }
 
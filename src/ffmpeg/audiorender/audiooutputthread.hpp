@@ -1,12 +1,16 @@
 #ifndef AUDIOOUTPUTTHREAD_HPP
 #define AUDIOOUTPUTTHREAD_HPP
 
+#include <ffmpeg/audiooutputprofile.hpp>
+
+#include <QAudioFormat>
 #include <QThread>
 
 namespace Ffmpeg {
 
 class Frame;
 class AVContextInfo;
+struct AudioPlayback;
 
 class AudioOutputThread : public QThread
 {
@@ -16,12 +20,30 @@ public:
     ~AudioOutputThread() override;
 
     void openOutput(AVContextInfo *contextInfo, qreal volume);
+    // Switches to the codec of the next media, the sink is kept if the format is the same
+    void resetContextInfo(AVContextInfo *contextInfo);
     void closeOutput();
 
+    // Thread of the caller of openOutput(), converts the frame straight into the ring the
+    // sink pulls from. False while the ring has no room for it, nothing is written then.
+    // Tempo is what the frame was stretched by, media time per played time. The resampler
+    // plays the frame correction microseconds longer, shorter if negative.
+    auto write(const QSharedPointer<Ffmpeg::Frame> &framePtr,
+               double tempo = 1.0,
+               qint64 correction = 0) -> bool;
+
+    // What the device plays, measured every few milliseconds, any thread
+    [[nodiscard]] auto playback() const -> AudioPlayback;
+
+    // Any thread, a running sink restarts with the new profile
+    void setProfile(const AudioOutputProfile &profile);
+    [[nodiscard]] auto profile() const -> AudioOutputProfile;
+    [[nodiscard]] auto stats() const -> AudioOutputStats;
+
 signals:
-    void convertData(const QSharedPointer<Ffmpeg::Frame> &frameptr);
-    void wirteData();
     void volumeChanged(qreal value);
+    void formatChanged(const QAudioFormat &format);
+    void profileChanged(const Ffmpeg::AudioOutputProfile &profile);
 
 protected:
     void run() override;
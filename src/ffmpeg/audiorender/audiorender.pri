@@ -1,7 +1,9 @@
 HEADERS += \
     $$PWD/audiooutput.hpp \
-    $$PWD/audiooutputthread.hpp
+    $$PWD/audiooutputthread.hpp \
+    $$PWD/audioring.hpp
 
 SOURCES += \
     $$PWD/audiooutput.cc \
-    $$PWD/audiooutputthread.cc
+    $$PWD/audiooutputthread.cc \
+    $$PWD/audioring.cc
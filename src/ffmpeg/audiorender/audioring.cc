@@ -0,0 +1,126 @@
+#include "audioring.hpp"
+
+#include <cstring>
+
+namespace Ffmpeg {
+
+AudioRing::AudioRing()
+    : m_marks(s_maxMarks)
+{}
+
+void AudioRing::reset(const QAudioFormat &format)
+{
+    // Whole sample frames, a frame never wraps
+    auto capacity = qMax<qint64>(format.bytesPerFrame(), format.bytesForDuration(s_duration));
+    if (static_cast<qint64>(m_data.size()) != capacity) {
+        m_data = std::vector<char>(qMax<qint64>(1, capacity));
+    }
+    m_marks.reset();
+    m_markPending = false;
+    m_written.store(0, std::memory_order_relaxed);
+    m_read.store(0, std::memory_order_release);
+}
+
+auto AudioRing::capacity() const -> qint64
+{
+    return static_cast<qint64>(m_data.size());
+}
+
+auto AudioRing::freeBytes() const -> qint64
+{
+    return capacity() - size();
+}
+
+auto AudioRing::writeSpans() -> std::array<Span, 2>
+{
+    auto written = m_written.load(std::memory_order_relaxed);
+    auto free = capacity() - (written - m_read.load(std::memory_order_acquire));
+    auto offset = written % capacity();
+    auto first = qMin(free, capacity() - offset);
+    return {Span{m_data.data() + offset, first}, Span{m_data.data(), free - first}};
+}
+
+void AudioRing::commitWrite(qint64 bytes, const Mark &mark)
+{
+    // The mark is there before its samples can be read, unless the consumer lags behind
+    // taking them. Then the newest mark is held back and grows over the next frames.
+    if (m_markPending && m_marks.tryPush(Mark(m_pendingMark))) {
+        m_markPending = false;
+    }
+    if (!m_markPending) {
+        if (!m_marks.tryPush(Mark(mark))) {
+            m_pendingMark = mark;
+            m_markPending = true;
+        }
+    } else if (m_pendingMark.serial == mark.serial) {
+        m_pendingMark.end = mark.end;
+        m_pendingMark.duration += mark.duration;
+    } else {
+        m_pendingMark = mark;
+    }
+    m_written.fetch_add(bytes, std::memory_order_release);
+}
+
+auto AudioRing::read(char *data, qint64 maxSize) -> qint64
+{
+    auto read = m_read.load(std::memory_order_relaxed);
+    auto size = qMin(maxSize, m_written.load(std::memory_order_acquire) - read);
+    if (size <= 0) {
+        return 0;
+    }
+    auto offset = read % capacity();
+    auto first = qMin(size, capacity() - offset);
+    std::memcpy(data, m_data.data() + offset, first);
+    std::memcpy(data + first, m_data.data(), size - first);
+    m_read.store(read + size, std::memory_order_release);
+    return size;
+}
+
+auto AudioRing::takeMark(Mark &mark) -> bool
+{
+    return m_marks.tryPop(mark);
+}
+
+auto AudioRing::size() const -> qint64
+{
+    return m_written.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire);
+}
+
+auto AudioRing::writtenBytes() const -> qint64
+{
+    return m_written.load(std::memory_order_acquire);
+}
+
+auto AudioRing::readBytes() const -> qint64
+{
+    return m_read.load(std::memory_order_acquire);
+}
+
+AudioRingDevice::AudioRingDevice(AudioRing *ring, QObject *parent)
+    : QIODevice(parent)
+    , m_ring(ring)
+{}
+
+auto AudioRingDevice::isSequential() const -> bool
+{
+    return true;
+}
+
+auto AudioRingDevice::bytesAvailable() const -> qint64
+{
+    return m_ring->size() + QIODevice::bytesAvailable();
+}
+
+auto AudioRingDevice::readData(char *data, qint64 maxSize) -> qint64
+{
+    return m_ring->read(data, maxSize);
+}
+
+auto AudioRingDevice::writeData(const char *data, qint64 maxSize) -> qint64
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+} // namespace Ffmpeg
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <utils/spscring.hpp>
+
+#include <QAudioFormat>
+#include <QIODevice>
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace Ffmpeg {
+
+// Preallocated PCM ring between the audio display, which converts frames straight into it,
+// and the sink, which pulls on its own schedule. One producer and one consumer thread,
+// neither side takes a lock. Offsets count the bytes since the last reset().
+class AudioRing
+{
+    Q_DISABLE_COPY_MOVE(AudioRing);
+
+public:
+    struct Span
+    {
+        char *data = nullptr;
+        qint64 size = 0;
+    };
+
+    // Where the samples of one frame went
+    struct Mark
+    {
+        qint64 begin = 0;
+        qint64 end = 0;
+        qint64 pts = 0;      // microsecond
+        qint64 duration = 0; // microsecond
+        qint64 serial = 0;
+    };
+
+    AudioRing();
+
+    // Neither side may run, holds one second of the format
+    void reset(const QAudioFormat &format);
+    [[nodiscard]] auto capacity() const -> qint64;
+
+    // Producer, the free bytes, the second span continues at the start of the ring
+    [[nodiscard]] auto freeBytes() const -> qint64;
+    auto writeSpans() -> std::array<Span, 2>;
+    void commitWrite(qint64 bytes, const Mark &mark);
+
+    // Consumer
+    auto read(char *data, qint64 maxSize) -> qint64;
+    auto takeMark(Mark &mark) -> bool;
+
+    // Any thread
+    [[nodiscard]] auto size() const -> qint64;
+    [[nodiscard]] auto writtenBytes() const -> qint64;
+    [[nodiscard]] auto readBytes() const -> qint64;
+
+private:
+    static constexpr qint64 s_duration = 1000 * 1000; // microsecond
+    static constexpr int s_maxMarks = 1024;
+
+    std::vector<char> m_data;
+    Utils::SpscRing<Mark> m_marks;
+    // Producer only, the mark that did not fit into m_marks
+    Mark m_pendingMark;
+    bool m_markPending = false;
+
+    alignas(64) std::atomic<qint64> m_written = 0;
+    alignas(64) std::atomic<qint64> m_read = 0;
+};
+
+// Read only, sequential view of the ring for a sink in pull mode. An empty ring reads as
+// no data yet instead of the end.
+class AudioRingDevice : public QIODevice
+{
+public:
+    explicit AudioRingDevice(AudioRing *ring, QObject *parent = nullptr);
+
+    [[nodiscard]] auto isSequential() const -> bool override;
+    [[nodiscard]] auto bytesAvailable() const -> qint64 override;
+
+protected:
+    auto readData(char *data, qint64 maxSize) -> qint64 override;
+    auto writeData(const char *data, qint64 maxSize) -> qint64 override;
+
+private:
+    AudioRing *m_ring;
+};
+
+} // namespace Ffmpeg
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QtCore>
+
+namespace Ffmpeg {
+
+// How the audio heard keeps to a master clock of another stream
+struct AudioSyncStats
+{
+    qint64 drift = 0;            // heard ahead of the master, averaged, microsecond
+    qint64 maxDrift = 0;         // largest measured, either way, microsecond
+    qint64 compensated = 0;      // added by the resampler, negative if removed, microsecond
+    quint64 softCorrections = 0; // frames resampled to close a drift
+    quint64 hardCorrections = 0; // too late to resample, the frame was dropped
+};
+
+// Closes small drifts of the audio to the master by playing frames a little longer or
+// shorter. The drift is averaged over frames so a jittery measurement does not resample,
+// drifts within the dead zone are left alone and a frame changes by a bounded share of
+// its duration, so the pitch shift stays inaudible.
+class AudioDriftCompensator
+{
+public:
+    static constexpr qint64 s_deadZone = 10 * 1000;       // microsecond
+    static constexpr qint64 s_softThreshold = 100 * 1000; // microsecond, as the clock's
+    static constexpr int s_maxPercent = 10;
+
+    void reset()
+    {
+        m_drift = 0;
+        m_measured = false;
+    }
+
+    // return how much longer the frame of duration plays, shorter if negative, microsecond
+    auto update(qint64 drift, qint64 duration) -> qint64
+    {
+        m_drift = m_measured ? m_drift + (drift - m_drift) / 8 : drift;
+        m_measured = true;
+        if (qAbs(m_drift) <= s_deadZone || qAbs(drift) > s_softThreshold) {
+            return 0;
+        }
+        // Only what lies beyond the dead zone, the average lags and would overshoot
+        auto excess = m_drift > 0 ? m_drift - s_deadZone : m_drift + s_deadZone;
+        auto limit = duration * s_maxPercent / 100;
+        return qBound(-limit, excess, limit);
+    }
+
+    [[nodiscard]] auto drift() const -> qint64 { return m_drift; }
+
+private:
+    qint64 m_drift = 0;
+    bool m_measured = false;
+};
+
+} // namespace Ffmpeg
@@ -0,0 +1,135 @@
+#include "audiotempo.hpp"
+
+#include <filter/filter.hpp>
+
+#include <QDebug>
+
+extern "C" {
+#include <libavutil/mathematics.h>
+}
+
+namespace Ffmpeg {
+
+class AudioTempo::AudioTempoPrivate
+{
+public:
+    explicit AudioTempoPrivate(AudioTempo *q)
+        : q_ptr(q)
+    {}
+
+    // Same format and serial as the frames the graph was opened for
+    auto isSameStream(Frame *frame) -> bool
+    {
+        auto *avFrame = frame->avFrame();
+        return frame->serial() == serial && avFrame->sample_rate == sampleRate
+               && avFrame->format == sampleFormat
+               && avFrame->ch_layout.nb_channels == channels;
+    }
+
+    void open(Frame *frame, double value)
+    {
+        auto *avFrame = frame->avFrame();
+        filterPtr.reset(new Filter);
+        filterPtr->init(AVMEDIA_TYPE_AUDIO, frame);
+        filterPtr->config(Filter::atempo(value));
+        tempo = value;
+        serial = frame->serial();
+        sampleRate = avFrame->sample_rate;
+        sampleFormat = avFrame->format;
+        channels = avFrame->ch_layout.nb_channels;
+        position = frame->pts();
+        qInfo() << "Audio tempo:" << tempo;
+    }
+
+    void setTempo(double value)
+    {
+        if (value == tempo || !isSupported(value)) {
+            return;
+        }
+        if (filterPtr->sendCommand("atempo", "tempo", QString::number(value))) {
+            tempo = value;
+        }
+    }
+
+    auto filter(const FramePtr &framePtr) -> QVector<FramePtr>
+    {
+        auto *avFrame = framePtr->avFrame();
+        auto pts = framePtr->pts();
+        auto end = pts + av_rescale(avFrame->nb_samples, AV_TIME_BASE, sampleRate);
+        // The graph counts in samples
+        framePtr->setPts(av_rescale(pts, sampleRate, AV_TIME_BASE));
+        auto framePtrs = filterPtr->filterFrame(framePtr.data());
+        framePtr->setPts(pts);
+        for (const auto &outPtr : std::as_const(framePtrs)) {
+            auto duration = outPtr->avFrame()->nb_samples * tempo * AV_TIME_BASE / sampleRate;
+            outPtr->setPts(qRound64(position));
+            outPtr->setDuration(qRound64(duration));
+            outPtr->setSerial(serial);
+            position += duration;
+        }
+        // atempo holds a window of samples, an estimate drifting off that goes back to what
+        // went in
+        if (position > end || end - position > s_maxHeld) {
+            position = end;
+        }
+        return framePtrs;
+    }
+
+    static constexpr double s_minTempo = 0.5;
+    static constexpr double s_maxTempo = 100.0;
+    static constexpr qint64 s_maxHeld = 500 * 1000; // microsecond
+
+    AudioTempo *q_ptr;
+
+    QScopedPointer<Filter> filterPtr;
+    double tempo = 1.0;
+    qint64 serial = -1;
+    int sampleRate = 0;
+    int sampleFormat = -1;
+    int channels = 0;
+    double position = 0; // media time of the next frame out, microsecond
+};
+
+AudioTempo::AudioTempo(QObject *parent)
+    : QObject{parent}
+    , d_ptr(new AudioTempoPrivate(this))
+{}
+
+AudioTempo::~AudioTempo() = default;
+
+auto AudioTempo::isSupported(double tempo) -> bool
+{
+    return tempo >= AudioTempoPrivate::s_minTempo && tempo <= AudioTempoPrivate::s_maxTempo;
+}
+
+auto AudioTempo::process(const FramePtr &framePtr, double tempo) -> QVector<FramePtr>
+{
+    if (framePtr->avFrame()->sample_rate <= 0) {
+        return {framePtr};
+    }
+    if (!d_ptr->filterPtr.isNull() && !d_ptr->isSameStream(framePtr.data())) {
+        reset();
+    }
+    if (d_ptr->filterPtr.isNull()) {
+        if (tempo == 1.0 || !isSupported(tempo)) {
+            return {framePtr};
+        }
+        d_ptr->open(framePtr.data(), tempo);
+    }
+    d_ptr->setTempo(tempo);
+    return d_ptr->filter(framePtr);
+}
+
+auto AudioTempo::tempo() const -> double
+{
+    return d_ptr->tempo;
+}
+
+void AudioTempo::reset()
+{
+    d_ptr->filterPtr.reset();
+    d_ptr->tempo = 1.0;
+    d_ptr->serial = -1;
+}
+
+} // namespace Ffmpeg
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "frame.hpp"
+
+namespace Ffmpeg {
+
+// Time stretch between the audio decoder and the output, an atempo graph plays the frames
+// at the speed of the clock without changing their pitch. The frames it returns keep media
+// time: pts is where they start in the media, duration how much of it they cover.
+class AudioTempo : public QObject
+{
+public:
+    explicit AudioTempo(QObject *parent = nullptr);
+    ~AudioTempo() override;
+
+    // Tempos one atempo instance plays
+    static auto isSupported(double tempo) -> bool;
+
+    // Passes the frames through until another tempo than 1 comes. The graph then stays open
+    // for the format and the serial of the frames and a new tempo is sent to it.
+    auto process(const FramePtr &framePtr, double tempo) -> QVector<FramePtr>;
+    // What the returned frames were stretched by, media time per played time
+    [[nodiscard]] auto tempo() const -> double;
+
+    void reset();
+
+private:
+    class AudioTempoPrivate;
+    QScopedPointer<AudioTempoPrivate> d_ptr;
+};
+
+} // namespace Ffmpeg
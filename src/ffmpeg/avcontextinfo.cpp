@@ -23,8 +23,23 @@ class AVContextInfo::AVContextInfoPrivate
 public:
     explicit AVContextInfoPrivate(AVContextInfo *q)
         : q_ptr(q)
+        , framePool(s_framePoolCapacity, recycleFrame)
     {}
 
+    // Runs on the thread dropping the last reference, returns the buffers to the codec
+    static auto recycleFrame(Frame *frame) -> bool
+    {
+        if (frame->avFrame() == nullptr) {
+            return false;
+        }
+        frame->freeImageAlloc();
+        frame->unref();
+        frame->setSerial(0);
+        return true;
+    }
+
+    static constexpr size_t s_framePoolCapacity = 32;
+
     AVContextInfo *q_ptr;
 
     QScopedPointer<CodecContext> codecCtx; //解码器上下文
@@ -33,6 +48,7 @@ public:
     QScopedPointer<HardWareDecode> hardWareDecodePtr;
     QScopedPointer<HardWareEncode> hardWareEncodePtr;
     GpuType gpuType = GpuType::NotUseGpu;
+    Utils::ObjectPool<Frame> framePool;
 };
 
 AVContextInfo::AVContextInfo(QObject *parent)
@@ -47,6 +63,11 @@ auto AVContextInfo::codecCtx() -> CodecContext *
     return d_ptr->codecCtx.data();
 }
 
+auto AVContextInfo::framePoolStats() const -> FramePoolStats
+{
+    return d_ptr->framePool.stats();
+}
+
 void AVContextInfo::resetIndex()
 {
     d_ptr->streamIndex = INVALID_INDEX;
@@ -158,47 +179,61 @@ auto AVContextInfo::decodeFrame(const QSharedPointer<Packet> &packetPtr)
     -> std::vector<QSharedPointer<Frame>>
 {
     std::vector<FramePtr> framePtrs;
+    decodeFrame(packetPtr, [&](const FramePtr &framePtr) { framePtrs.push_back(framePtr); });
+    return framePtrs;
+}
+
+auto AVContextInfo::decodeFrame(const QSharedPointer<Packet> &packetPtr, const FrameSink &sink)
+    -> bool
+{
     if (!d_ptr->codecCtx->sendPacket(packetPtr.data())) {
-        return framePtrs;
+        return false;
     }
-    FramePtr framePtr(new Frame);
+    auto framePtr = d_ptr->framePool.acquire();
     while (d_ptr->codecCtx->receiveFrame(framePtr.data())) {
         framePtr->avFrame()->time_base = stream()->time_base;
         if (d_ptr->gpuType == GpuDecode && mediaType() == AVMEDIA_TYPE_VIDEO) {
             bool ok = false;
             framePtr = d_ptr->hardWareDecodePtr->transFromGpu(framePtr, ok);
             if (!ok) {
-                return framePtrs;
+                return true;
             }
         }
-        framePtrs.push_back(framePtr);
-        framePtr.reset(new Frame);
+        sink(framePtr);
+        framePtr = d_ptr->framePool.acquire();
     }
-    return framePtrs;
+    return true;
 }
 
 auto AVContextInfo::encodeFrame(const QSharedPointer<Frame> &framePtr)
     -> std::vector<QSharedPointer<Packet>>
 {
     std::vector<PacketPtr> packetPtrs{};
+    encodeFrame(framePtr, [&](const PacketPtr &packetPtr) { packetPtrs.push_back(packetPtr); });
+    return packetPtrs;
+}
+
+auto AVContextInfo::encodeFrame(const QSharedPointer<Frame> &framePtr, const PacketSink &sink)
+    -> bool
+{
     auto frame_tmp_ptr = framePtr;
     if (d_ptr->gpuType == GpuEncode && mediaType() == AVMEDIA_TYPE_VIDEO
         && framePtr->avFrame() != nullptr) {
         bool ok = false;
         frame_tmp_ptr = d_ptr->hardWareEncodePtr->transToGpu(d_ptr->codecCtx.data(), framePtr, ok);
         if (!ok) {
-            return packetPtrs;
+            return false;
         }
     }
     if (!d_ptr->codecCtx->sendFrame(frame_tmp_ptr.data())) {
-        return packetPtrs;
+        return false;
     }
     PacketPtr packetPtr(new Packet);
     while (d_ptr->codecCtx->receivePacket(packetPtr.get())) {
-        packetPtrs.push_back(packetPtr);
+        sink(packetPtr);
         packetPtr.reset(new Packet);
     }
-    return packetPtrs;
+    return true;
 }
 
 auto AVContextInfo::calTimebase() const -> double
@@ -5,6 +5,10 @@
 
 #include <QObject>
 
+#include <utils/objectpool.hpp>
+
+#include <functional>
+
 extern "C" {
 #include <libavcodec/codec.h>
 }
@@ -23,6 +27,10 @@ class FFMPEG_EXPORT AVContextInfo : public QObject
 public:
     enum GpuType { NotUseGpu, GpuDecode, GpuEncode };
 
+    using FrameSink = std::function<void(const QSharedPointer<Frame> &)>;
+    using PacketSink = std::function<void(const QSharedPointer<Packet> &)>;
+    using FramePoolStats = Utils::ObjectPool<Frame>::Stats;
+
     explicit AVContextInfo(QObject *parent = nullptr);
     ~AVContextInfo() override;
 
@@ -43,6 +51,9 @@ public:
     // sendPacket and receiveFrame
     auto decodeFrame(const QSharedPointer<Packet> &packetPtr) -> std::vector<QSharedPointer<Frame>>;
     auto encodeFrame(const QSharedPointer<Frame> &framePtr) -> std::vector<QSharedPointer<Packet>>;
+    // Hand every output to the sink without a temporary vector, false if sending failed
+    auto decodeFrame(const QSharedPointer<Packet> &packetPtr, const FrameSink &sink) -> bool;
+    auto encodeFrame(const QSharedPointer<Frame> &framePtr, const PacketSink &sink) -> bool;
     auto decodeSubtitle2(const QSharedPointer<Subtitle> &subtitlePtr,
                          const QSharedPointer<Packet> &packetPtr) -> bool;
 
@@ -60,6 +71,9 @@ public:
 
     auto codecCtx() -> CodecContext *;
 
+    // Decoded frames reuse the Frame and AVFrame shells released by the consumers
+    [[nodiscard]] auto framePoolStats() const -> FramePoolStats;
+
 private:
     class AVContextInfoPrivate;
     QScopedPointer<AVContextInfoPrivate> d_ptr;
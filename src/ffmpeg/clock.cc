@@ -1,7 +1,8 @@
 #include "clock.hpp"
 
+#include <utils/seqlock.hpp>
+
 #include <QDebug>
-#include <QMutex>
 
 extern "C" {
 #include <libavutil/time.h>
@@ -12,29 +13,74 @@ namespace Ffmpeg {
 class Clock::ClockPrivate
 {
 public:
+    struct State
+    {
+        qint64 pts = 0;          // 当前 AVFrame 的时间戳 microseconds
+        qint64 pts_drift = 0;    // 时钟漂移量，用于计算当前时钟的状态 microseconds
+        qint64 last_updated = 0; // 上一次更新时钟状态的时间 microseconds
+        qint64 serial = 0;       // 时钟序列号 for seek
+        bool paused = false;     // 是否暂停播放
+    };
+
     explicit ClockPrivate(Clock *q)
         : q_ptr(q)
     {}
 
     Clock *q_ptr;
 
-    mutable QMutex mutex;
-    qint64 pts = 0;          // 当前 AVFrame 的时间戳 microseconds
-    qint64 pts_drift = 0;    // 时钟漂移量，用于计算当前时钟的状态 microseconds
-    qint64 last_updated = 0; // 上一次更新时钟状态的时间 microseconds
-    qint64 serial = s_serial.load(); // 时钟序列号 for seek
-    bool paused = false;             // 是否暂停播放
+    // Written by the decoder owning the clock, read by the others without blocking it
+    Utils::SeqLock<State> state;
+    std::atomic<ClockDomain *> domain = nullptr;
 
-    static std::atomic<qint64> s_serial;
-    static std::atomic<double> s_speed;
     static constexpr auto s_diffThreshold = 100 * 1000; // 100 milliseconds
     // static constexpr auto s_diffThreshold = 200 * 1000; // 200 milliseconds
-    static Clock *s_clock;
 };
 
-std::atomic<qint64> Clock::ClockPrivate::s_serial = 0;
-std::atomic<double> Clock::ClockPrivate::s_speed = 1.0;
-Clock *Clock::ClockPrivate::s_clock = nullptr;
+void ClockDomain::serialRef()
+{
+    m_seekSerial.store(m_serial.fetch_add(1) + 1);
+}
+
+void ClockDomain::mediaSerialRef()
+{
+    m_serial.fetch_add(1);
+}
+
+void ClockDomain::serialReset()
+{
+    m_serial.store(0);
+    m_seekSerial.store(0);
+}
+
+auto ClockDomain::serial() const -> qint64
+{
+    return m_serial.load();
+}
+
+auto ClockDomain::isStale(qint64 serial) const -> bool
+{
+    return serial < m_seekSerial.load();
+}
+
+void ClockDomain::setSpeed(double value)
+{
+    m_speed.store(value);
+}
+
+auto ClockDomain::speed() const -> double
+{
+    return m_speed.load();
+}
+
+void ClockDomain::setMaster(Clock *clock)
+{
+    m_master.store(clock);
+}
+
+auto ClockDomain::master() const -> Clock *
+{
+    return m_master.load();
+}
 
 Clock::Clock(QObject *parent)
     : QObject{parent}
@@ -45,110 +91,135 @@ Clock::~Clock() = default;
 
 void Clock::reset(qint64 pts)
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    d_ptr->pts = pts;
-    d_ptr->pts_drift = 0;
-    d_ptr->last_updated = av_gettime_relative();
-    d_ptr->serial = Clock::ClockPrivate::s_serial.load();
-    d_ptr->paused = false;
+    auto serial = d_ptr->domain.load()->serial();
+    d_ptr->state.store({pts, 0, av_gettime_relative(), serial, false});
 }
 
 void Clock::invalidate()
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    d_ptr->last_updated = 0;
+    d_ptr->state.update([](ClockPrivate::State &state) { state.last_updated = 0; });
 }
 
 auto Clock::isVaild() const -> bool
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    return d_ptr->last_updated != 0;
+    return d_ptr->state.load().last_updated != 0;
 }
 
 auto Clock::pts() const -> qint64
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    return d_ptr->pts;
+    return d_ptr->state.load().pts;
 }
 
 auto Clock::ptsDrift() const -> qint64
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    return d_ptr->pts_drift;
+    return d_ptr->state.load().pts_drift;
 }
 
 auto Clock::lastUpdated() const -> qint64
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    return d_ptr->last_updated;
+    return d_ptr->state.load().last_updated;
 }
 
 void Clock::resetSerial()
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    d_ptr->serial = Clock::ClockPrivate::s_serial.load();
+    auto serial = d_ptr->domain.load()->serial();
+    d_ptr->state.update([serial](ClockPrivate::State &state) { state.serial = serial; });
 }
 
 auto Clock::serial() const -> qint64
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    return d_ptr->serial;
+    return d_ptr->state.load().serial;
 }
 
 auto Clock::paused() const -> bool
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    return d_ptr->paused;
+    return d_ptr->state.load().paused;
 }
 
 void Clock::setPaused(bool value)
 {
-    QMutexLocker locker(&d_ptr->mutex);
-    d_ptr->paused = value;
-    if (!d_ptr->paused) {
-        d_ptr->last_updated = 0;
-        d_ptr->pts_drift = 0;
-    }
+    d_ptr->state.update([value](ClockPrivate::State &state) {
+        state.paused = value;
+        if (!state.paused) {
+            state.last_updated = 0;
+            state.pts_drift = 0;
+        }
+    });
 }
 
 void Clock::update(qint64 pts, qint64 time)
 {
-    Q_ASSERT(Clock::ClockPrivate::s_clock);
-
-    QMutexLocker locker(&d_ptr->mutex);
-    if ((d_ptr->last_updated != 0) && !d_ptr->paused) {
-        if (this == Clock::ClockPrivate::s_clock
-            || Clock::ClockPrivate::s_clock->d_ptr->last_updated == 0) {
-            qint64 timediff = (time - d_ptr->last_updated) * speed();
-            d_ptr->pts_drift += pts - d_ptr->pts - timediff;
-        } else {
-            auto *masterClock = Clock::ClockPrivate::s_clock;
-            auto masterClockPts = masterClock->d_ptr->pts - masterClock->d_ptr->pts_drift;
-            qint64 timediff = (time - masterClock->d_ptr->last_updated) * speed();
-            d_ptr->pts_drift = pts - masterClockPts - timediff;
+    auto *domain = d_ptr->domain.load();
+    Q_ASSERT(domain && domain->master());
+
+    auto *masterClock = domain->master();
+    auto speed = domain->speed();
+    // One consistent copy of the master, taken before this clock is locked for writing
+    ClockPrivate::State master;
+    if (this != masterClock) {
+        master = masterClock->d_ptr->state.load();
+    }
+    d_ptr->state.update([&](ClockPrivate::State &state) {
+        if ((state.last_updated != 0) && !state.paused) {
+            // The master may already play the next media, or still the previous one
+            if (this == masterClock || master.last_updated == 0 || master.serial != state.serial) {
+                qint64 timediff = (time - state.last_updated) * speed;
+                state.pts_drift += pts - state.pts - timediff;
+            } else {
+                auto masterClockPts = master.pts - master.pts_drift;
+                qint64 timediff = (time - master.last_updated) * speed;
+                state.pts_drift = pts - masterClockPts - timediff;
+            }
         }
+        state.pts = pts;
+        state.last_updated = time;
+    });
+}
+
+void Clock::sync(qint64 pts, qint64 time)
+{
+    d_ptr->state.update([&](ClockPrivate::State &state) {
+        state.pts = pts;
+        state.pts_drift = 0;
+        state.last_updated = time;
+    });
+}
+
+auto Clock::position(qint64 time) const -> qint64
+{
+    auto state = d_ptr->state.load();
+    if (state.paused || state.last_updated == 0) {
+        return state.pts - state.pts_drift;
     }
-    d_ptr->pts = pts;
-    d_ptr->last_updated = time;
+    auto speed = d_ptr->domain.load()->speed();
+    return state.pts - state.pts_drift + static_cast<qint64>((time - state.last_updated) * speed);
 }
 
 auto Clock::getDelayWithMaster(qint64 &delay) const -> bool
 {
-    if (serial() != Clock::ClockPrivate::s_serial.load()) {
+    auto state = d_ptr->state.load();
+    if (d_ptr->domain.load()->isStale(state.serial)) {
         return false;
     }
-    delay = ptsDrift();
+    delay = state.pts_drift;
     return true;
 }
 
 auto Clock::adjustDelay(qint64 &delay) -> bool
 {
-    if (speed() > 1.0 && delay < 0) {
+    auto *domain = d_ptr->domain.load();
+    // The master clock keeps its frames, dropping them would not bring its drift back
+    if (domain->speed() > 1.0 && delay < 0 && this != domain->master()) {
         return false;
     }
     if (delay < -Clock::ClockPrivate::s_diffThreshold) {
-        reset(pts()); // 有可能是因为网络下载过慢导致的延迟，需要重置
-        if (this == Clock::ClockPrivate::s_clock) { // 主时钟不丢帧
+        // 有可能是因为网络下载过慢导致的延迟，需要重置, the serial is kept
+        d_ptr->state.update([](ClockPrivate::State &state) {
+            state.pts_drift = 0;
+            state.last_updated = av_gettime_relative();
+            state.paused = false;
+        });
+        if (this == domain->master()) { // 主时钟不丢帧
             delay = 0;
             return true;
         }
@@ -162,34 +233,16 @@ auto Clock::adjustDelay(qint64 &delay) -> bool
     return true;
 }
 
-void Clock::globalSerialRef()
-{
-    Clock::ClockPrivate::s_serial.fetch_add(1);
-}
-
-void Clock::globalSerialReset()
-{
-    Clock::ClockPrivate::s_serial.store(0);
-}
-
-void Clock::setSpeed(double value)
-{
-    Clock::ClockPrivate::s_speed.store(value);
-}
-
-auto Clock::speed() -> double
-{
-    return Clock::ClockPrivate::s_speed.load();
-}
-
-void Clock::setMaster(Clock *clock)
+void Clock::setDomain(ClockDomain *domain)
 {
-    Clock::ClockPrivate::s_clock = clock;
+    d_ptr->domain.store(domain);
+    auto serial = domain != nullptr ? domain->serial() : 0;
+    d_ptr->state.update([serial](ClockPrivate::State &state) { state.serial = serial; });
 }
 
-auto Clock::master() -> Clock *
+auto Clock::domain() const -> ClockDomain *
 {
-    return Clock::ClockPrivate::s_clock;
+    return d_ptr->domain.load();
 }
 
 } // namespace Ffmpeg
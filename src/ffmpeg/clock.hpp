@@ -1,11 +1,43 @@
 #ifndef CLOCK_HPP
 #define CLOCK_HPP
 
+#include "ffmepg_global.h"
+
 #include <QObject>
 
+#include <atomic>
+
 namespace Ffmpeg {
 
-class Clock : public QObject
+class Clock;
+
+// Master clock, speed and seek serial of one player, clocks only sync within their domain
+class FFMPEG_EXPORT ClockDomain
+{
+public:
+    // A seek, everything of the earlier serials is stale
+    void serialRef();
+    // The next media, the earlier serials stay valid and play out first
+    void mediaSerialRef();
+    void serialReset();
+    [[nodiscard]] auto serial() const -> qint64;
+    [[nodiscard]] auto isStale(qint64 serial) const -> bool;
+
+    void setSpeed(double value);
+    [[nodiscard]] auto speed() const -> double;
+
+    // not delete clock
+    void setMaster(Clock *clock);
+    [[nodiscard]] auto master() const -> Clock *;
+
+private:
+    std::atomic<qint64> m_serial = 0;
+    std::atomic<qint64> m_seekSerial = 0; // serials before it are stale
+    std::atomic<double> m_speed = 1.0;
+    std::atomic<Clock *> m_master = nullptr;
+};
+
+class FFMPEG_EXPORT Clock : public QObject
 {
 public:
     explicit Clock(QObject *parent = nullptr);
@@ -27,6 +59,11 @@ public:
     [[nodiscard]] auto paused() const -> bool;
 
     void update(qint64 pts, qint64 time);
+    // Anchors the clock at pts measured elsewhere, e.g. what the audio device plays,
+    // without keeping a drift
+    void sync(qint64 pts, qint64 time);
+    // Where the clock is at time, as the other clocks see it when it is the master
+    [[nodiscard]] auto position(qint64 time) const -> qint64;
 
     // return true if delay is valid
     auto getDelayWithMaster(qint64 &delay) const -> bool;
@@ -34,15 +71,9 @@ public:
     // return true if delay is valid
     auto adjustDelay(qint64 &delay) -> bool;
 
-    static void globalSerialRef();
-    static void globalSerialReset();
-
-    static void setSpeed(double value);
-    static auto speed() -> double;
-
-    // not thread safe and not delete clock
-    static void setMaster(Clock *clock);
-    static auto master() -> Clock *;
+    // Must be set before the clock is used
+    void setDomain(ClockDomain *domain);
+    [[nodiscard]] auto domain() const -> ClockDomain *;
 
 private:
     class ClockPrivate;
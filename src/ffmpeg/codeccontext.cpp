@@ -462,7 +462,8 @@ auto CodecContext::receiveFrame(Frame *frame) -> bool
         avFrame->ch_layout = d_ptr->codecCtx->ch_layout;
         return true;
     }
-    if (ret != AVERROR(EAGAIN)) { // Resource temporarily unavailable
+    // Resource temporarily unavailable, or a drained decoder
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
         SET_ERROR_CODE(ret);
     }
     return false;
@@ -515,4 +516,16 @@ void CodecContext::flush()
     avcodec_flush_buffers(d_ptr->codecCtx);
 }
 
+void CodecContext::setSkipFrame(AVDiscard skipFrame)
+{
+    Q_ASSERT(d_ptr->codecCtx != nullptr);
+    d_ptr->codecCtx->skip_frame = skipFrame;
+}
+
+auto CodecContext::skipFrame() const -> AVDiscard
+{
+    Q_ASSERT(d_ptr->codecCtx != nullptr);
+    return d_ptr->codecCtx->skip_frame;
+}
+
 } // namespace Ffmpeg
@@ -7,6 +7,7 @@
 
 extern "C" {
 #include <libavcodec/codec.h>
+#include <libavcodec/defs.h>
 }
 
 struct AVCodecParameters;
@@ -70,6 +71,10 @@ public:
 
     void flush();
 
+    // Decoder only, e.g. AVDISCARD_NONKEY decodes keyframes only
+    void setSkipFrame(AVDiscard skipFrame);
+    [[nodiscard]] auto skipFrame() const -> AVDiscard;
+
     auto avCodecCtx() -> AVCodecContext *;
 
 private:
@@ -1,15 +1,24 @@
 #ifndef DECODER_H
 #define DECODER_H
 
+#include <QDeadlineTimer>
+#include <QMutex>
 #include <QSharedPointer>
 #include <QThread>
+#include <QWaitCondition>
+
+#include <limits>
 
 #include <event/event.hpp>
 #include <utils/boundedblockingqueue.hpp>
+#include <utils/spscring.hpp>
 #include <utils/threadsafequeue.hpp>
 
 #include "avcontextinfo.h"
+#include "clock.hpp"
 #include "formatcontext.h"
+#include "packet.h"
+#include "queuepolicy.hpp"
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -17,10 +26,20 @@ extern "C" {
 
 namespace Ffmpeg {
 
-static constexpr auto s_waitQueueEmptyMilliseconds = 50;
 static constexpr auto s_videoQueueSize = 10;
-// For truehd audio, the queue size should be large enough
 static constexpr auto s_audioQueueSize = 200;
+// A queue of this many packets or more has no packet budget
+static constexpr size_t s_unlimitedPackets = std::numeric_limits<int>::max();
+
+// Every stage pair is single producer single consumer, FFMPEG_SPSC_QUEUE switches to the
+// lock free ring
+#ifdef FFMPEG_SPSC_QUEUE
+template<typename T>
+using DecoderQueue = Utils::SpscRing<T>;
+#else
+template<typename T>
+using DecoderQueue = Utils::BoundedBlockingQueue<T>;
+#endif
 
 template<typename T>
 class Decoder : public QThread
@@ -41,11 +60,20 @@ public:
         if (!m_contextInfo->isIndexVaild()) {
             return;
         }
-        if (m_contextInfo->stream()->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+        if constexpr (std::is_same_v<T, PacketPtr>) {
+            setPacketCostCallback(m_contextInfo->stream());
+        } else if (m_contextInfo->stream()->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
             m_queue.setMaxSize(s_audioQueueSize);
         } else {
             m_queue.setMaxSize(s_videoQueueSize);
         }
+        // Neither side runs here
+        m_queue.reset();
+        {
+            QMutexLocker locker(&m_finishMutex);
+            m_finished = false;
+            m_finishAborted = false;
+        }
         start();
     }
 
@@ -59,6 +87,32 @@ public:
             wait();
         }
         m_eventQueue.clear();
+        // Never reached by the items, the pointers must not outlive the retired media
+        switchMedia(std::numeric_limits<qint64>::max());
+    }
+
+    // The items of serial and later belong to the next media, the earlier ones still play
+    // with the current media. Both must have the stream or both not.
+    void setNextMedia(qint64 serial, FormatContext *formatContext, AVContextInfo *contextInfo)
+    {
+        QMutexLocker locker(&m_nextMutex);
+        if (!m_contextInfo->isIndexVaild()) {
+            // Not running, there is nothing to play out
+            m_formatContext = formatContext;
+            m_contextInfo = contextInfo;
+            return;
+        }
+        if constexpr (std::is_same_v<T, PacketPtr>) {
+            // Weighs the packets appended from now on, the queued ones keep their cost
+            setPacketCostCallback(contextInfo->stream());
+        }
+        m_nextMedias.append({serial, formatContext, contextInfo});
+    }
+
+    [[nodiscard]] auto isMediaChangePending() -> bool
+    {
+        QMutexLocker locker(&m_nextMutex);
+        return !m_nextMedias.isEmpty();
     }
 
     void append(const T &t)
@@ -69,24 +123,92 @@ public:
     void append(T &&t)
     {
         assertVaild();
-        m_queue.append(t);
+        m_queue.append(std::move(t));
     }
 
     auto size() -> size_t { return m_queue.size(); }
 
-    void clear() { m_queue.clear(); }
+    // Producer, queued behind the last item. Every stage hands it on once the items in
+    // front of it are done, see waitForFinished()
+    void appendEndOfStream()
+    {
+        assertVaild();
+        if (!m_contextInfo->isIndexVaild()) {
+            setFinished();
+            return;
+        }
+        {
+            QMutexLocker locker(&m_finishMutex);
+            m_finished = false;
+        }
+        m_queue.append(m_endOfStream);
+    }
 
-    void wakeup()
+    // True once this stage and the stages behind it have handled the end of stream,
+    // false on timeout or after wakeFinished()
+    virtual auto waitForFinished(QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever))
+        -> bool
     {
-        if (m_queue.empty()) {
-            m_queue.insertHead(T());
+        QMutexLocker locker(&m_finishMutex);
+        while (!m_finished && !m_finishAborted) {
+            if (!m_finishCondition.wait(&m_finishMutex, deadline)) {
+                break;
+            }
         }
+        return m_finished;
+    }
+
+    // Any thread, releases the waiters of waitForFinished(), e.g. on close
+    virtual void wakeFinished()
+    {
+        QMutexLocker locker(&m_finishMutex);
+        m_finishAborted = true;
+        m_finishCondition.wakeAll();
+    }
+
+    [[nodiscard]] auto isEndOfStream(const T &t) const -> bool { return t == m_endOfStream; }
+
+    // The clock domain of the owning player, set before the decoder starts
+    virtual void setClockDomain(ClockDomain *clockDomain) { m_clockDomain = clockDomain; }
+    [[nodiscard]] auto clockDomain() const -> ClockDomain * { return m_clockDomain; }
+
+    void setQueuePolicy(const QueuePolicy &policy)
+    {
+        // Unlimited, or more packets than the queue counts, is stored as its largest size
+        auto maxPackets = policy.maxPackets > 0 && policy.maxPackets < s_unlimitedPackets
+                              ? static_cast<int>(policy.maxPackets)
+                              : std::numeric_limits<int>::max();
+        m_queue.setMaxSize(maxPackets);
+        m_queue.setMaxBytes(qMax<qint64>(0, policy.maxBytes));
+        m_queue.setMaxDuration(qMax<qint64>(0, policy.maxDuration));
+    }
+
+    [[nodiscard]] auto queueStats() const -> QueueStats
+    {
+        QueueStats stats;
+        stats.packets = m_queue.size();
+        stats.bytes = m_queue.bytes();
+        stats.duration = m_queue.duration();
+        // Reads back as set, 0 for unlimited
+        auto maxPackets = m_queue.maxSize();
+        stats.policy.maxPackets = maxPackets < s_unlimitedPackets ? maxPackets : 0;
+        stats.policy.maxBytes = qMax<qint64>(0, m_queue.maxBytes());
+        stats.policy.maxDuration = qMax<qint64>(0, m_queue.maxDuration());
+        return stats;
     }
 
+    void clear() { m_queue.clear(); }
+
+    // The consumer's take() returns a null item once
+    void wakeup() { m_queue.interrupt(); }
+
     void addEvent(const EventPtr &event)
     {
-        if (!m_contextInfo->isIndexVaild()) {
-            return;
+        {
+            QMutexLocker locker(&m_nextMutex);
+            if (!m_contextInfo->isIndexVaild()) {
+                return;
+            }
         }
         m_eventQueue.append(event);
         wakeup();
@@ -95,6 +217,14 @@ public:
 protected:
     virtual void runDecoder() = 0;
 
+    // Consumer, the end of stream has passed this stage
+    void setFinished()
+    {
+        QMutexLocker locker(&m_finishMutex);
+        m_finished = true;
+        m_finishCondition.wakeAll();
+    }
+
     void run() final
     {
         assertVaild();
@@ -104,17 +234,77 @@ protected:
         runDecoder();
     }
 
+    // Called by the thread on the first item of a new serial, true if it switched the media
+    auto switchMedia(qint64 serial) -> bool
+    {
+        QMutexLocker locker(&m_nextMutex);
+        bool switched = false;
+        while (!m_nextMedias.isEmpty() && m_nextMedias.first().serial <= serial) {
+            auto next = m_nextMedias.takeFirst();
+            m_formatContext = next.formatContext;
+            m_contextInfo = next.contextInfo;
+            switched = true;
+        }
+        return switched;
+    }
+
+    void setPacketCostCallback(AVStream *stream)
+    {
+        auto timeBase = stream->time_base;
+        // Some video packets have no duration, fall back to the frame interval
+        auto frameDuration = 0LL;
+        if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && stream->avg_frame_rate.num > 0) {
+            frameDuration = av_rescale_q(1, av_inv_q(stream->avg_frame_rate), AV_TIME_BASE_Q);
+        }
+        m_queue.setCostCallback([timeBase, frameDuration, endOfStream = m_endOfStream](
+                                    const PacketPtr &packetPtr) {
+            typename DecoderQueue<T>::Cost cost;
+            // The end of stream marker weighs nothing
+            if (packetPtr.isNull() || packetPtr == endOfStream) {
+                return cost;
+            }
+            auto *avPacket = packetPtr->avPacket();
+            cost.bytes = avPacket->size;
+            cost.duration = avPacket->duration > 0
+                                ? av_rescale_q(avPacket->duration, timeBase, AV_TIME_BASE_Q)
+                                : frameDuration;
+            return cost;
+        });
+    }
+
     void assertVaild()
     {
         Q_ASSERT(m_formatContext != nullptr);
         Q_ASSERT(m_contextInfo != nullptr);
+        Q_ASSERT(m_clockDomain != nullptr);
     }
 
-    Utils::BoundedBlockingQueue<T> m_queue;
+    DecoderQueue<T> m_queue;
     Utils::ThreadSafeQueue<EventPtr> m_eventQueue;
     AVContextInfo *m_contextInfo = nullptr;
     FormatContext *m_formatContext = nullptr;
+    ClockDomain *m_clockDomain = nullptr;
     std::atomic_bool m_runing = true;
+
+    QMutex m_finishMutex;
+    QWaitCondition m_finishCondition;
+    bool m_finished = false;
+    bool m_finishAborted = false;
+
+private:
+    struct NextMedia
+    {
+        qint64 serial;
+        FormatContext *formatContext;
+        AVContextInfo *contextInfo;
+    };
+
+    // Also guards m_contextInfo against readers on other threads
+    QMutex m_nextMutex;
+    QList<NextMedia> m_nextMedias;
+
+    // The end of stream marker of this queue, never decoded, rendered or given to a pool
+    const T m_endOfStream = T(new typename T::Type);
 };
 
 } // namespace Ffmpeg
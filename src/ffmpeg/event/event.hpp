@@ -18,6 +18,9 @@ public:
         MediaState,
         CacheSpeed,
         SeekChanged,
+        SeekLanded,
+        OpenProgress,
+        MediaChanged,
         PreviewFramesChanged,
         AVError,
         Error
@@ -58,7 +61,9 @@ public:
 
         Pause = 100,
         Seek,
-        SeekRelative
+        SeekRelative,
+        StepFrame,
+        Reverse
     };
     Q_ENUM(EventType);
 
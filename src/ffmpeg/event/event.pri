@@ -1,6 +1,10 @@
 HEADERS += \
     $$PWD/errorevent.hpp \
     $$PWD/event.hpp \
+    $$PWD/propertychannel.hpp \
     $$PWD/seekevent.hpp \
     $$PWD/trackevent.hpp \
     $$PWD/valueevent.hpp
+
+SOURCES += \
+    $$PWD/propertychannel.cc
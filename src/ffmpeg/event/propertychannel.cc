@@ -0,0 +1,150 @@
+#include "propertychannel.hpp"
+
+#include <utils/threadsafequeue.hpp>
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <atomic>
+
+namespace Ffmpeg {
+
+class PropertyChannel::PropertyChannelPrivate
+{
+public:
+    explicit PropertyChannelPrivate(PropertyChannel *q)
+        : q_ptr(q)
+    {
+        timer = new QTimer(q_ptr);
+        timer->setSingleShot(true);
+        timer->setTimerType(Qt::PreciseTimer);
+        QObject::connect(timer, &QTimer::timeout, q_ptr, [this] { notify(); });
+    }
+
+    // Any thread, only the first change of a batch posts to the owner thread
+    void markChanged(quint32 property)
+    {
+        changed.fetch_or(property, std::memory_order_release);
+        if (notifyPending.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        QMetaObject::invokeMethod(q_ptr, [this] { schedule(); }, Qt::QueuedConnection);
+    }
+
+    void schedule()
+    {
+        auto remaining = elapsedTimer.isValid() ? notifyInterval.load() - elapsedTimer.elapsed() : 0;
+        if (remaining > 0) {
+            timer->start(static_cast<int>(remaining));
+            return;
+        }
+        notify();
+    }
+
+    void notify()
+    {
+        // A change during the emit posts the next batch
+        notifyPending.store(false, std::memory_order_release);
+        elapsedTimer.restart();
+        emit q_ptr->changed();
+    }
+
+    PropertyChannel *q_ptr;
+
+    std::atomic<qint64> position = 0;
+    std::atomic<qint64> cacheSpeed = 0;
+    std::atomic<double> fps = 0;
+    std::atomic<MediaState> mediaState = MediaState::Stopped;
+    std::atomic<quint32> changed = 0;
+
+    Utils::ThreadSafeQueue<PropertyChangeEventPtr> eventQueue;
+    std::atomic<size_t> maxEventSize = 100;
+
+    std::atomic_bool notifyPending = false;
+    std::atomic<qint64> notifyInterval = 16; // millisecond
+    QElapsedTimer elapsedTimer;
+    QTimer *timer;
+};
+
+PropertyChannel::PropertyChannel(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new PropertyChannelPrivate(this))
+{}
+
+PropertyChannel::~PropertyChannel() = default;
+
+void PropertyChannel::setPosition(qint64 position)
+{
+    d_ptr->position.store(position, std::memory_order_relaxed);
+    d_ptr->markChanged(Position);
+}
+
+void PropertyChannel::setCacheSpeed(qint64 speed)
+{
+    d_ptr->cacheSpeed.store(speed, std::memory_order_relaxed);
+    d_ptr->markChanged(CacheSpeed);
+}
+
+void PropertyChannel::setFps(double fps)
+{
+    d_ptr->fps.store(fps, std::memory_order_relaxed);
+    d_ptr->markChanged(Fps);
+}
+
+void PropertyChannel::setMediaState(MediaState state)
+{
+    d_ptr->mediaState.store(state, std::memory_order_relaxed);
+    d_ptr->markChanged(State);
+}
+
+void PropertyChannel::addEvent(PropertyChangeEvent *event)
+{
+    d_ptr->eventQueue.append(PropertyChangeEventPtr(event));
+    while (d_ptr->eventQueue.size() > d_ptr->maxEventSize.load()) {
+        d_ptr->eventQueue.take();
+    }
+    d_ptr->markChanged(0);
+}
+
+auto PropertyChannel::takeSnapshot() -> Snapshot
+{
+    Snapshot snapshot;
+    snapshot.changed = Properties::fromInt(d_ptr->changed.exchange(0, std::memory_order_acquire));
+    snapshot.position = d_ptr->position.load(std::memory_order_relaxed);
+    snapshot.cacheSpeed = d_ptr->cacheSpeed.load(std::memory_order_relaxed);
+    snapshot.fps = d_ptr->fps.load(std::memory_order_relaxed);
+    snapshot.mediaState = d_ptr->mediaState.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+auto PropertyChannel::eventSize() const -> size_t
+{
+    return d_ptr->eventQueue.size();
+}
+
+auto PropertyChannel::takeEvent() -> PropertyChangeEventPtr
+{
+    return d_ptr->eventQueue.take();
+}
+
+void PropertyChannel::setMaxEventSize(size_t size)
+{
+    d_ptr->maxEventSize.store(size);
+}
+
+auto PropertyChannel::maxEventSize() const -> size_t
+{
+    return d_ptr->maxEventSize.load();
+}
+
+void PropertyChannel::setNotifyInterval(int msec)
+{
+    d_ptr->notifyInterval.store(qMax(0, msec));
+}
+
+auto PropertyChannel::notifyInterval() const -> int
+{
+    return static_cast<int>(d_ptr->notifyInterval.load());
+}
+
+} // namespace Ffmpeg
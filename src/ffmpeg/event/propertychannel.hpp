@@ -0,0 +1,67 @@
+#pragma once
+
+#include "event.hpp"
+
+#include <ffmpeg/mediainfo.hpp>
+
+namespace Ffmpeg {
+
+// State of a player or transcoder for the thread the channel lives in.
+// Position, cache speed, fps and media state are last value wins slots, writing them
+// never allocates. The other changes are discrete events in a bounded queue.
+// changed() is emitted at most once per notify interval.
+class FFMPEG_EXPORT PropertyChannel : public QObject
+{
+    Q_OBJECT
+public:
+    enum Property : quint32 {
+        Position = 0x1,
+        CacheSpeed = 0x2,
+        Fps = 0x4,
+        State = 0x8,
+    };
+    Q_DECLARE_FLAGS(Properties, Property)
+
+    struct Snapshot
+    {
+        Properties changed; // slots written since the last snapshot
+        qint64 position = 0; // microsecond
+        qint64 cacheSpeed = 0;
+        double fps = 0;
+        MediaState mediaState = MediaState::Stopped;
+    };
+
+    explicit PropertyChannel(QObject *parent = nullptr);
+    ~PropertyChannel() override;
+
+    // Any thread
+    void setPosition(qint64 position);
+    void setCacheSpeed(qint64 speed);
+    void setFps(double fps);
+    void setMediaState(MediaState state);
+    // Takes the event, the oldest ones are dropped when the queue is full
+    void addEvent(PropertyChangeEvent *event);
+
+    auto takeSnapshot() -> Snapshot;
+
+    [[nodiscard]] auto eventSize() const -> size_t;
+    auto takeEvent() -> PropertyChangeEventPtr;
+
+    void setMaxEventSize(size_t size);
+    [[nodiscard]] auto maxEventSize() const -> size_t;
+
+    // One UI frame by default
+    void setNotifyInterval(int msec);
+    [[nodiscard]] auto notifyInterval() const -> int;
+
+signals:
+    void changed();
+
+private:
+    class PropertyChannelPrivate;
+    QScopedPointer<PropertyChannelPrivate> d_ptr;
+};
+
+} // namespace Ffmpeg
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(Ffmpeg::PropertyChannel::Properties)
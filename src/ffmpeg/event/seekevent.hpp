@@ -2,39 +2,57 @@
 
 #include "event.hpp"
 
-#include <utils/countdownlatch.hpp>
+#include <QElapsedTimer>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
 
 namespace Ffmpeg {
 
+enum class SeekMode {
+    Fast,  // land on the keyframe before the position
+    Exact, // decode and discard until the position
+    Scrub  // like Fast, but only keyframes are decoded until the next non scrub seek
+};
+
 class FFMPEG_EXPORT SeekEvent : public Event
 {
 public:
-    explicit SeekEvent(qint64 position, QObject *parent = nullptr)
+    explicit SeekEvent(qint64 position, SeekMode mode = SeekMode::Fast, QObject *parent = nullptr)
         : Event(parent)
         , m_position(position)
-        , m_latch(0)
-    {}
+        , m_mode(mode)
+    {
+        m_timer.start();
+    }
 
     [[nodiscard]] auto type() const -> EventType override { return EventType::Seek; }
 
     void setPosition(qint64 position) { m_position = position; }
     [[nodiscard]] auto position() const -> qint64 { return m_position; }
 
-    void setWaitCountdown(int count) { m_latch.setCount(count); }
-    void countDown() { m_latch.countDown(); }
-    void wait() { m_latch.wait(); }
+    void setMode(SeekMode mode) { m_mode = mode; }
+    [[nodiscard]] auto mode() const -> SeekMode { return m_mode; }
+
+    // millisecond since the event was created
+    [[nodiscard]] auto elapsed() const -> qint64 { return m_timer.elapsed(); }
 
 private:
     qint64 m_position = 0;
-    Utils::CountDownLatch m_latch;
+    SeekMode m_mode = SeekMode::Fast;
+    QElapsedTimer m_timer;
 };
 
 class FFMPEG_EXPORT SeekRelativeEvent : public Event
 {
 public:
-    explicit SeekRelativeEvent(qint64 relativePosition, QObject *parent = nullptr)
+    explicit SeekRelativeEvent(qint64 relativePosition,
+                               SeekMode mode = SeekMode::Fast,
+                               QObject *parent = nullptr)
         : Event(parent)
         , m_relativePosition(relativePosition)
+        , m_mode(mode)
     {}
 
     [[nodiscard]] auto type() const -> EventType override { return EventType::SeekRelative; }
@@ -43,8 +61,48 @@ public:
     void setRelativePosition(qint64 relativePosition) { m_relativePosition = relativePosition; }
     [[nodiscard]] auto relativePosition() const -> qint64 { return m_relativePosition; }
 
+    void setMode(SeekMode mode) { m_mode = mode; }
+    [[nodiscard]] auto mode() const -> SeekMode { return m_mode; }
+
 private:
     qint64 m_relativePosition = 0;
+    SeekMode m_mode = SeekMode::Fast;
+};
+
+// Pauses and shows the frame right after or before the current one
+class FFMPEG_EXPORT StepFrameEvent : public Event
+{
+public:
+    explicit StepFrameEvent(bool forward = true, QObject *parent = nullptr)
+        : Event(parent)
+        , m_forward(forward)
+    {}
+
+    [[nodiscard]] auto type() const -> EventType override { return EventType::StepFrame; }
+
+    void setForward(bool forward) { m_forward = forward; }
+    [[nodiscard]] auto forward() const -> bool { return m_forward; }
+
+private:
+    bool m_forward = true;
+};
+
+// Plays backwards at the current speed with the audio muted, until turned off
+class FFMPEG_EXPORT ReverseEvent : public Event
+{
+public:
+    explicit ReverseEvent(bool reverse, QObject *parent = nullptr)
+        : Event(parent)
+        , m_reverse(reverse)
+    {}
+
+    [[nodiscard]] auto type() const -> EventType override { return EventType::Reverse; }
+
+    void setReverse(bool reverse) { m_reverse = reverse; }
+    [[nodiscard]] auto reverse() const -> bool { return m_reverse; }
+
+private:
+    bool m_reverse = false;
 };
 
 class FFMPEG_EXPORT SeekChangedEvent : public PropertyChangeEvent
@@ -64,4 +122,40 @@ private:
     qint64 m_position = 0;
 };
 
+class FFMPEG_EXPORT SeekLandedEvent : public PropertyChangeEvent
+{
+public:
+    explicit SeekLandedEvent(AVMediaType mediaType,
+                             SeekMode mode,
+                             qint64 target,
+                             qint64 position,
+                             qint64 latency,
+                             QObject *parent = nullptr)
+        : PropertyChangeEvent(parent)
+        , m_mediaType(mediaType)
+        , m_mode(mode)
+        , m_target(target)
+        , m_position(position)
+        , m_latency(latency)
+    {}
+
+    [[nodiscard]] auto type() const -> EventType override { return EventType::SeekLanded; }
+
+    [[nodiscard]] auto mediaType() const -> AVMediaType { return m_mediaType; }
+    [[nodiscard]] auto mode() const -> SeekMode { return m_mode; }
+    // microsecond
+    [[nodiscard]] auto target() const -> qint64 { return m_target; }
+    [[nodiscard]] auto position() const -> qint64 { return m_position; }
+    [[nodiscard]] auto error() const -> qint64 { return m_position - m_target; }
+    // millisecond
+    [[nodiscard]] auto latency() const -> qint64 { return m_latency; }
+
+private:
+    AVMediaType m_mediaType = AVMEDIA_TYPE_UNKNOWN;
+    SeekMode m_mode = SeekMode::Fast;
+    qint64 m_target = 0;
+    qint64 m_position = 0;
+    qint64 m_latency = 0;
+};
+
 } // namespace Ffmpeg
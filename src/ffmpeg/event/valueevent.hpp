@@ -57,6 +57,49 @@ private:
     Ffmpeg::MediaState m_state = Ffmpeg::MediaState::Stopped;
 };
 
+class FFMPEG_EXPORT OpenProgressEvent : public PropertyChangeEvent
+{
+public:
+    enum Stage { Opening, Probing, Opened, Failed };
+
+    explicit OpenProgressEvent(Stage stage, qint64 elapsed, QObject *parent = nullptr)
+        : PropertyChangeEvent(parent)
+        , m_stage(stage)
+        , m_elapsed(elapsed)
+    {}
+
+    [[nodiscard]] auto type() const -> EventType override { return EventType::OpenProgress; }
+
+    void setStage(Stage stage) { m_stage = stage; }
+    [[nodiscard]] auto stage() const -> Stage { return m_stage; }
+
+    // millisecond since the open started
+    void setElapsed(qint64 elapsed) { m_elapsed = elapsed; }
+    [[nodiscard]] auto elapsed() const -> qint64 { return m_elapsed; }
+
+private:
+    Stage m_stage = Opening;
+    qint64 m_elapsed = 0;
+};
+
+// The player went on to the next media without stopping
+class FFMPEG_EXPORT MediaChangedEvent : public PropertyChangeEvent
+{
+public:
+    explicit MediaChangedEvent(const QString &filepath, QObject *parent = nullptr)
+        : PropertyChangeEvent(parent)
+        , m_filepath(filepath)
+    {}
+
+    [[nodiscard]] auto type() const -> EventType override { return EventType::MediaChanged; }
+
+    void setFilepath(const QString &filepath) { m_filepath = filepath; }
+    [[nodiscard]] auto filepath() const -> QString { return m_filepath; }
+
+private:
+    QString m_filepath;
+};
+
 class FFMPEG_EXPORT CacheSpeedEvent : public PropertyChangeEvent
 {
 public:
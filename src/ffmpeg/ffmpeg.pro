@@ -11,6 +11,8 @@ include(widgets/widgets.pri)
 QT += widgets multimedia openglwidgets
 
 DEFINES += FFMPEG_LIBRARY
+# qmake CONFIG+=spsc_queue
+spsc_queue: DEFINES += FFMPEG_SPSC_QUEUE
 TARGET = $$replaceLibName(ffmpeg)
 
 LIBS += \
@@ -22,6 +24,7 @@ SOURCES += \
     audiodisplay.cc \
     audiofifo.cc \
     audioframeconverter.cpp \
+    audiotempo.cc \
     avcontextinfo.cpp \
     averror.cpp \
     averrormanager.cc \
@@ -33,11 +36,14 @@ SOURCES += \
     ffmpegutils.cc \
     formatcontext.cpp \
     frame.cc \
+    gopcache.cc \
     hdrmetadata.cc \
+    keyframeindex.cc \
     mediainfo.cc \
     packet.cpp \
     player.cpp \
     previewtask.cc \
+    probecache.cc \
     subtitle.cpp \
     subtitledecoder.cpp \
     subtitledisplay.cc \
@@ -53,6 +59,9 @@ HEADERS += \
     audiodisplay.hpp \
     audiofifo.hpp \
     audioframeconverter.h \
+    audiooutputprofile.hpp \
+    audiosync.hpp \
+    audiotempo.hpp \
     avcontextinfo.h \
     averror.h \
     averrormanager.hpp \
@@ -65,11 +74,16 @@ HEADERS += \
     ffmpegutils.hpp \
     formatcontext.h \
     frame.hpp \
+    frameskip.hpp \
+    gopcache.hpp \
     hdrmetadata.hpp \
+    keyframeindex.hpp \
     mediainfo.hpp \
     packet.h \
     player.h \
     previewtask.hpp \
+    probecache.hpp \
+    queuepolicy.hpp \
     subtitle.h \
     subtitledecoder.h \
     subtitledisplay.hpp \
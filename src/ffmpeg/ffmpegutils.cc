@@ -108,8 +108,9 @@ void printFfmpegInfo()
 
 auto getCurrentHWDeviceTypes() -> QVector<AVHWDeviceType>
 {
-    static QVector<AVHWDeviceType> types{};
-    if (types.isEmpty()) {
+    // Players open codecs from their own threads
+    static const QVector<AVHWDeviceType> types = [] {
+        QVector<AVHWDeviceType> types;
         auto type = AV_HWDEVICE_TYPE_NONE; // ffmpeg支持的硬件解码器
         QStringList list;
         while ((type = av_hwdevice_iterate_types(type)) != AV_HWDEVICE_TYPE_NONE) {
@@ -120,7 +121,8 @@ auto getCurrentHWDeviceTypes() -> QVector<AVHWDeviceType>
             }
         }
         qInfo() << QObject::tr("Current hardware decoders: ") << list;
-    }
+        return types;
+    }();
     return types;
 }
 
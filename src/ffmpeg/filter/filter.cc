@@ -148,6 +148,12 @@ auto Filter::filterFrame(Frame *frame) -> QVector<FramePtr>
     return framepPtrs;
 }
 
+auto Filter::sendCommand(const QString &target, const QString &command, const QString &arg)
+    -> bool
+{
+    return d_ptr->filterGraph->sendCommand(target, command, arg);
+}
+
 auto Filter::buffersinkCtx() -> FilterContext *
 {
     Q_ASSERT(d_ptr->buffersinkCtx);
@@ -173,6 +179,11 @@ auto Filter::hue(int value) -> QString
     return QString("hue=%1").arg(QString::number(value));
 }
 
+auto Filter::atempo(double tempo) -> QString
+{
+    return QString("atempo=tempo=%1").arg(QString::number(tempo));
+}
+
 // need z.lib libzimg support zscale
 auto Filter::zscale(ColorUtils::Primaries::Type destPrimaries, ToneMapping::Type type) -> QString
 {
@@ -32,11 +32,15 @@ public:
 
     auto filterFrame(Frame *frame) -> QVector<QSharedPointer<Frame>>;
 
+    // Reconfigures a running filter without reopening the graph, e.g. atempo's tempo
+    auto sendCommand(const QString &target, const QString &command, const QString &arg) -> bool;
+
     auto buffersinkCtx() -> FilterContext *;
 
     static auto scale(const QSize &size) -> QString;
     static auto eq(const MediaConfig::Equalizer &equalizer) -> QString;
     static auto hue(int value) -> QString;
+    static auto atempo(double tempo) -> QString;
     static auto zscale(ColorUtils::Primaries::Type destPrimaries, ToneMapping::Type type) -> QString;
 
 private:
@@ -59,6 +59,19 @@ auto FilterGraph::config() -> bool
     ERROR_RETURN(ret)
 }
 
+auto FilterGraph::sendCommand(const QString &target, const QString &command, const QString &arg)
+    -> bool
+{
+    auto ret = avfilter_graph_send_command(d_ptr->filterGraph,
+                                           target.toUtf8().constData(),
+                                           command.toUtf8().constData(),
+                                           arg.toUtf8().constData(),
+                                           nullptr,
+                                           0,
+                                           0);
+    ERROR_RETURN(ret)
+}
+
 auto FilterGraph::avFilterGraph() -> AVFilterGraph *
 {
     return d_ptr->filterGraph;
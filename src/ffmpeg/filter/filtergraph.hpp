@@ -18,6 +18,9 @@ public:
 
     auto config() -> bool;
 
+    // Changes an option of a configured graph in place, target is a filter or instance name
+    auto sendCommand(const QString &target, const QString &command, const QString &arg) -> bool;
+
     auto avFilterGraph() -> AVFilterGraph *;
 
 private:
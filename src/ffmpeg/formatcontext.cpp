@@ -2,7 +2,9 @@
 #include "averrormanager.hpp"
 #include "ffmpegutils.hpp"
 #include "packet.h"
+#include "probecache.hpp"
 
+#include <QDeadlineTimer>
 #include <QDebug>
 #include <QImage>
 #include <QTime>
@@ -74,18 +76,99 @@ public:
         return av_find_best_stream(formatCtx, type, -1, -1, nullptr, 0);
     }
 
+    [[nodiscard]] auto seekByBytes() const -> bool
+    {
+        const auto *iformat = formatCtx->iformat;
+        return (iformat->flags & AVFMT_NO_BYTE_SEEK) == 0 && (iformat->flags & AVFMT_TS_DISCONT) != 0
+               && strcmp("ogg", iformat->name) != 0;
+    }
+
+    // Lands on the last indexed keyframe before timestamp, false if the index can not help
+    // Backward lands on the keyframe at or before timestamp, forward on the one at or after
+    auto seekKeyframe(qint64 timestamp, bool forward = false) -> bool
+    {
+        if (keyframeIndex.isNull() || !keyframeIndex->isComplete()) {
+            return false;
+        }
+        KeyframeIndex::Entry entry;
+        if (forward ? !keyframeIndex->findKeyframeAfter(timestamp, entry)
+                    : !keyframeIndex->findKeyframe(timestamp, entry)) {
+            return false;
+        }
+        int ret = 0;
+        if (entry.pos >= 0 && seekByBytes()) {
+            ret = avformat_seek_file(formatCtx, -1, entry.pos, entry.pos, entry.pos, AVSEEK_FLAG_BYTE);
+        } else if (forward) {
+            ret = avformat_seek_file(formatCtx, -1, timestamp, entry.pts, entry.pts, 0);
+        } else {
+            ret = avformat_seek_file(formatCtx, -1, entry.pts, entry.pts, timestamp, 0);
+        }
+        return ret >= 0;
+    }
+
+    static auto interruptCallback(void *opaque) -> int
+    {
+        auto *d = static_cast<FormatContextPrivate *>(opaque);
+        if (d->isAborted() || d->deadline.hasExpired()) {
+            d->interrupted = true;
+            return 1;
+        }
+        return 0;
+    }
+
+    [[nodiscard]] auto isAborted() const -> bool
+    {
+        return interruptCallback && interruptCallback();
+    }
+
+    void startOperation(qint64 timeout)
+    {
+        interrupted = false;
+        deadline = timeout > 0 ? QDeadlineTimer(timeout) : QDeadlineTimer(QDeadlineTimer::Forever);
+    }
+
+    auto openInput(const QByteArray &inpuUrl, bool fast) -> int
+    {
+        formatCtx = avformat_alloc_context();
+        formatCtx->interrupt_callback.callback = &FormatContextPrivate::interruptCallback;
+        formatCtx->interrupt_callback.opaque = this;
+        startOperation(timeouts.open);
+
+        AVDictionary *options = nullptr;
+        if (fast) {
+            av_dict_set_int(&options, "probesize", s_fastProbeSize, 0);
+            av_dict_set_int(&options, "analyzeduration", s_fastAnalyzeDuration, 0);
+        }
+        auto ret = avformat_open_input(&formatCtx, inpuUrl.constData(), nullptr, &options);
+        av_dict_free(&options);
+        fastOpened = ret == 0 && fast;
+        return ret;
+    }
+
+    static constexpr qint64 s_fastProbeSize = 256 * 1024;
+    static constexpr qint64 s_fastAnalyzeDuration = AV_TIME_BASE / 2;
+
     FormatContext *q_ptr;
 
     AVFormatContext *formatCtx = nullptr;
     QString filepath;
     FormatContext::OpenMode mode = FormatContext::ReadOnly;
     bool isOpen = false;
+    bool fastOpened = false;
+    bool probeCached = false;
 
     StreamInfos audioTracks;
     StreamInfos videoTracks;
     StreamInfos subtitleTracks;
     StreamInfos attachmentTracks;
 
+    KeyframeIndexPtr keyframeIndex;
+
+    FormatContext::Timeouts timeouts;
+    std::function<bool()> interruptCallback;
+    QDeadlineTimer deadline{QDeadlineTimer::Forever};
+    std::atomic_bool interrupted = false;
+
     const qint64 seekOffset = 2 * AV_TIME_BASE;
 };
 
@@ -154,7 +237,10 @@ auto FormatContext::openFilePath(const QString &filepath, OpenMode mode) -> bool
     auto inpuUrl = convertUrlToFfmpegInput(d_ptr->filepath);
     switch (mode) {
     case ReadOnly: {
-        auto ret = avformat_open_input(&d_ptr->formatCtx, inpuUrl.constData(), nullptr, nullptr);
+        // Looked up once per open, findStream() reuses the result
+        d_ptr->probeCached = ProbeCache::instance()->contains(d_ptr->filepath);
+        auto ret = d_ptr->openInput(inpuUrl,
+                                    d_ptr->probeCached && ProbeCache::instance()->isFastOpen());
         if (ret != 0) {
             SET_ERROR_CODE(ret);
             return false;
@@ -186,6 +272,7 @@ void FormatContext::close()
     }
     switch (d_ptr->mode) {
     case ReadOnly:
+        d_ptr->keyframeIndex.reset();
         avformat_close_input(&d_ptr->formatCtx);
         d_ptr->formatCtx = nullptr;
         d_ptr->isOpen = false;
@@ -195,6 +282,26 @@ void FormatContext::close()
     }
 }
 
+void FormatContext::setTimeouts(const Timeouts &timeouts)
+{
+    d_ptr->timeouts = timeouts;
+}
+
+auto FormatContext::timeouts() const -> Timeouts
+{
+    return d_ptr->timeouts;
+}
+
+void FormatContext::setInterruptCallback(const std::function<bool()> &callback)
+{
+    d_ptr->interruptCallback = callback;
+}
+
+auto FormatContext::isInterrupted() const -> bool
+{
+    return d_ptr->interrupted.load();
+}
+
 auto FormatContext::avioOpen() -> bool
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
@@ -244,16 +351,39 @@ auto FormatContext::findStream() -> bool
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
     //获取音视频流数据信息
+    auto *probeCache = ProbeCache::instance();
+    d_ptr->startOperation(d_ptr->timeouts.probe);
     int ret = avformat_find_stream_info(d_ptr->formatCtx, nullptr);
+    if (d_ptr->fastOpened && (ret < 0 || !probeCache->apply(d_ptr->filepath, d_ptr->formatCtx))) {
+        // The file does not match the cache, probe it again in full
+        qInfo() << "Probe cache mismatch, reopen:" << d_ptr->filepath;
+        probeCache->remove(d_ptr->filepath);
+        d_ptr->probeCached = false;
+        avformat_close_input(&d_ptr->formatCtx);
+        ret = d_ptr->openInput(convertUrlToFfmpegInput(d_ptr->filepath), false);
+        if (ret != 0) {
+            d_ptr->isOpen = false;
+            SET_ERROR_CODE(ret);
+            return false;
+        }
+        av_format_inject_global_side_data(d_ptr->formatCtx);
+        d_ptr->startOperation(d_ptr->timeouts.probe);
+        ret = avformat_find_stream_info(d_ptr->formatCtx, nullptr);
+    }
     if (ret < 0) {
         SET_ERROR_CODE(ret);
         return false;
     }
+    if (!d_ptr->probeCached) {
+        probeCache->insert(d_ptr->filepath, d_ptr->formatCtx);
+    }
     if (d_ptr->formatCtx->pb != nullptr) {
         // FIXME hack, ffplay maybe should not use avio_feof() to test for the end
         d_ptr->formatCtx->pb->eof_reached = 0;
     }
     d_ptr->initStreamInfo();
+    d_ptr->keyframeIndex = KeyframeIndex::fromFile(d_ptr->filepath,
+                                                   d_ptr->findBestStreamIndex(AVMEDIA_TYPE_VIDEO));
     return true;
 }
 
@@ -291,10 +421,8 @@ void FormatContext::discardStreamExcluded(const QVector<int> &indexs)
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
     for (uint i = 0; i < d_ptr->formatCtx->nb_streams; i++) {
-        if (indexs.contains(i)) {
-            continue;
-        }
-        d_ptr->formatCtx->streams[i]->discard = AVDISCARD_ALL;
+        d_ptr->formatCtx->streams[i]->discard = indexs.contains(i) ? AVDISCARD_DEFAULT
+                                                                   : AVDISCARD_ALL;
     }
 }
 
@@ -317,7 +445,11 @@ auto FormatContext::createStream() -> AVStream *
 auto FormatContext::readFrame(Packet *packet) -> bool
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
+    d_ptr->startOperation(d_ptr->timeouts.read);
     int ret = av_read_frame(d_ptr->formatCtx, packet->avPacket());
+    if (ret == AVERROR_EXIT && d_ptr->isAborted()) {
+        return false; // closed by the caller, not an error
+    }
     ERROR_RETURN(ret)
 }
 
@@ -352,9 +484,20 @@ auto FormatContext::guessFrameRate(AVStream *stream) const -> AVRational
     return av_guess_frame_rate(d_ptr->formatCtx, stream, nullptr);
 }
 
+void FormatContext::setKeyframeIndex(const KeyframeIndexPtr &keyframeIndex)
+{
+    d_ptr->keyframeIndex = keyframeIndex;
+}
+
+auto FormatContext::keyframeIndex() const -> KeyframeIndexPtr
+{
+    return d_ptr->keyframeIndex;
+}
+
 auto FormatContext::seekFirstFrame() -> bool
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
+    d_ptr->startOperation(d_ptr->timeouts.read);
     int64_t timestamp = 0;
     if (d_ptr->formatCtx->start_time != AV_NOPTS_VALUE) {
         timestamp = d_ptr->formatCtx->start_time;
@@ -366,7 +509,11 @@ auto FormatContext::seekFirstFrame() -> bool
 auto FormatContext::seek(qint64 timestamp) -> bool
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
+    d_ptr->startOperation(d_ptr->timeouts.read);
     Q_ASSERT(timestamp >= 0);
+    if (d_ptr->seekKeyframe(timestamp)) {
+        return true;
+    }
     auto seekMin = timestamp - d_ptr->seekOffset;
     auto seekMax = timestamp + d_ptr->seekOffset;
     auto ret = avformat_seek_file(d_ptr->formatCtx, -1, seekMin, timestamp, seekMax, 0);
@@ -376,9 +523,13 @@ auto FormatContext::seek(qint64 timestamp) -> bool
 auto FormatContext::seek(qint64 timestamp, bool forward) -> bool
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
+    d_ptr->startOperation(d_ptr->timeouts.read);
     Q_ASSERT(timestamp >= 0);
-    auto seekMin = forward ? INT64_MIN : timestamp - d_ptr->seekOffset;
-    auto seekMax = forward ? timestamp + d_ptr->seekOffset : INT64_MAX;
+    if (d_ptr->seekKeyframe(timestamp, forward)) {
+        return true;
+    }
+    auto seekMin = forward ? timestamp - d_ptr->seekOffset : INT64_MIN;
+    auto seekMax = forward ? INT64_MAX : timestamp + d_ptr->seekOffset;
     auto ret = avformat_seek_file(d_ptr->formatCtx, -1, seekMin, timestamp, seekMax, 0);
     ERROR_RETURN(ret)
 }
@@ -386,6 +537,7 @@ auto FormatContext::seek(qint64 timestamp, bool forward) -> bool
 auto FormatContext::seekFrame(int index, qint64 timestamp) -> bool
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
+    d_ptr->startOperation(d_ptr->timeouts.read);
     int ret = av_seek_frame(d_ptr->formatCtx, index, timestamp, AVSEEK_FLAG_BACKWARD);
     ERROR_RETURN(ret)
 }
@@ -399,7 +551,15 @@ void FormatContext::dumpFormat()
 auto FormatContext::mediaInfo() -> MediaInfo
 {
     Q_ASSERT(d_ptr->formatCtx != nullptr);
-    return MediaInfo(d_ptr->formatCtx);
+    MediaInfo info;
+    if (d_ptr->mode == ReadOnly && ProbeCache::instance()->mediaInfo(d_ptr->filepath, info)) {
+        return info;
+    }
+    info = MediaInfo(d_ptr->formatCtx);
+    if (d_ptr->mode == ReadOnly) {
+        ProbeCache::instance()->setMediaInfo(d_ptr->filepath, info);
+    }
+    return info;
 }
 
 auto FormatContext::avFormatContext() -> AVFormatContext *
@@ -2,10 +2,13 @@
 #define FORMATCONTEXT_H
 
 #include "ffmepg_global.h"
+#include "keyframeindex.hpp"
 #include "mediainfo.hpp"
 
 #include <QObject>
 
+#include <functional>
+
 extern "C" {
 #include <libavutil/avutil.h>
 }
@@ -21,6 +24,14 @@ class FFMPEG_EXPORT FormatContext : public QObject
 public:
     enum OpenMode { ReadOnly = 1, WriteOnly };
 
+    // Deadlines of the blocking input operations in milliseconds, <= 0 waits forever
+    struct Timeouts
+    {
+        qint64 open = 0;
+        qint64 probe = 0;
+        qint64 read = 0; // also used by seeks
+    };
+
     explicit FormatContext(QObject *parent = nullptr);
     ~FormatContext() override;
 
@@ -30,6 +41,13 @@ public:
     auto openFilePath(const QString &filepath, OpenMode mode = ReadOnly) -> bool;
     void close();
 
+    void setTimeouts(const Timeouts &timeouts);
+    [[nodiscard]] auto timeouts() const -> Timeouts;
+    // Blocking input operations return as soon as callback returns true, e.g. on close
+    void setInterruptCallback(const std::function<bool()> &callback);
+    // True if the last operation was aborted by the callback or its deadline
+    [[nodiscard]] auto isInterrupted() const -> bool;
+
     auto avioOpen() -> bool;
     void avioClose();
 
@@ -48,13 +66,18 @@ public:
     [[nodiscard]] auto attachmentTracks() const -> StreamInfos;
 
     [[nodiscard]] auto findBestStreamIndex(AVMediaType type) const -> int;
-    // 丢弃除indexs中包含的音视频流，优化av_read_frame性能
+    // 丢弃除indexs中包含的音视频流，优化av_read_frame性能，indexs中的流恢复读取
     void discardStreamExcluded(const QVector<int> &indexs);
 
+    // Attached by findStream() for local files, seeks use it once it is complete
+    void setKeyframeIndex(const KeyframeIndexPtr &keyframeIndex);
+    [[nodiscard]] auto keyframeIndex() const -> KeyframeIndexPtr;
+
     auto seekFirstFrame() -> bool;
     auto seek(qint64 timestamp) -> bool;
+    // forward: the target is after the current position
     auto seek(qint64 timestamp, bool forward) -> bool;   // microsecond
-    auto seekFrame(int index, qint64 timestamp) -> bool; // microsecond
+    auto seekFrame(int index, qint64 timestamp) -> bool; // stream time base, backward
 
     auto readFrame(Packet *packet) -> bool;
 
@@ -9,6 +9,7 @@
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/samplefmt.h>
 }
 
 namespace Ffmpeg {
@@ -39,6 +40,7 @@ public:
 
     AVFrame *frame = nullptr;
     bool imageAlloc = false;
+    qint64 serial = 0;
 };
 
 Frame::Frame()
@@ -52,12 +54,14 @@ Frame::Frame(const Frame &other)
 {
     d_ptr->frame = av_frame_alloc();
     av_frame_ref(d_ptr->frame, other.d_ptr->frame);
+    d_ptr->serial = other.d_ptr->serial;
 }
 
 Frame::Frame(Frame &&other) noexcept
     : d_ptr(new FramePrivate(this))
 {
     d_ptr->frame = other.d_ptr->frame;
+    d_ptr->serial = other.d_ptr->serial;
     other.d_ptr->frame = nullptr;
 }
 
@@ -69,6 +73,7 @@ auto Frame::operator=(const Frame &other) -> Frame &
         d_ptr->freeImageAlloc();
         av_frame_unref(d_ptr->frame);
         av_frame_ref(d_ptr->frame, other.d_ptr->frame);
+        d_ptr->serial = other.d_ptr->serial;
     }
 
     return *this;
@@ -79,6 +84,7 @@ auto Frame::operator=(Frame &&other) noexcept -> Frame &
     if (this != &other) {
         d_ptr->freeImageAlloc();
         d_ptr->frame = other.d_ptr->frame;
+        d_ptr->serial = other.d_ptr->serial;
         other.d_ptr->frame = nullptr;
     }
 
@@ -177,6 +183,54 @@ auto Frame::duration() -> qint64
     return d_ptr->frame->duration;
 }
 
+void Frame::setSerial(qint64 serial)
+{
+    d_ptr->serial = serial;
+}
+
+auto Frame::serial() const -> qint64
+{
+    return d_ptr->serial;
+}
+
+auto Frame::trimSamples(int count) -> bool
+{
+    Q_ASSERT(d_ptr->frame != nullptr);
+    auto *frame = d_ptr->frame;
+    if (count <= 0) {
+        return true;
+    }
+    if (count >= frame->nb_samples) {
+        return false;
+    }
+
+    auto *dst = av_frame_alloc();
+    dst->format = frame->format;
+    dst->sample_rate = frame->sample_rate;
+    dst->nb_samples = frame->nb_samples - count;
+    av_channel_layout_copy(&dst->ch_layout, &frame->ch_layout);
+    auto ret = av_frame_get_buffer(dst, 0);
+    if (ret < 0) {
+        SET_ERROR_CODE(ret);
+        av_frame_free(&dst);
+        return false;
+    }
+    av_frame_copy_props(dst, frame);
+    av_samples_copy(dst->extended_data,
+                    frame->extended_data,
+                    0,
+                    count,
+                    dst->nb_samples,
+                    frame->ch_layout.nb_channels,
+                    static_cast<AVSampleFormat>(frame->format));
+    dst->pts = frame->pts;
+    dst->duration = frame->duration;
+    av_frame_unref(frame);
+    av_frame_move_ref(frame, dst);
+    av_frame_free(&dst);
+    return true;
+}
+
 void Frame::destroyFrame()
 {
     d_ptr->destroyFrame();
@@ -45,10 +45,17 @@ public:
     void setDuration(qint64 duration); // microseconds
     auto duration() -> qint64;
 
+    // Serial of the packet the frame was decoded from
+    void setSerial(qint64 serial);
+    [[nodiscard]] auto serial() const -> qint64;
+
     auto toImage() -> QImage; // maybe null
 
     auto getBuffer() -> bool;
 
+    // Drops the first count audio samples, pts is left to the caller
+    auto trimSamples(int count) -> bool;
+
     void destroyFrame();
 
     auto avFrame() -> AVFrame *;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QtCore>
+
+namespace Ffmpeg {
+
+// What the video decoder skips before decoding, the display falling behind raises it
+enum class SkipLevel : int {
+    None,   // decode everything
+    NonRef, // frames no other frame refers to
+    Bidir,  // also B-frames
+    NonKey, // keyframes only
+};
+
+struct FrameSkipStats
+{
+    SkipLevel level = SkipLevel::None;
+    quint64 skippedFrames = 0; // never decoded
+    quint64 droppedFrames = 0; // decoded but too late to show
+};
+
+// Steps the skip level one at a time from the lateness of the display. The level is
+// raised only after the previous step had time to catch up and lowered after the
+// display kept up for a while, so a single slow frame does not make it flap.
+class FrameSkipController
+{
+public:
+    static constexpr qint64 s_lateThreshold = 80 * 1000;     // microsecond
+    static constexpr qint64 s_recoverThreshold = 20 * 1000;  // microsecond
+    static constexpr qint64 s_raiseInterval = 500 * 1000;    // microsecond
+    static constexpr qint64 s_restoreInterval = 2000 * 1000; // microsecond
+
+    void reset(qint64 now)
+    {
+        m_level = SkipLevel::None;
+        m_changedAt = now;
+        m_lateAt = now;
+    }
+
+    // return true if the level changed
+    auto update(qint64 lateness, qint64 now) -> bool
+    {
+        if (lateness > s_recoverThreshold) {
+            m_lateAt = now;
+        }
+        if (lateness > s_lateThreshold) {
+            if (m_level == SkipLevel::NonKey || now - m_changedAt < s_raiseInterval) {
+                return false;
+            }
+            setLevel(static_cast<SkipLevel>(static_cast<int>(m_level) + 1), now);
+            return true;
+        }
+        if (m_level == SkipLevel::None || now - qMax(m_changedAt, m_lateAt) < s_restoreInterval) {
+            return false;
+        }
+        setLevel(static_cast<SkipLevel>(static_cast<int>(m_level) - 1), now);
+        return true;
+    }
+
+    [[nodiscard]] auto level() const -> SkipLevel { return m_level; }
+
+private:
+    void setLevel(SkipLevel level, qint64 now)
+    {
+        m_level = level;
+        m_changedAt = now;
+    }
+
+    SkipLevel m_level = SkipLevel::None;
+    qint64 m_changedAt = 0;
+    qint64 m_lateAt = 0;
+};
+
+} // namespace Ffmpeg
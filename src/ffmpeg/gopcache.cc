@@ -0,0 +1,430 @@
+#include "gopcache.hpp"
+#include "avcontextinfo.h"
+#include "codeccontext.h"
+#include "ffmpegutils.hpp"
+#include "formatcontext.h"
+#include "packet.h"
+
+#include <utils/executor.hpp>
+
+#include <QDebug>
+
+#include <deque>
+#include <map>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace Ffmpeg {
+
+class GopCache::GopCachePrivate
+{
+public:
+    struct Gop
+    {
+        qint64 start = 0; // pts of the keyframe or first kept frame, microsecond
+        qint64 end = 0;   // pts of the next keyframe or first frame not kept
+        bool last = false;
+        std::vector<FramePtr> frames; // sorted by pts
+        qint64 bytes = 0;
+        quint64 lastUsed = 0;
+    };
+    using GopPtr = QSharedPointer<Gop>;
+
+    explicit GopCachePrivate(GopCache *q)
+        : q_ptr(q)
+        , taskGroup(new Utils::TaskGroup(1, Utils::Executor::Priority::Background))
+    {}
+
+    static auto frameBytes(Frame *frame) -> qint64
+    {
+        qint64 bytes = 0;
+        for (auto *buf : frame->avFrame()->buf) {
+            if (buf != nullptr) {
+                bytes += buf->size;
+            }
+        }
+        return bytes;
+    }
+
+    auto findGop(qint64 pts) -> GopPtr
+    {
+        QMutexLocker locker(&mutex);
+        auto it = gops.upper_bound(pts);
+        if (it == gops.begin()) {
+            return {};
+        }
+        --it;
+        if (pts >= it->second->end && !it->second->last) {
+            return {};
+        }
+        it->second->lastUsed = ++useCount;
+        return it->second;
+    }
+
+    auto gopAt(qint64 pts) -> GopPtr
+    {
+        auto gopPtr = findGop(pts);
+        if (!gopPtr.isNull()) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return gopPtr;
+        }
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return decodeGop(pts);
+    }
+
+    // Any thread, one group at a time on the own demuxer and decoder. Decoding always
+    // starts at the keyframe, but no more than the byte budget is kept: a larger group is
+    // cached in parts around the pts asked for, the frames before it taking at most half.
+    auto decodeGop(qint64 pts) -> GopPtr
+    {
+        QMutexLocker decodeLocker(&decodeMutex);
+        // Decoded by the prefetch meanwhile
+        auto gopPtr = findGop(pts);
+        if (!gopPtr.isNull() || formatCtx.isNull()) {
+            return gopPtr;
+        }
+        QElapsedTimer timer;
+        timer.start();
+        qint64 budget = 0;
+        {
+            QMutexLocker locker(&mutex);
+            budget = maxBytes;
+        }
+        auto timestamp = av_rescale_q(qMax<qint64>(pts, 0),
+                                      AV_TIME_BASE_Q,
+                                      videoInfo->stream()->time_base);
+        if (!formatCtx->seekFrame(videoInfo->index(), timestamp)) {
+            return {};
+        }
+        videoInfo->codecCtx()->flush();
+
+        gopPtr.reset(new Gop);
+        std::deque<FramePtr> frames; // in pts order, as the decoder returns them
+        qint64 bytes = 0;
+        bool trimmed = false; // frames before the first kept one were dropped
+        bool full = false;    // the budget ended the part after pts
+        auto sink = [&](const FramePtr &framePtr) {
+            if (full) {
+                return;
+            }
+            calculatePts(framePtr.data(), videoInfo.data(), formatCtx.data());
+            auto framePts = framePtr->pts();
+            // Leading pictures of an open group refer to the group before
+            if (framePts < gopPtr->start) {
+                return;
+            }
+            auto size = frameBytes(framePtr.data());
+            if (framePts > pts && bytes + size > budget) {
+                full = true;
+                gopPtr->end = framePts;
+                return;
+            }
+            frames.push_back(framePtr);
+            bytes += size;
+            while (framePts <= pts && frames.size() > 1 && bytes > budget / 2) {
+                bytes -= frameBytes(frames.front().data());
+                frames.pop_front();
+                trimmed = true;
+            }
+        };
+        bool keyframeRead = false;
+        gopPtr->last = true;
+        while (!full) {
+            auto packetPtr = packetPool.acquire();
+            if (!formatCtx->readFrame(packetPtr.data())) {
+                break;
+            }
+            if (packetPtr->streamIndex() != videoInfo->index()) {
+                continue;
+            }
+            if (packetPtr->isKey()) {
+                calculatePts(packetPtr.data(), videoInfo.data());
+                if (keyframeRead) {
+                    gopPtr->end = packetPtr->pts();
+                    gopPtr->last = false;
+                    break;
+                }
+                keyframeRead = true;
+                gopPtr->start = packetPtr->pts();
+            } else if (!keyframeRead) {
+                continue;
+            }
+            videoInfo->decodeFrame(packetPtr, sink);
+        }
+        // Frames still buffered for reordering
+        if (!full) {
+            videoInfo->decodeFrame(packetPool.acquire(), sink);
+        }
+        videoInfo->codecCtx()->flush();
+        if (frames.empty()) {
+            return {};
+        }
+        if (full) {
+            gopPtr->last = false;
+        } else if (gopPtr->last) {
+            gopPtr->end = frames.back()->pts() + frames.back()->duration();
+        }
+        if (trimmed) {
+            gopPtr->start = frames.front()->pts();
+        }
+        gopPtr->frames.assign(frames.begin(), frames.end());
+        std::sort(gopPtr->frames.begin(),
+                  gopPtr->frames.end(),
+                  [](const FramePtr &a, const FramePtr &b) { return a->pts() < b->pts(); });
+        gopPtr->bytes = bytes;
+        insert(gopPtr);
+        qDebug() << "GOP decoded:" << gopPtr->start << "-" << gopPtr->end
+                 << "frames:" << gopPtr->frames.size() << "bytes:" << gopPtr->bytes
+                 << "elapsed:" << timer.elapsed() << "ms";
+        return gopPtr;
+    }
+
+    // A part over the budget, a single frame larger than it, is served but not kept
+    void insert(const GopPtr &gopPtr)
+    {
+        QMutexLocker locker(&mutex);
+        if (gopPtr->bytes > maxBytes) {
+            qWarning() << "GOP part over the cache budget:" << gopPtr->bytes << maxBytes;
+            return;
+        }
+        auto it = gops.find(gopPtr->start);
+        if (it != gops.end()) {
+            bytes -= it->second->bytes;
+        }
+        gopPtr->lastUsed = ++useCount;
+        gops[gopPtr->start] = gopPtr;
+        bytes += gopPtr->bytes;
+        while (bytes > maxBytes && gops.size() > 1) {
+            auto oldest = gops.end();
+            for (auto iter = gops.begin(); iter != gops.end(); ++iter) {
+                if (iter->second == gopPtr) {
+                    continue;
+                }
+                if (oldest == gops.end() || iter->second->lastUsed < oldest->second->lastUsed) {
+                    oldest = iter;
+                }
+            }
+            bytes -= oldest->second->bytes;
+            gops.erase(oldest);
+        }
+    }
+
+    // Decodes the group holding pts in the background, one at a time
+    void prefetch(qint64 pts)
+    {
+        if (pts < 0 || !findGop(pts).isNull() || prefetching.exchange(true)) {
+            return;
+        }
+        taskGroup->start([this, pts] {
+            if (!decodeGop(pts).isNull()) {
+                prefetched.fetch_add(1, std::memory_order_relaxed);
+            }
+            prefetching.store(false);
+        });
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&mutex);
+        gops.clear();
+        bytes = 0;
+    }
+
+    GopCache *q_ptr;
+
+    QString filepath;
+    int videoIndex = -1;
+
+    mutable QMutex decodeMutex;
+    QScopedPointer<FormatContext> formatCtx;
+    QScopedPointer<AVContextInfo> videoInfo;
+
+    mutable QMutex mutex;
+    std::map<qint64, GopPtr> gops;
+    qint64 bytes = 0;
+    qint64 maxBytes = 512 * 1024 * 1024;
+    quint64 useCount = 0;
+
+    std::atomic<quint64> hits = 0;
+    std::atomic<quint64> misses = 0;
+    std::atomic<quint64> prefetched = 0;
+    std::atomic_bool prefetching = false;
+
+    // One packet in flight at a time
+    PacketPool packetPool{4};
+
+    // Destroyed first, its jobs use the contexts above
+    QScopedPointer<Utils::TaskGroup> taskGroup;
+};
+
+GopCache::GopCache(QObject *parent)
+    : QObject{parent}
+    , d_ptr(new GopCachePrivate(this))
+{}
+
+GopCache::~GopCache()
+{
+    close();
+}
+
+auto GopCache::open(const QString &filepath, int videoIndex) -> bool
+{
+    close();
+    QScopedPointer<FormatContext> formatCtx(new FormatContext);
+    if (!formatCtx->openFilePath(filepath) || !formatCtx->findStream()) {
+        return false;
+    }
+    if (videoIndex < 0 || videoIndex >= formatCtx->streams()) {
+        return false;
+    }
+    QScopedPointer<AVContextInfo> videoInfo(new AVContextInfo);
+    videoInfo->setIndex(videoIndex);
+    videoInfo->setStream(formatCtx->stream(videoIndex));
+    if (!videoInfo->initDecoder(formatCtx->guessFrameRate(videoIndex))
+        || !videoInfo->openCodec()) {
+        return false;
+    }
+    formatCtx->discardStreamExcluded({videoIndex});
+
+    QMutexLocker locker(&d_ptr->decodeMutex);
+    d_ptr->formatCtx.reset(formatCtx.take());
+    d_ptr->videoInfo.reset(videoInfo.take());
+    d_ptr->filepath = filepath;
+    d_ptr->videoIndex = videoIndex;
+    return true;
+}
+
+void GopCache::close()
+{
+    d_ptr->taskGroup->clear();
+    d_ptr->taskGroup->waitForDone();
+    d_ptr->prefetching.store(false);
+    d_ptr->clear();
+
+    QMutexLocker locker(&d_ptr->decodeMutex);
+    d_ptr->videoInfo.reset();
+    d_ptr->formatCtx.reset();
+    d_ptr->filepath.clear();
+    d_ptr->videoIndex = -1;
+}
+
+auto GopCache::isOpen() const -> bool
+{
+    QMutexLocker locker(&d_ptr->decodeMutex);
+    return !d_ptr->formatCtx.isNull();
+}
+
+auto GopCache::filePath() const -> QString
+{
+    QMutexLocker locker(&d_ptr->decodeMutex);
+    return d_ptr->filepath;
+}
+
+auto GopCache::videoIndex() const -> int
+{
+    QMutexLocker locker(&d_ptr->decodeMutex);
+    return d_ptr->videoIndex;
+}
+
+auto GopCache::previousFrame(qint64 pts) -> FramePtr
+{
+    auto gopPtr = d_ptr->gopAt(pts);
+    if (gopPtr.isNull()) {
+        return {};
+    }
+    const auto &frames = gopPtr->frames;
+    auto it = std::lower_bound(frames.begin(),
+                               frames.end(),
+                               pts,
+                               [](const FramePtr &framePtr, qint64 pts) {
+                                   return framePtr->pts() < pts;
+                               });
+    // Reverse playback wants the group before next
+    d_ptr->prefetch(gopPtr->start - 1);
+    if (it != frames.begin()) {
+        return *(it - 1);
+    }
+    if (gopPtr->start <= 0) {
+        return {};
+    }
+    // Parts of one group may overlap, look the frame up instead of taking the last one
+    auto previousPtr = d_ptr->gopAt(gopPtr->start - 1);
+    if (previousPtr.isNull() || previousPtr->start >= gopPtr->start) {
+        return {};
+    }
+    const auto &previousFrames = previousPtr->frames;
+    auto previousIt = std::lower_bound(previousFrames.begin(),
+                                       previousFrames.end(),
+                                       gopPtr->start,
+                                       [](const FramePtr &framePtr, qint64 pts) {
+                                           return framePtr->pts() < pts;
+                                       });
+    if (previousIt == previousFrames.begin()) {
+        return {};
+    }
+    d_ptr->prefetch(previousPtr->start - 1);
+    return *(previousIt - 1);
+}
+
+auto GopCache::nextFrame(qint64 pts) -> FramePtr
+{
+    auto gopPtr = d_ptr->gopAt(pts);
+    if (gopPtr.isNull()) {
+        return {};
+    }
+    const auto &frames = gopPtr->frames;
+    auto it = std::upper_bound(frames.begin(),
+                               frames.end(),
+                               pts,
+                               [](qint64 pts, const FramePtr &framePtr) {
+                                   return pts < framePtr->pts();
+                               });
+    if (it != frames.end()) {
+        return *it;
+    }
+    if (gopPtr->last) {
+        return {};
+    }
+    auto nextPtr = d_ptr->gopAt(gopPtr->end);
+    if (nextPtr.isNull() || nextPtr->end <= gopPtr->end) {
+        return {};
+    }
+    const auto &nextFrames = nextPtr->frames;
+    auto nextIt = std::upper_bound(nextFrames.begin(),
+                                   nextFrames.end(),
+                                   pts,
+                                   [](qint64 pts, const FramePtr &framePtr) {
+                                       return pts < framePtr->pts();
+                                   });
+    return nextIt != nextFrames.end() ? *nextIt : FramePtr();
+}
+
+void GopCache::setMaxBytes(qint64 maxBytes)
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->maxBytes = maxBytes;
+}
+
+auto GopCache::maxBytes() const -> qint64
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    return d_ptr->maxBytes;
+}
+
+auto GopCache::stats() const -> Stats
+{
+    Stats stats;
+    {
+        QMutexLocker locker(&d_ptr->mutex);
+        stats.gops = static_cast<int>(d_ptr->gops.size());
+        stats.bytes = d_ptr->bytes;
+    }
+    stats.hits = d_ptr->hits.load(std::memory_order_relaxed);
+    stats.misses = d_ptr->misses.load(std::memory_order_relaxed);
+    stats.prefetched = d_ptr->prefetched.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace Ffmpeg
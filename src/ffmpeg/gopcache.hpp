@@ -0,0 +1,51 @@
+#pragma once
+
+#include "frame.hpp"
+
+#include <QObject>
+
+namespace Ffmpeg {
+
+// Decoded groups of pictures of one video stream, for frame stepping and reverse
+// playback. The file is read by its own demuxer and software decoder, the playback
+// pipeline is not touched. Serving a group decodes the one before it on the shared
+// executor; the least recently used groups are dropped above the byte budget. A group
+// larger than the budget is decoded from its keyframe each time and kept in parts around
+// the pts asked for.
+class FFMPEG_EXPORT GopCache : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        int gops = 0;
+        qint64 bytes = 0;
+        quint64 hits = 0;
+        quint64 misses = 0; // groups decoded while the caller waited
+        quint64 prefetched = 0;
+    };
+
+    explicit GopCache(QObject *parent = nullptr);
+    ~GopCache() override;
+
+    auto open(const QString &filepath, int videoIndex) -> bool;
+    void close();
+    [[nodiscard]] auto isOpen() const -> bool;
+    [[nodiscard]] auto filePath() const -> QString;
+    [[nodiscard]] auto videoIndex() const -> int;
+
+    // The frame right before or after pts (microsecond), null at either end of the stream.
+    // Blocks while the group is decoded if it is not cached.
+    auto previousFrame(qint64 pts) -> FramePtr;
+    auto nextFrame(qint64 pts) -> FramePtr;
+
+    void setMaxBytes(qint64 maxBytes);
+    [[nodiscard]] auto maxBytes() const -> qint64;
+    [[nodiscard]] auto stats() const -> Stats;
+
+private:
+    class GopCachePrivate;
+    QScopedPointer<GopCachePrivate> d_ptr;
+};
+
+} // namespace Ffmpeg
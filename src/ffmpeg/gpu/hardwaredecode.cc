@@ -14,21 +14,6 @@ extern "C" {
 
 namespace Ffmpeg {
 
-AVPixelFormat hw_pix_fmt = AV_PIX_FMT_NONE;
-
-auto get_hw_format(AVCodecContext *ctx, const enum AVPixelFormat *pix_fmts) -> AVPixelFormat
-{
-    Q_UNUSED(ctx)
-    const enum AVPixelFormat *p;
-    for (p = pix_fmts; *p != -1; p++) {
-        if (*p == hw_pix_fmt) {
-            return *p;
-        }
-    }
-    qWarning() << "Failed to get HW surface format.";
-    return AV_PIX_FMT_NONE;
-}
-
 class HardWareDecode::HardWareDecodePrivate
 {
 public:
@@ -38,10 +23,27 @@ public:
         bufferRef = new BufferRef(q_ptr);
     }
 
-    ~HardWareDecodePrivate() { hw_pix_fmt = AV_PIX_FMT_NONE; }
+    // The codec context opaque points to the private of its own decoder,
+    // so every player keeps its own hardware pixel format
+    static auto getHwFormat(AVCodecContext *ctx, const enum AVPixelFormat *pix_fmts)
+        -> AVPixelFormat
+    {
+        auto *d = static_cast<HardWareDecodePrivate *>(ctx->opaque);
+        if (d != nullptr) {
+            for (const enum AVPixelFormat *p = pix_fmts; *p != -1; p++) {
+                if (*p == d->hwPixFmt) {
+                    return *p;
+                }
+            }
+        }
+        qWarning() << "Failed to get HW surface format.";
+        return AV_PIX_FMT_NONE;
+    }
 
     HardWareDecode *q_ptr;
 
+    AVPixelFormat hwPixFmt = AV_PIX_FMT_NONE;
+
     QVector<AVHWDeviceType> hwDeviceTypes = getCurrentHWDeviceTypes();
     AVHWDeviceType hwDeviceType = AV_HWDEVICE_TYPE_NONE;
     BufferRef *bufferRef;
@@ -64,18 +66,18 @@ auto HardWareDecode::initPixelFormat(const AVCodec *decoder) -> bool
         return false;
     }
     for (AVHWDeviceType type : std::as_const(d_ptr->hwDeviceTypes)) {
-        hw_pix_fmt = getPixelFormat(decoder, type);
-        if (hw_pix_fmt != AV_PIX_FMT_NONE) {
+        d_ptr->hwPixFmt = getPixelFormat(decoder, type);
+        if (d_ptr->hwPixFmt != AV_PIX_FMT_NONE) {
             d_ptr->hwDeviceType = type;
             break;
         }
     }
-    return (hw_pix_fmt != AV_PIX_FMT_NONE);
+    return (d_ptr->hwPixFmt != AV_PIX_FMT_NONE);
 }
 
 auto HardWareDecode::initHardWareDevice(CodecContext *codecContext) -> bool
 {
-    if (hw_pix_fmt == AV_PIX_FMT_NONE) {
+    if (d_ptr->hwPixFmt == AV_PIX_FMT_NONE) {
         return false;
     }
     if (!d_ptr->bufferRef->hwdeviceCtxCreate(d_ptr->hwDeviceType)) {
@@ -83,7 +85,8 @@ auto HardWareDecode::initHardWareDevice(CodecContext *codecContext) -> bool
     }
     auto *ctx = codecContext->avCodecCtx();
     ctx->hw_device_ctx = d_ptr->bufferRef->ref();
-    ctx->get_format = get_hw_format;
+    ctx->opaque = d_ptr.data();
+    ctx->get_format = HardWareDecodePrivate::getHwFormat;
     d_ptr->vaild = ctx->hw_device_ctx != nullptr;
     return d_ptr->vaild;
 }
@@ -95,7 +98,7 @@ auto HardWareDecode::transFromGpu(const QSharedPointer<Frame> &inPtr, bool &ok)
     if (!isVaild()) {
         return inPtr;
     }
-    if (inPtr->avFrame()->format != hw_pix_fmt) {
+    if (inPtr->avFrame()->format != d_ptr->hwPixFmt) {
         return inPtr;
     }
     FramePtr outPtr(new Frame);
@@ -120,7 +123,7 @@ auto HardWareDecode::isVaild() -> bool
     if (d_ptr->hwDeviceType == AV_HWDEVICE_TYPE_NONE) {
         return false;
     }
-    if (hw_pix_fmt == AV_PIX_FMT_NONE) {
+    if (d_ptr->hwPixFmt == AV_PIX_FMT_NONE) {
         return false;
     }
     return d_ptr->vaild;
@@ -0,0 +1,361 @@
+#include "keyframeindex.hpp"
+#include "formatcontext.h"
+#include "packet.h"
+
+#include <utils/executor.hpp>
+#include <utils/utils.h>
+
+#include <QCryptographicHash>
+#include <QRunnable>
+#include <QSaveFile>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace Ffmpeg {
+
+namespace {
+
+constexpr char s_magic[4] = {'Q', 'F', 'K', 'I'};
+constexpr quint32 s_version = 1;
+constexpr qint64 s_maxCacheBytes = 64 * 1024 * 1024;
+constexpr qint64 s_maxCacheAge = 30LL * 24 * 3600; // second
+
+struct SidecarHeader
+{
+    char magic[4];
+    quint32 version;
+    qint64 fileSize;
+    qint64 lastModified;
+    qint32 streamIndex;
+    quint32 reserved;
+    qint64 count;
+};
+
+static_assert(sizeof(SidecarHeader) % alignof(KeyframeIndex::Entry) == 0);
+
+auto cacheDirectory() -> QString
+{
+    const auto path = Utils::cachePath() + "/keyframe";
+    Utils::generateDirectorys(path);
+    return path;
+}
+
+auto buildGroup() -> Utils::TaskGroup *
+{
+    static Utils::TaskGroup group(1, Utils::Executor::Priority::Background);
+    return &group;
+}
+
+} // namespace
+
+class KeyframeIndex::KeyframeIndexPrivate
+{
+public:
+    explicit KeyframeIndexPrivate(KeyframeIndex *q)
+        : q_ptr(q)
+    {}
+
+    ~KeyframeIndexPrivate() { unmap(); }
+
+    void unmap()
+    {
+        if (mapped != nullptr) {
+            file.unmap(mapped);
+            mapped = nullptr;
+        }
+        file.close();
+        data = nullptr;
+        count = 0;
+    }
+
+    KeyframeIndex *q_ptr;
+
+    QString filepath;
+    int streamIndex = -1;
+    qint64 fileSize = 0;
+    qint64 lastModified = 0;
+    std::atomic_bool complete = false;
+    std::atomic_bool building = false;
+
+    mutable QMutex mutex;
+    QFile file;
+    uchar *mapped = nullptr;
+    Entries entries;
+    // Either points into the mapped sidecar or into entries
+    const Entry *data = nullptr;
+    qint64 count = 0;
+};
+
+class KeyframeIndexTask : public QRunnable
+{
+public:
+    explicit KeyframeIndexTask(const KeyframeIndexPtr &index)
+        : m_indexPtr(index)
+        , m_filepath(index->filePath())
+        , m_streamIndex(index->streamIndex())
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        // A failed scan may be retried by the next buildAsync()
+        auto resetBuilding = qScopeGuard([this] {
+            auto indexPtr = m_indexPtr.toStrongRef();
+            if (!indexPtr.isNull()) {
+                indexPtr->d_ptr->building.store(false);
+            }
+        });
+        QScopedPointer<FormatContext> formatCtxPtr(new FormatContext);
+        if (!formatCtxPtr->openFilePath(m_filepath) || !formatCtxPtr->findStream()
+            || m_streamIndex >= formatCtxPtr->streams()) {
+            return;
+        }
+        // Only the weak reference may keep the scan alive
+        formatCtxPtr->setKeyframeIndex({});
+        formatCtxPtr->discardStreamExcluded({m_streamIndex});
+        formatCtxPtr->seekFirstFrame();
+
+        auto timeBase = formatCtxPtr->stream(m_streamIndex)->time_base;
+        KeyframeIndex::Entries entries;
+        Packet packet;
+        qint64 readCount = 0;
+        while (formatCtxPtr->readFrame(&packet)) {
+            auto *avPacket = packet.avPacket();
+            if (avPacket->stream_index == m_streamIndex && packet.isKey()) {
+                auto ts = avPacket->pts != AV_NOPTS_VALUE ? avPacket->pts : avPacket->dts;
+                if (ts != AV_NOPTS_VALUE) {
+                    entries.push_back({av_rescale_q(ts, timeBase, AV_TIME_BASE_Q), avPacket->pos});
+                }
+            }
+            packet.unref();
+            // Stop when nobody uses the index anymore
+            if (++readCount % 256 == 0 && m_indexPtr.toStrongRef().isNull()) {
+                return;
+            }
+        }
+
+        auto indexPtr = m_indexPtr.toStrongRef();
+        if (!indexPtr.isNull()) {
+            indexPtr->setEntries(std::move(entries));
+        }
+    }
+
+private:
+    QWeakPointer<KeyframeIndex> m_indexPtr;
+    QString m_filepath;
+    int m_streamIndex;
+};
+
+KeyframeIndex::KeyframeIndex(const QString &filepath, int streamIndex)
+    : d_ptr(new KeyframeIndexPrivate(this))
+{
+    QFileInfo fileInfo(filepath);
+    d_ptr->filepath = fileInfo.absoluteFilePath();
+    d_ptr->streamIndex = streamIndex;
+    d_ptr->fileSize = fileInfo.size();
+    d_ptr->lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+}
+
+KeyframeIndex::~KeyframeIndex() = default;
+
+auto KeyframeIndex::fromFile(const QString &filepath, int streamIndex)
+    -> QSharedPointer<KeyframeIndex>
+{
+    QFileInfo fileInfo(filepath);
+    if (streamIndex < 0 || !fileInfo.isFile()) {
+        return {};
+    }
+
+    static QMutex mutex;
+    static QHash<QString, QWeakPointer<KeyframeIndex>> indexs;
+
+    const auto key = QString("%1:%2").arg(fileInfo.absoluteFilePath()).arg(streamIndex);
+    QMutexLocker locker(&mutex);
+    auto indexPtr = indexs.value(key).toStrongRef();
+    if (!indexPtr.isNull()
+        && indexPtr->d_ptr->lastModified == fileInfo.lastModified().toMSecsSinceEpoch()
+        && indexPtr->d_ptr->fileSize == fileInfo.size()) {
+        return indexPtr;
+    }
+    indexPtr.reset(new KeyframeIndex(filepath, streamIndex));
+    indexPtr->load();
+    // Indexes nobody holds any more, a long session opens many files
+    for (auto it = indexs.begin(); it != indexs.end();) {
+        it = it.value().isNull() ? indexs.erase(it) : std::next(it);
+    }
+    indexs.insert(key, indexPtr);
+    return indexPtr;
+}
+
+void KeyframeIndex::buildAsync(const QSharedPointer<KeyframeIndex> &index)
+{
+    if (index.isNull() || index->isComplete() || index->d_ptr->building.exchange(true)) {
+        return;
+    }
+    buildGroup()->start(new KeyframeIndexTask(index));
+}
+
+auto KeyframeIndex::filePath() const -> QString
+{
+    return d_ptr->filepath;
+}
+
+auto KeyframeIndex::streamIndex() const -> int
+{
+    return d_ptr->streamIndex;
+}
+
+auto KeyframeIndex::isComplete() const -> bool
+{
+    return d_ptr->complete.load();
+}
+
+auto KeyframeIndex::size() const -> qint64
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    return d_ptr->count;
+}
+
+auto KeyframeIndex::findKeyframe(qint64 timestamp, Entry &entry) const -> bool
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    if (d_ptr->count == 0) {
+        return false;
+    }
+    const auto *begin = d_ptr->data;
+    const auto *end = d_ptr->data + d_ptr->count;
+    const auto *it = std::upper_bound(begin, end, timestamp, [](qint64 ts, const Entry &e) {
+        return ts < e.pts;
+    });
+    if (it == begin) {
+        return false;
+    }
+    entry = *(it - 1);
+    return true;
+}
+
+auto KeyframeIndex::findKeyframeAfter(qint64 timestamp, Entry &entry) const -> bool
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    const auto *begin = d_ptr->data;
+    const auto *end = d_ptr->data + d_ptr->count;
+    const auto *it = std::lower_bound(begin, end, timestamp, [](const Entry &e, qint64 ts) {
+        return e.pts < ts;
+    });
+    if (it == end) {
+        return false;
+    }
+    entry = *it;
+    return true;
+}
+
+void KeyframeIndex::setEntries(Entries &&entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.pts < b.pts;
+    });
+    entries.erase(std::unique(entries.begin(),
+                              entries.end(),
+                              [](const Entry &a, const Entry &b) { return a.pts == b.pts; }),
+                  entries.end());
+    {
+        QMutexLocker locker(&d_ptr->mutex);
+        d_ptr->unmap();
+        d_ptr->entries = std::move(entries);
+        d_ptr->data = d_ptr->entries.data();
+        d_ptr->count = static_cast<qint64>(d_ptr->entries.size());
+    }
+    d_ptr->complete.store(true);
+    save();
+    trimCache();
+}
+
+auto KeyframeIndex::sidecarPath() const -> QString
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(d_ptr->filepath.toUtf8());
+    hash.addData(QByteArray::number(d_ptr->fileSize));
+    hash.addData(QByteArray::number(d_ptr->lastModified));
+    hash.addData(QByteArray::number(d_ptr->streamIndex));
+    return cacheDirectory() + "/" + hash.result().toHex() + ".kfi";
+}
+
+auto KeyframeIndex::load() -> bool
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->unmap();
+    d_ptr->file.setFileName(sidecarPath());
+    if (!d_ptr->file.open(QIODevice::ReadOnly)
+        || d_ptr->file.size() < static_cast<qint64>(sizeof(SidecarHeader))) {
+        d_ptr->file.close();
+        return false;
+    }
+    d_ptr->mapped = d_ptr->file.map(0, d_ptr->file.size());
+    if (d_ptr->mapped == nullptr) {
+        d_ptr->file.close();
+        return false;
+    }
+    SidecarHeader header;
+    memcpy(&header, d_ptr->mapped, sizeof(SidecarHeader));
+    auto expectedSize = static_cast<qint64>(sizeof(SidecarHeader))
+                        + header.count * static_cast<qint64>(sizeof(Entry));
+    if (memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 || header.version != s_version
+        || header.fileSize != d_ptr->fileSize || header.lastModified != d_ptr->lastModified
+        || header.streamIndex != d_ptr->streamIndex || header.count < 0
+        || expectedSize != d_ptr->file.size()) {
+        qWarning() << "Invalid keyframe index:" << d_ptr->file.fileName();
+        d_ptr->unmap();
+        return false;
+    }
+    d_ptr->data = reinterpret_cast<const Entry *>(d_ptr->mapped + sizeof(SidecarHeader));
+    d_ptr->count = header.count;
+    d_ptr->complete.store(true);
+    return true;
+}
+
+auto KeyframeIndex::save() -> bool
+{
+    SidecarHeader header{};
+    memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.fileSize = d_ptr->fileSize;
+    header.lastModified = d_ptr->lastModified;
+    header.streamIndex = d_ptr->streamIndex;
+
+    QSaveFile file(sidecarPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << file.errorString();
+        return false;
+    }
+    QMutexLocker locker(&d_ptr->mutex);
+    header.count = d_ptr->count;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(SidecarHeader));
+    file.write(reinterpret_cast<const char *>(d_ptr->data),
+               static_cast<qint64>(d_ptr->count * sizeof(Entry)));
+    return file.commit();
+}
+
+void KeyframeIndex::trimCache()
+{
+    QDir dir(cacheDirectory());
+    auto fileInfos = dir.entryInfoList({"*.kfi"}, QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 totalBytes = 0;
+    for (const auto &fileInfo : std::as_const(fileInfos)) {
+        totalBytes += fileInfo.size();
+    }
+    const auto expired = QDateTime::currentDateTime().addSecs(-s_maxCacheAge);
+    for (const auto &fileInfo : std::as_const(fileInfos)) {
+        if (totalBytes <= s_maxCacheBytes && fileInfo.lastModified() >= expired) {
+            break;
+        }
+        // Still mapped elsewhere on some systems, tried again next time
+        if (QFile::remove(fileInfo.absoluteFilePath())) {
+            totalBytes -= fileInfo.size();
+        }
+    }
+}
+
+} // namespace Ffmpeg
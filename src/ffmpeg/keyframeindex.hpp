@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ffmepg_global.h"
+
+#include <QtCore>
+
+namespace Ffmpeg {
+
+// Keyframe table of one video stream, persisted as a sidecar file in the cache directory.
+// Indexes are shared per file, so players and preview tasks reuse the same table.
+class FFMPEG_EXPORT KeyframeIndex
+{
+public:
+    struct Entry
+    {
+        qint64 pts = 0;  // microsecond
+        qint64 pos = -1; // byte offset, -1 if unknown
+    };
+    using Entries = std::vector<Entry>;
+
+    ~KeyframeIndex();
+
+    // Returns the index of filepath, loading the sidecar if there is a valid one.
+    // Null for non local files.
+    static auto fromFile(const QString &filepath, int streamIndex) -> QSharedPointer<KeyframeIndex>;
+    // Scans the file in a worker thread if the index is not complete yet
+    static void buildAsync(const QSharedPointer<KeyframeIndex> &index);
+
+    [[nodiscard]] auto filePath() const -> QString;
+    [[nodiscard]] auto streamIndex() const -> int;
+    [[nodiscard]] auto isComplete() const -> bool;
+    [[nodiscard]] auto size() const -> qint64;
+
+    // The last keyframe at or before timestamp (microsecond)
+    auto findKeyframe(qint64 timestamp, Entry &entry) const -> bool;
+    // The first keyframe at or after timestamp (microsecond)
+    auto findKeyframeAfter(qint64 timestamp, Entry &entry) const -> bool;
+
+    void setEntries(Entries &&entries);
+
+    [[nodiscard]] auto sidecarPath() const -> QString;
+
+private:
+    KeyframeIndex(const QString &filepath, int streamIndex);
+
+    auto load() -> bool;
+    auto save() -> bool;
+    // Oldest sidecars first, above s_maxCacheBytes or older than s_maxCacheAge
+    static void trimCache();
+
+    class KeyframeIndexPrivate;
+    QScopedPointer<KeyframeIndexPrivate> d_ptr;
+
+    friend class KeyframeIndexTask;
+};
+
+using KeyframeIndexPtr = QSharedPointer<KeyframeIndex>;
+
+} // namespace Ffmpeg
@@ -18,6 +18,8 @@ public:
 
     Packet *q_ptr;
     AVPacket *packet = nullptr;
+    qint64 serial = 0;
+    qint64 trackedBytes = 0; // counted by a PacketPool
 };
 
 Packet::Packet()
@@ -34,6 +36,7 @@ Packet::Packet(const Packet &other)
     : d_ptr(new PacketPrivate(this))
 {
     d_ptr->packet = av_packet_clone(other.d_ptr->packet);
+    d_ptr->serial = other.d_ptr->serial;
 
     if (d_ptr->packet == nullptr) {
         qWarning() << "Could not clone packet";
@@ -44,6 +47,7 @@ Packet::Packet(Packet &&other) noexcept
     : d_ptr(new PacketPrivate(this))
 {
     d_ptr->packet = other.d_ptr->packet;
+    d_ptr->serial = other.d_ptr->serial;
     other.d_ptr->packet = nullptr;
 }
 
@@ -52,7 +56,9 @@ Packet::~Packet() = default;
 auto Packet::operator=(const Packet &other) -> Packet &
 {
     if (this != &other) {
+        av_packet_free(&d_ptr->packet);
         d_ptr->packet = av_packet_clone(other.d_ptr->packet);
+        d_ptr->serial = other.d_ptr->serial;
 
         if (d_ptr->packet == nullptr) {
             qWarning() << "Could not clone packet";
@@ -65,7 +71,9 @@ auto Packet::operator=(const Packet &other) -> Packet &
 auto Packet::operator=(Packet &&other) noexcept -> Packet &
 {
     if (this != &other) {
+        av_packet_free(&d_ptr->packet);
         d_ptr->packet = other.d_ptr->packet;
+        d_ptr->serial = other.d_ptr->serial;
         other.d_ptr->packet = nullptr;
     }
 
@@ -128,6 +136,16 @@ auto Packet::streamIndex() const -> int
     return d_ptr->packet->stream_index;
 }
 
+void Packet::setSerial(qint64 serial)
+{
+    d_ptr->serial = serial;
+}
+
+auto Packet::serial() const -> qint64
+{
+    return d_ptr->serial;
+}
+
 void Packet::rescaleTs(const AVRational &srcTimeBase, const AVRational &dstTimeBase)
 {
     Q_ASSERT(nullptr != d_ptr->packet);
@@ -140,4 +158,38 @@ auto Packet::avPacket() -> AVPacket *
     return d_ptr->packet;
 }
 
+PacketPool::PacketPool(size_t capacity)
+    : PacketPool(capacity, Counter::create(0))
+{}
+
+PacketPool::PacketPool(size_t capacity, const Counter &liveBytes)
+    : Utils::ObjectPool<Packet>(capacity,
+                                [liveBytes](Packet *packet) {
+                                    liveBytes->fetch_sub(packet->d_ptr->trackedBytes,
+                                                         std::memory_order_relaxed);
+                                    packet->d_ptr->trackedBytes = 0;
+                                    auto *avPacket = packet->d_ptr->packet;
+                                    if (avPacket == nullptr) {
+                                        return false;
+                                    }
+                                    av_packet_unref(avPacket);
+                                    packet->d_ptr->serial = 0;
+                                    return true;
+                                })
+    , m_liveBytes(liveBytes)
+{}
+
+void PacketPool::track(const PacketPtr &packetPtr)
+{
+    auto *d = packetPtr->d_ptr.data();
+    auto bytes = d->packet->size - d->trackedBytes;
+    d->trackedBytes = d->packet->size;
+    m_liveBytes->fetch_add(bytes, std::memory_order_relaxed);
+}
+
+auto PacketPool::liveBytes() const -> qint64
+{
+    return m_liveBytes->load(std::memory_order_relaxed);
+}
+
 } // namespace Ffmpeg
@@ -5,6 +5,8 @@
 
 #include <QtCore>
 
+#include <utils/objectpool.hpp>
+
 struct AVPacket;
 struct AVRational;
 
@@ -36,6 +38,10 @@ public:
     void setStreamIndex(int index);
     [[nodiscard]] auto streamIndex() const -> int;
 
+    // Clock serial at demux time, packets of an older serial are stale after a seek
+    void setSerial(qint64 serial);
+    [[nodiscard]] auto serial() const -> qint64;
+
     void rescaleTs(const AVRational &srcTimeBase, const AVRational &dstTimeBase);
 
     auto avPacket() -> AVPacket *;
@@ -43,10 +49,32 @@ public:
 private:
     class PacketPrivate;
     QScopedPointer<PacketPrivate> d_ptr;
+
+    friend class PacketPool;
 };
 
 using PacketPtr = QSharedPointer<Packet>;
 
+// Packet and AVPacket shells of one demuxer, the data is unreferenced as soon as the
+// last user drops a packet
+class FFMPEG_EXPORT PacketPool : public Utils::ObjectPool<Packet>
+{
+public:
+    explicit PacketPool(size_t capacity = 256);
+
+    // Counts the data of a filled packet until it is released
+    void track(const PacketPtr &packetPtr);
+    // Data read through the pool and still held by a queue, decoder or prefetch
+    [[nodiscard]] auto liveBytes() const -> qint64;
+
+private:
+    using Counter = QSharedPointer<std::atomic<qint64>>;
+
+    PacketPool(size_t capacity, const Counter &liveBytes);
+
+    Counter m_liveBytes;
+};
+
 } // namespace Ffmpeg
 
 #endif // PACKET_H
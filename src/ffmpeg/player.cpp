@@ -5,15 +5,18 @@
 #include "clock.hpp"
 #include "codeccontext.h"
 #include "formatcontext.h"
+#include "gopcache.hpp"
 #include "mediainfo.hpp"
 #include "packet.h"
 #include "subtitledecoder.h"
 #include "videodecoder.h"
 
 #include <event/errorevent.hpp>
+#include <event/propertychannel.hpp>
 #include <event/seekevent.hpp>
 #include <event/trackevent.hpp>
 #include <event/valueevent.hpp>
+#include <utils/executor.hpp>
 #include <utils/speed.hpp>
 #include <utils/threadsafequeue.hpp>
 #include <utils/utils.h>
@@ -43,6 +46,38 @@ public:
         videoDecoder = new VideoDecoder(q_ptr);
         subtitleDecoder = new SubtitleDecoder(q_ptr);
 
+        propertyChannel = new PropertyChannel(q_ptr);
+        gopCache = new GopCache(q_ptr);
+        // Runs on the video display thread
+        QObject::connect(
+            videoDecoder,
+            &VideoDecoder::positionChanged,
+            q_ptr,
+            [this](qint64) { countVideoFrame(); },
+            Qt::DirectConnection);
+
+        audioDecoder->setClockDomain(&clockDomain);
+        videoDecoder->setClockDomain(&clockDomain);
+        subtitleDecoder->setClockDomain(&clockDomain);
+
+        audioDecoder->setQueuePolicy(QueuePolicy::audioDefault());
+        videoDecoder->setQueuePolicy(QueuePolicy::videoDefault());
+        subtitleDecoder->setQueuePolicy(QueuePolicy::subtitleDefault());
+
+        QObject::connect(audioDecoder,
+                         &AudioDecoder::seekLanded,
+                         q_ptr,
+                         [this](const EventPtr &eventPtr, qint64 position) {
+                             addSeekLandedEvent(AVMEDIA_TYPE_AUDIO, eventPtr, position);
+                         });
+        QObject::connect(videoDecoder,
+                         &VideoDecoder::seekLanded,
+                         q_ptr,
+                         [this](const EventPtr &eventPtr, qint64 position) {
+                             addSeekLandedEvent(AVMEDIA_TYPE_VIDEO, eventPtr, position);
+                         });
+        formatCtx->setInterruptCallback([this] { return !runing.load(); });
+        QObject::connect(q_ptr, &QThread::finished, q_ptr, [this] { finishPendingClose(); });
         QObject::connect(AVErrorManager::instance(),
                          &AVErrorManager::error,
                          q_ptr,
@@ -54,10 +89,17 @@ public:
     auto initAvCodec() -> bool
     {
         isOpen = false;
+        QElapsedTimer timer;
+        timer.start();
+        auto failed = qScopeGuard([&] {
+            addPropertyChangeEvent(new OpenProgressEvent(OpenProgressEvent::Failed, timer.elapsed()));
+        });
+        addPropertyChangeEvent(new OpenProgressEvent(OpenProgressEvent::Opening, 0));
         //初始化pFormatCtx结构
         if (!formatCtx->openFilePath(filepath)) {
             return false;
         }
+        addPropertyChangeEvent(new OpenProgressEvent(OpenProgressEvent::Probing, timer.elapsed()));
         //获取音视频流数据信息
         if (!formatCtx->findStream()) {
             return false;
@@ -69,8 +111,11 @@ public:
         if (!audioInfo->isIndexVaild() && !videoInfo->isIndexVaild()) {
             return false;
         }
+        failed.dismiss();
+        addPropertyChangeEvent(new OpenProgressEvent(OpenProgressEvent::Opened, timer.elapsed()));
         isOpen = true;
         formatCtx->dumpFormat();
+        initKeyframeIndex();
 
         addPropertyChangeEvent(new DurationEvent(formatCtx->duration()));
         q_ptr->onPositionChanged(0);
@@ -78,6 +123,23 @@ public:
         return true;
     }
 
+    void initKeyframeIndex()
+    {
+        if (!videoInfo->isIndexVaild()) {
+            formatCtx->setKeyframeIndex({});
+            return;
+        }
+        auto keyframeIndex = formatCtx->keyframeIndex();
+        if (keyframeIndex.isNull() || keyframeIndex->streamIndex() != videoInfo->index()) {
+            keyframeIndex = KeyframeIndex::fromFile(filepath, videoInfo->index());
+            formatCtx->setKeyframeIndex(keyframeIndex);
+        }
+        // Containers with a complete native index do not need the scan
+        if (avformat_index_get_entries_count(videoInfo->stream()) <= 0) {
+            KeyframeIndex::buildAsync(keyframeIndex);
+        }
+    }
+
     auto setBestMediaIndex() -> bool
     {
         audioInfo->resetIndex();
@@ -154,11 +216,14 @@ public:
         }
     }
 
-    void startDecoder()
+    void startDecoder(bool seekFirstFrame = true)
     {
         formatCtx->discardStreamExcluded(
             {audioInfo->index(), videoInfo->index(), subtitleInfo->index()});
-        formatCtx->seekFirstFrame();
+        if (seekFirstFrame) {
+            formatCtx->seekFirstFrame();
+        }
+        resetReplay();
 
         videoDecoder->startDecoder(formatCtx, videoInfo);
         subtitleDecoder->startDecoder(formatCtx, subtitleInfo);
@@ -171,7 +236,7 @@ public:
         } else {
             Q_ASSERT(false);
         }
-        Clock::master()->invalidate();
+        clockDomain.master()->invalidate();
 
         speedPtr.reset(new Utils::Speed);
         speedTimer.restart();
@@ -191,7 +256,7 @@ public:
     {
         speedPtr->addSize(size);
         if (speedTimer.hasExpired(1000)) {
-            addPropertyChangeEvent(new CacheSpeedEvent(speedPtr->getSpeed()));
+            propertyChannel->setCacheSpeed(speedPtr->getSpeed());
             speedTimer.restart();
         }
     }
@@ -202,35 +267,512 @@ public:
         setMediaState(Playing);
         startDecoder();
 
+        stepPosition = -1;
         while (runing) {
             processEvent();
+            finishMediaChange();
+            if (reversePlaying.load()) {
+                playReverseFrame();
+                continue;
+            }
+            updateTrickPlay();
 
-            PacketPtr packetPtr(new Packet);
+            auto packetPtr = packetPool.acquire();
             if (!formatCtx->readFrame(packetPtr.data())) {
+                // A seek or reverse playback during the drain goes on reading
+                if (processPendingSeek(true) || playNextMedia() || !drainDecoder()) {
+                    continue;
+                }
                 break;
             }
+            packetPool.track(packetPtr);
             addSpeedChangeEvent(packetPtr->avPacket()->size);
+            packetPtr->setSerial(clockDomain.serial());
+            if (isReplayed(packetPtr)) {
+                continue;
+            }
 
-            auto stream_index = packetPtr->streamIndex();
             if (!formatCtx->checkPktPlayRange(packetPtr.data())) {
-            } else if (stream_index == audioInfo->index()) { // 如果是音频数据
-                audioDecoder->append(packetPtr);
-            } else if (stream_index == videoInfo->index()
-                       && ((videoInfo->stream()->disposition & AV_DISPOSITION_ATTACHED_PIC)
-                           == 0)) { // 如果是视频数据
-                videoDecoder->append(packetPtr);
-            } else if (stream_index == subtitleInfo->index()) { // 如果是字幕数据
-                subtitleDecoder->append(packetPtr);
+                continue;
+            }
+            if (trickPlaying.load() && !acceptTrickPlayPacket(packetPtr)) {
+                continue;
+            }
+            setDemuxedTs(packetPtr);
+            prefetchNearEnd(packetPtr);
+            appendPacket(std::move(packetPtr));
+            if (trickPlaying.load()) {
+                skipToTrickPlayNext();
             }
         }
-        while (runing && (videoDecoder->size() > 0 || audioDecoder->size() > 0)) {
-            msleep(s_waitQueueEmptyMilliseconds);
-        }
+        stopTrickPlay();
+        reversePlaying.store(false);
+        pendingSeekPtr.reset();
+        prefetchTasks.waitForDone();
+        nextMediaPtr.reset();
         stopDecoder();
+        finishMediaChange();
         setMediaState(Stopped);
         qInfo() << "play finish";
     }
 
+    // Queues the end of stream behind the last packets and waits until the last audio and
+    // video frames are presented, false if closed, seeked or reversed meanwhile. Events are
+    // handled between short waits, a pause parks the decoders and the demuxer as usual.
+    auto drainDecoder() -> bool
+    {
+        QElapsedTimer timer;
+        timer.start();
+        audioDecoder->appendEndOfStream();
+        videoDecoder->appendEndOfStream();
+        subtitleDecoder->appendEndOfStream();
+        // A close before this point is seen here, a later one wakes the waits
+        if (!runing.load()) {
+            return false;
+        }
+        auto serial = clockDomain.serial();
+        auto finished = false;
+        while (runing.load()) {
+            QDeadlineTimer deadline(s_drainSliceMs);
+            if (audioDecoder->waitForFinished(deadline)
+                && videoDecoder->waitForFinished(deadline)) {
+                finished = true;
+                break;
+            }
+            processEvent();
+            if (processPendingSeek(true) || clockDomain.serial() != serial
+                || reversePlaying.load()) {
+                break;
+            }
+        }
+        qInfo() << "Drain finished:" << finished << "elapsed:" << timer.elapsed() << "ms";
+        return finished && runing.load();
+    }
+
+    // Follows the speed on the demux thread, from trickPlaySpeed on the demuxer hands
+    // spaced keyframes to the video decoder only and the audio is muted by starving it
+    void updateTrickPlay()
+    {
+        auto threshold = trickPlaySpeed.load();
+        auto trickPlay = threshold > 0 && clockDomain.speed() >= threshold
+                         && videoInfo->isIndexVaild()
+                         && (videoInfo->stream()->disposition & AV_DISPOSITION_ATTACHED_PIC) == 0;
+        if (trickPlay == trickPlaying.load()) {
+            return;
+        }
+        if (!trickPlay) {
+            stopTrickPlay();
+            // Audio and subtitles start again where the keyframes got to
+            setPendingSeek(EventPtr(new SeekEvent(position.load())));
+            processPendingSeek(true);
+            return;
+        }
+        trickPlaying.store(true);
+        trickPlayNext = 0;
+        trickPlayLast = 0;
+        audioDecoder->clear();
+        subtitleDecoder->clear();
+        videoDecoder->setKeyframesOnly(true);
+        videoDecoder->setMasterClock();
+        clockDomain.master()->invalidate();
+        qInfo() << "Trick play started, speed:" << clockDomain.speed();
+    }
+
+    void stopTrickPlay()
+    {
+        if (!trickPlaying.load()) {
+            return;
+        }
+        trickPlaying.store(false);
+        videoDecoder->setKeyframesOnly(false);
+        if (audioInfo->isIndexVaild()) {
+            audioDecoder->setMasterClock();
+        }
+        clockDomain.master()->invalidate();
+        qInfo() << "Trick play stopped, speed:" << clockDomain.speed();
+    }
+
+    // Keeps video keyframes at least one step of wall time apart, drops everything else
+    auto acceptTrickPlayPacket(const PacketPtr &packetPtr) -> bool
+    {
+        auto *avPacket = packetPtr->avPacket();
+        if (avPacket->stream_index != videoInfo->index()
+            || (avPacket->flags & AV_PKT_FLAG_KEY) == 0) {
+            return false;
+        }
+        auto ts = avPacket->pts != AV_NOPTS_VALUE ? avPacket->pts : avPacket->dts;
+        if (ts == AV_NOPTS_VALUE) {
+            return true;
+        }
+        auto pts = av_rescale_q(ts, videoInfo->timebase(), AV_TIME_BASE_Q);
+        if (pts < trickPlayNext) {
+            return false;
+        }
+        trickPlayLast = pts;
+        trickPlayNext = pts + static_cast<qint64>(s_trickPlayInterval * clockDomain.speed());
+        return true;
+    }
+
+    // Seeks over the groups of pictures the next step would drop anyway
+    void skipToTrickPlayNext()
+    {
+        qint64 keyframe = 0;
+        if (!findKeyframe(trickPlayNext, keyframe) || keyframe <= trickPlayLast) {
+            return;
+        }
+        formatCtx->seek(keyframe);
+    }
+
+    // The last video keyframe at or before timestamp, from the keyframe index or the
+    // index of the container
+    auto findKeyframe(qint64 timestamp, qint64 &pts) -> bool
+    {
+        auto keyframeIndex = formatCtx->keyframeIndex();
+        KeyframeIndex::Entry entry;
+        if (!keyframeIndex.isNull() && keyframeIndex->isComplete()
+            && keyframeIndex->findKeyframe(timestamp, entry)) {
+            pts = entry.pts;
+            return true;
+        }
+        auto *stream = videoInfo->stream();
+        auto index = av_index_search_timestamp(stream,
+                                               av_rescale_q(timestamp,
+                                                            AV_TIME_BASE_Q,
+                                                            stream->time_base),
+                                               AVSEEK_FLAG_BACKWARD);
+        const auto *indexEntry = index >= 0 ? avformat_index_get_entry(stream, index) : nullptr;
+        if (indexEntry == nullptr) {
+            return false;
+        }
+        pts = av_rescale_q(indexEntry->timestamp, stream->time_base, AV_TIME_BASE_Q);
+        return true;
+    }
+
+    // Moves the reference into the queue, a dropped packet goes straight back to the pool
+    void appendPacket(PacketPtr packetPtr)
+    {
+        auto stream_index = packetPtr->streamIndex();
+        if (stream_index == audioInfo->index()) { // 如果是音频数据
+            audioDecoder->append(std::move(packetPtr));
+        } else if (stream_index == videoInfo->index()
+                   && ((videoInfo->stream()->disposition & AV_DISPOSITION_ATTACHED_PIC)
+                       == 0)) { // 如果是视频数据
+            videoDecoder->append(std::move(packetPtr));
+        } else if (stream_index == subtitleInfo->index()) { // 如果是字幕数据
+            subtitleDecoder->append(std::move(packetPtr));
+        }
+    }
+
+    struct NextMedia
+    {
+        QString filepath;
+        QScopedPointer<FormatContext> formatCtx;
+        QScopedPointer<AVContextInfo> audioInfo;
+        QScopedPointer<AVContextInfo> videoInfo;
+        QScopedPointer<AVContextInfo> subtitleInfo;
+        QVector<PacketPtr> packets;
+        bool opened = false; // written by the prefetch, read after waitForDone()
+    };
+
+    // Starts the prefetch once the demuxer is less than s_prefetchLead before the end, the
+    // next media is ready before the current one is drained
+    void prefetchNearEnd(const PacketPtr &packetPtr)
+    {
+        if (!nextMediaPtr.isNull()) {
+            return;
+        }
+        auto *avPacket = packetPtr->avPacket();
+        auto ts = avPacket->dts != AV_NOPTS_VALUE ? avPacket->dts : avPacket->pts;
+        auto duration = formatCtx->duration();
+        if (ts == AV_NOPTS_VALUE || duration <= 0) {
+            return;
+        }
+        auto demuxed = av_rescale_q(ts,
+                                    formatCtx->stream(avPacket->stream_index)->time_base,
+                                    AV_TIME_BASE_Q);
+        if (duration - demuxed > s_prefetchLead) {
+            return;
+        }
+        startPrefetch(q_ptr->nextMedia());
+    }
+
+    void startPrefetch(const QString &filepath)
+    {
+        if (filepath.isEmpty()) {
+            return;
+        }
+        nextMediaPtr.reset(new NextMedia);
+        nextMediaPtr->filepath = filepath;
+        prefetchTasks.start([this,
+                             next = nextMediaPtr,
+                             timeouts = q_ptr->ioTimeouts(),
+                             gpu = gpuDecode.load()] {
+            next->opened = prefetchNextMedia(*next, timeouts, gpu);
+        });
+    }
+
+    // The prefetched next media, waits for the prefetch or runs it now if it was not
+    // started or the next media was changed since. Null if there is none or it failed.
+    auto takeNextMedia() -> QSharedPointer<NextMedia>
+    {
+        auto filepath = q_ptr->nextMedia();
+        if (!nextMediaPtr.isNull() && nextMediaPtr->filepath != filepath) {
+            prefetchTasks.waitForDone();
+            nextMediaPtr.reset();
+        }
+        if (nextMediaPtr.isNull()) {
+            startPrefetch(filepath);
+        }
+        if (nextMediaPtr.isNull()) {
+            return {};
+        }
+        prefetchTasks.waitForDone();
+        auto next = std::exchange(nextMediaPtr, {});
+        // Tried once, a failed one is not opened again at every end of stream
+        clearNextFilepath(next->filepath);
+        if (!next->opened) {
+            return {};
+        }
+        return next;
+    }
+
+    void clearNextFilepath(const QString &filepath)
+    {
+        QMutexLocker locker(&nextMutex);
+        if (nextFilepath == filepath) {
+            nextFilepath.clear();
+        }
+    }
+
+    // On prefetchTasks: opens, probes and reads the first packets of the next media, then
+    // decodes them once so the codecs have set up their threads and hardware frames before
+    // the handover. The codecs are flushed, the decoders decode the packets again.
+    auto prefetchNextMedia(NextMedia &next, const FormatContext::Timeouts &timeouts, bool gpu)
+        -> bool
+    {
+        QElapsedTimer timer;
+        timer.start();
+        // This thread has no event loop, the objects are handed to the player's thread
+        // before returning, only this thread can move them
+        auto moveObjects = qScopeGuard([&] {
+            auto *thread = q_ptr->thread();
+            for (QObject *object : std::initializer_list<QObject *>{next.formatCtx.data(),
+                                                                    next.audioInfo.data(),
+                                                                    next.videoInfo.data(),
+                                                                    next.subtitleInfo.data()}) {
+                if (object != nullptr) {
+                    object->moveToThread(thread);
+                }
+            }
+        });
+        next.formatCtx.reset(new FormatContext);
+        next.formatCtx->setTimeouts(timeouts);
+        next.formatCtx->setInterruptCallback([this] { return !runing.load(); });
+        if (!next.formatCtx->openFilePath(next.filepath) || !next.formatCtx->findStream()) {
+            qWarning() << "Prefetch failed:" << next.filepath;
+            return false;
+        }
+        auto openStream = [&](QScopedPointer<AVContextInfo> &info, AVMediaType mediaType) {
+            info.reset(new AVContextInfo);
+            auto index = next.formatCtx->findBestStreamIndex(mediaType);
+            if (index < 0) {
+                return;
+            }
+            info->setIndex(index);
+            info->setStream(next.formatCtx->stream(index));
+            if (!info->initDecoder(next.formatCtx->guessFrameRate(index))
+                || !info->openCodec(gpu ? AVContextInfo::GpuType::GpuDecode
+                                        : AVContextInfo::GpuType::NotUseGpu)) {
+                info->resetIndex();
+            }
+        };
+        openStream(next.audioInfo, AVMEDIA_TYPE_AUDIO);
+        openStream(next.videoInfo, AVMEDIA_TYPE_VIDEO);
+        openStream(next.subtitleInfo, AVMEDIA_TYPE_SUBTITLE);
+        if (!next.audioInfo->isIndexVaild() && !next.videoInfo->isIndexVaild()) {
+            return false;
+        }
+        next.formatCtx->discardStreamExcluded(
+            {next.audioInfo->index(), next.videoInfo->index(), next.subtitleInfo->index()});
+
+        bool audioPrimed = !next.audioInfo->isIndexVaild();
+        bool videoPrimed = !next.videoInfo->isIndexVaild();
+        while (runing && (!audioPrimed || !videoPrimed)
+               && next.packets.size() < s_prefetchPacketCount) {
+            auto packetPtr = packetPool.acquire();
+            if (!next.formatCtx->readFrame(packetPtr.data())) {
+                break;
+            }
+            packetPool.track(packetPtr);
+            auto streamIndex = packetPtr->streamIndex();
+            if (!audioPrimed && streamIndex == next.audioInfo->index()) {
+                audioPrimed = !next.audioInfo->decodeFrame(packetPtr).empty();
+            } else if (!videoPrimed && streamIndex == next.videoInfo->index()) {
+                videoPrimed = !next.videoInfo->decodeFrame(packetPtr).empty();
+            }
+            next.packets.append(std::move(packetPtr));
+        }
+        for (auto *info : {next.audioInfo.data(), next.videoInfo.data()}) {
+            if (info->isIndexVaild()) {
+                info->codecCtx()->flush();
+            }
+        }
+        qInfo() << "Prefetched" << next.filepath << "primed:" << (audioPrimed && videoPrimed)
+                << "elapsed:" << timer.elapsed() << "ms";
+        return true;
+    }
+
+    // Switches to the next media at the end of stream, false when there is none
+    auto playNextMedia() -> bool
+    {
+        auto nextPtr = takeNextMedia();
+        if (nextPtr.isNull()) {
+            return false;
+        }
+        auto &next = *nextPtr;
+        // Trick play starves the audio, a handover would never be seen through by it
+        if (!mediaChanging && !trickPlaying.load()
+            && audioInfo->isIndexVaild() == next.audioInfo->isIndexVaild()
+            && videoInfo->isIndexVaild() == next.videoInfo->isIndexVaild()) {
+            handOverNextMedia(next);
+            return true;
+        }
+        return restartNextMedia(next);
+    }
+
+    // Gapless, the running decoders get the next media and switch to it at its first packet,
+    // once the tail of the current one is drained. Reported by finishMediaChange().
+    void handOverNextMedia(NextMedia &next)
+    {
+        clockDomain.mediaSerialRef();
+        auto serial = clockDomain.serial();
+        auto *nextFormatCtx = next.formatCtx.data();
+        audioDecoder->setNextMedia(serial, nextFormatCtx, next.audioInfo.data());
+        videoDecoder->setNextMedia(serial, nextFormatCtx, next.videoInfo.data());
+        auto subtitleHandover = subtitleInfo->isIndexVaild() && next.subtitleInfo->isIndexVaild();
+        if (subtitleHandover) {
+            subtitleDecoder->setNextMedia(serial, nextFormatCtx, next.subtitleInfo.data());
+        } else {
+            subtitleDecoder->stopDecoder();
+        }
+        replaceMedia(next);
+        formatCtx->discardStreamExcluded(
+            {audioInfo->index(), videoInfo->index(), subtitleInfo->index()});
+        subtitleDecoder->setVideoResolutionRatio(resolutionRatio());
+        if (!subtitleHandover) {
+            subtitleDecoder->startDecoder(formatCtx, subtitleInfo);
+        }
+        initKeyframeIndex();
+        appendPackets(next.packets);
+        mediaChanging = true;
+        qInfo() << "Hand over to next media:" << filepath;
+    }
+
+    // The streams differ, the decoders are drained, stopped and started again
+    auto restartNextMedia(NextMedia &next) -> bool
+    {
+        // Closed, or playback went on from a seek
+        if (!drainDecoder()) {
+            return runing.load();
+            return false;
+        }
+
+        audioDecoder->setHoldOutput(audioInfo->isIndexVaild() && next.audioInfo->isIndexVaild());
+        // Picked up again for the next media by updateTrickPlay()
+        stopTrickPlay();
+        stopDecoder();
+        // A handover still pending is done once the decoders stopped
+        finishMediaChange();
+        replaceMedia(next);
+        releaseRetiredObjects();
+        subtitleDecoder->setVideoResolutionRatio(resolutionRatio());
+        initKeyframeIndex();
+        startDecoder(false);
+        appendPackets(next.packets);
+        reportMediaChanged();
+        return true;
+    }
+
+    void replaceMedia(NextMedia &next)
+    {
+        replaceObject(formatCtx, next.formatCtx);
+        replaceObject(audioInfo, next.audioInfo);
+        replaceObject(videoInfo, next.videoInfo);
+        replaceObject(subtitleInfo, next.subtitleInfo);
+        {
+            QMutexLocker locker(&contextMutex);
+            filepath = next.filepath;
+        }
+        meidaIndex.resetIndex();
+        position = 0;
+        resetReplay();
+    }
+
+    void appendPackets(QVector<PacketPtr> &packets)
+    {
+        for (auto &packetPtr : packets) {
+            packetPtr->setSerial(clockDomain.serial());
+            setDemuxedTs(packetPtr);
+            appendPacket(std::move(packetPtr));
+        }
+        packets.clear();
+    }
+
+    // Once every stage plays the next media, the previous one is released and reported
+    void finishMediaChange()
+    {
+        if (!mediaChanging || audioDecoder->isMediaChangePending()
+            || videoDecoder->isMediaChangePending() || subtitleDecoder->isMediaChangePending()) {
+            return;
+        }
+        mediaChanging = false;
+        releaseRetiredObjects();
+        if (runing.load()) {
+            reportMediaChanged();
+        }
+    }
+
+    void reportMediaChanged()
+    {
+        for (const auto &track : formatCtx->videoTracks()) {
+            if (track.index == videoInfo->index()) {
+                setMusicCover(track.image);
+            }
+        }
+        addPropertyChangeEvent(new MediaChangedEvent(filepath));
+        addPropertyChangeEvent(new DurationEvent(formatCtx->duration()));
+        addPropertyChangeEvent(new MediaTrackEvent(mediaTracks()));
+        q_ptr->onPositionChanged(0);
+        qInfo() << "Play next media:" << filepath;
+    }
+
+    // Getters on the main thread may still use the old object, and the decoders until
+    // releaseRetiredObjects()
+    template<typename T>
+    void replaceObject(T *&object, QScopedPointer<T> &other)
+    {
+        if (other->thread() == QThread::currentThread()) {
+            other->moveToThread(q_ptr->thread());
+        }
+        // Only the thread an object lives in can move it, the prefetch moves its own
+        if (other->thread() != q_ptr->thread()) {
+            qWarning() << "Replaced by an object of another thread:" << other.data();
+        }
+        Q_ASSERT(other->thread() == q_ptr->thread());
+        QMutexLocker locker(&contextMutex);
+        retiredObjects.append(object);
+        object = other.take();
+        object->setParent(q_ptr);
+    }
+
+    void releaseRetiredObjects()
+    {
+        for (auto *object : std::as_const(retiredObjects)) {
+            object->deleteLater();
+        }
+        retiredObjects.clear();
+    }
+
     auto setMediaIndex(AVContextInfo *contextInfo, int index) const -> bool
     {
         contextInfo->setIndex(index);
@@ -245,7 +787,10 @@ public:
     void setMediaState(MediaState mediaState_)
     {
         mediaState = mediaState_;
-        addPropertyChangeEvent(new MediaStateEvent(mediaState));
+        propertyChannel->setMediaState(mediaState);
+        if (mediaState == MediaState::Stopped) {
+            propertyChannel->setFps(0);
+        }
     }
 
     [[nodiscard]] auto resolutionRatio() const -> QSize
@@ -261,11 +806,37 @@ public:
 
     void addPropertyChangeEvent(PropertyChangeEvent *event)
     {
-        propertyChangeEventQueue.append(PropertyChangeEventPtr(event));
-        while (propertyChangeEventQueue.size() > maxPropertyEventQueueSize.load()) {
-            propertyChangeEventQueue.take();
+        propertyChannel->addEvent(event);
+    }
+
+    void countVideoFrame()
+    {
+        if (!fpsTimer.isValid()) {
+            fpsTimer.start();
+            frameCount = 0;
+            return;
+        }
+        frameCount++;
+        auto elapsed = fpsTimer.elapsed();
+        if (elapsed >= 1000) {
+            propertyChannel->setFps(frameCount * 1000.0 / elapsed);
+            frameCount = 0;
+            fpsTimer.restart();
         }
-        emit q_ptr->eventIncrease();
+    }
+
+    void addSeekLandedEvent(AVMediaType mediaType, const EventPtr &eventPtr, qint64 position)
+    {
+        auto *seekEvent = static_cast<SeekEvent *>(eventPtr.data());
+        auto *landedEvent = new SeekLandedEvent(mediaType,
+                                                seekEvent->mode(),
+                                                seekEvent->position(),
+                                                position,
+                                                seekEvent->elapsed());
+        qInfo() << "Seek landed:" << av_get_media_type_string(mediaType)
+                << "error:" << landedEvent->error() / 1000 << "ms"
+                << "latency:" << landedEvent->latency() << "ms";
+        addPropertyChangeEvent(landedEvent);
     }
 
     void addEvent(const EventPtr &eventPtr)
@@ -278,7 +849,8 @@ public:
             return;
         }
         switch (eventPtr->type()) {
-        case Event::EventType::Pause: break;
+        case Event::EventType::Pause:
+        case Event::EventType::Reverse: break;
         default: {
             eventQueue.append(EventPtr(new PauseEvent(true)));
         } break;
@@ -291,12 +863,49 @@ public:
         while (!eventQueue.empty()) {
             auto eventPtr = eventQueue.take();
             switch (eventPtr->type()) {
-            case Event::EventType::Pause: processPauseEvent(eventPtr); break;
-            case Event::EventType::Seek: processSeekEvent(eventPtr); break;
+            case Event::EventType::Pause:
+                processPendingSeek(true);
+                processPauseEvent(eventPtr);
+                break;
+            case Event::EventType::Seek: setPendingSeek(eventPtr); break;
             case Event::EventType::SeekRelative: processSeekRelativeEvent(eventPtr); break;
+            case Event::EventType::StepFrame:
+                processPendingSeek(true);
+                processStepFrameEvent(eventPtr);
+                break;
+            case Event::EventType::Reverse: processReverseEvent(eventPtr); break;
+            case Event::EventType::AudioTarck:
+            case Event::EventType::VideoTrack:
+            case Event::EventType::SubtitleTrack: processSwitchTrackEvent(eventPtr); break;
+            case Event::EventType::Gpu: processSwitchGpuEvent(eventPtr); break;
             default: break;
             }
         }
+        processPendingSeek(false);
+    }
+
+    // Only the latest of the queued seeks is executed
+    void setPendingSeek(const EventPtr &eventPtr)
+    {
+        if (!pendingSeekPtr.isNull()) {
+            coalescedSeeks.fetch_add(1);
+        }
+        pendingSeekPtr = eventPtr;
+    }
+
+    auto processPendingSeek(bool force) -> bool
+    {
+        if (pendingSeekPtr.isNull()) {
+            return false;
+        }
+        if (!force && seekTimer.isValid() && !seekTimer.hasExpired(minSeekInterval.load())) {
+            return false;
+        }
+        auto eventPtr = pendingSeekPtr;
+        pendingSeekPtr.reset();
+        processSeekEvent(eventPtr);
+        seekTimer.restart();
+        return true;
     }
 
     void processEvent(const EventPtr &eventPtr)
@@ -318,11 +927,27 @@ public:
     }
 
     void processPauseEvent(const EventPtr &eventPtr)
+    {
+        setPaused(eventPtr);
+        if (paused.load()) {
+            QMutexLocker locker(&mutex);
+            waitCondition.wait(&mutex);
+        } else {
+            clockDomain.master()->invalidate();
+        }
+    }
+
+    // Pauses or resumes the decoders without parking the demuxer
+    void setPaused(const EventPtr &eventPtr)
     {
         auto *pauseEvent = dynamic_cast<PauseEvent *>(eventPtr.data());
+        reversePlaying.store(false);
+        if (!pauseEvent->paused()) {
+            resumeAtStep();
+        }
         if (pauseEvent->paused()) {
             setMediaState(MediaState::Pausing);
-            addPropertyChangeEvent(new CacheSpeedEvent(0));
+            propertyChannel->setCacheSpeed(0);
         } else if (q_ptr->isRunning()) {
             setMediaState(isOpen ? MediaState::Playing : MediaState::Opening);
         } else {
@@ -332,54 +957,142 @@ public:
         videoDecoder->addEvent(eventPtr);
         subtitleDecoder->addEvent(eventPtr);
         paused.store(pauseEvent->paused());
-        if (paused.load()) {
-            QMutexLocker locker(&mutex);
-            waitCondition.wait(&mutex);
-        } else {
-            Clock::master()->invalidate();
+    }
+
+    // Stepping and reverse playback show frames of the GOP cache while the decoders are
+    // paused, playback resumes at the last frame shown
+    auto openGopCache() -> bool
+    {
+        if (!videoInfo->isIndexVaild()
+            || (videoInfo->stream()->disposition & AV_DISPOSITION_ATTACHED_PIC) != 0) {
+            return false;
+        }
+        if (gopCache->isOpen() && gopCache->filePath() == filepath
+            && gopCache->videoIndex() == videoInfo->index()) {
+            return true;
         }
+        return gopCache->open(filepath, videoInfo->index());
     }
 
-    void processSeekEvent(const EventPtr &eventPtr)
+    void showSteppedFrame(const FramePtr &framePtr)
     {
-        QElapsedTimer timer;
-        timer.start();
-        q_ptr->blockSignals(true);
-        Clock::globalSerialRef();
-        int count = 0;
-        if (audioInfo->isIndexVaild()) {
-            count++;
+        for (auto *render : videoRenders) {
+            render->setFrame(framePtr);
         }
-        if (videoInfo->isIndexVaild()) {
-            count++;
+        stepPosition = framePtr->pts();
+        q_ptr->onPositionChanged(stepPosition);
+    }
+
+    void resumeAtStep()
+    {
+        if (stepPosition < 0) {
+            return;
         }
-        if (subtitleInfo->isIndexVaild()) {
-            count++;
+        setPendingSeek(EventPtr(new SeekEvent(stepPosition, SeekMode::Exact)));
+        stepPosition = -1;
+        processPendingSeek(true);
+    }
+
+    void processStepFrameEvent(const EventPtr &eventPtr)
+    {
+        if (!openGopCache()) {
+            return;
+        }
+        if (mediaState.load() != MediaState::Pausing) {
+            // Parks the demuxer once the step is shown
+            setPaused(EventPtr(new PauseEvent(true)));
+            eventQueue.append(EventPtr(new PauseEvent(true)));
+        }
+        auto *stepFrameEvent = static_cast<StepFrameEvent *>(eventPtr.data());
+        auto base = stepPosition >= 0 ? stepPosition : position.load();
+        auto framePtr = stepFrameEvent->forward() ? gopCache->nextFrame(base)
+                                                  : gopCache->previousFrame(base);
+        if (!framePtr.isNull()) {
+            showSteppedFrame(framePtr);
+        }
+    }
+
+    void processReverseEvent(const EventPtr &eventPtr)
+    {
+        auto reverse = static_cast<ReverseEvent *>(eventPtr.data())->reverse();
+        if (reverse == reversePlaying.load()) {
+            return;
+        }
+        if (!reverse) {
+            reversePlaying.store(false);
+            resumeAtStep();
+            EventPtr resumePtr(new PauseEvent(false));
+            audioDecoder->addEvent(resumePtr);
+            videoDecoder->addEvent(resumePtr);
+            subtitleDecoder->addEvent(resumePtr);
+            clockDomain.master()->invalidate();
+            return;
+        }
+        if (!openGopCache()) {
+            return;
+        }
+        // The demuxer stops reading, the audio is muted with the paused decoders
+        EventPtr pausePtr(new PauseEvent(true));
+        audioDecoder->addEvent(pausePtr);
+        videoDecoder->addEvent(pausePtr);
+        subtitleDecoder->addEvent(pausePtr);
+        if (stepPosition < 0) {
+            stepPosition = position.load();
         }
+        reverseTimer.invalidate();
+        reversePlaying.store(true);
+        setMediaState(MediaState::Playing);
+    }
+
+    // Paced by the distance to the previous frame at the current speed
+    void playReverseFrame()
+    {
+        auto framePtr = gopCache->previousFrame(stepPosition);
+        if (framePtr.isNull()) {
+            // The first frame, parks like a pause
+            eventQueue.append(EventPtr(new PauseEvent(true)));
+            return;
+        }
+        if (reverseTimer.isValid()) {
+            auto interval = (stepPosition - framePtr->pts()) / clockDomain.speed() / 1000;
+            auto remaining = static_cast<qint64>(interval) - reverseTimer.elapsed();
+            if (remaining > 0) {
+                QMutexLocker locker(&mutex);
+                waitCondition.wait(&mutex, remaining);
+            }
+        }
+        reverseTimer.restart();
+        showSteppedFrame(framePtr);
+    }
+
+    void processSeekEvent(const EventPtr &eventPtr)
+    {
+        QElapsedTimer timer;
+        timer.start();
         auto *seekEvent = dynamic_cast<SeekEvent *>(eventPtr.data());
-        seekEvent->setWaitCountdown(count);
+        auto position = seekEvent->position();
+        // Everything demuxed from now on carries the new serial, the decoders drop
+        // the older packets and flush themselves on the first packet of the new one.
+        clockDomain.serialRef();
+        audioDecoder->clear();
+        videoDecoder->clear();
+        subtitleDecoder->clear();
         audioDecoder->addEvent(eventPtr);
         videoDecoder->addEvent(eventPtr);
         subtitleDecoder->addEvent(eventPtr);
-        auto position = seekEvent->position();
-        seekEvent->wait();
+        resetReplay();
+        trickPlayNext = 0;
+        trickPlayLast = 0;
+        // Reverse playback goes on from the new position
+        stepPosition = reversePlaying.load() ? position : -1;
 
-        formatCtx->seek(position, position < this->position);
-        if (audioInfo->isIndexVaild()) {
-            audioInfo->codecCtx()->flush();
-        }
-        if (videoInfo->isIndexVaild()) {
-            videoInfo->codecCtx()->flush();
-        }
-        if (subtitleInfo->isIndexVaild()) {
-            subtitleInfo->codecCtx()->flush();
-        }
-        q_ptr->blockSignals(false);
+        formatCtx->seek(position, position > this->position);
         this->position = position;
-        Clock::master()->invalidate();
+        clockDomain.master()->invalidate();
         qInfo() << "Seek To: "
                 << QTime::fromMSecsSinceStartOfDay(position / 1000).toString("hh:mm:ss.zzz")
-                << "Seeked elapsed: " << timer.elapsed() << "ms";
+                << "Seeked elapsed: " << timer.elapsed() << "ms"
+                << "Coalesced seeks: " << coalescedSeeks.load();
 
         addPropertyChangeEvent(new SeekChangedEvent(position));
     }
@@ -388,13 +1101,16 @@ public:
     {
         auto *seekRelativeEvent = dynamic_cast<SeekRelativeEvent *>(eventPtr.data());
         auto relativePosition = seekRelativeEvent->relativePosition();
-        auto position = this->position + relativePosition * AV_TIME_BASE;
+        auto basePosition = pendingSeekPtr.isNull()
+                                ? this->position.load()
+                                : static_cast<SeekEvent *>(pendingSeekPtr.data())->position();
+        auto position = basePosition + relativePosition * AV_TIME_BASE;
         if (position < 0) {
             position = 0;
         } else if (position > q_ptr->duration()) {
             position = q_ptr->duration();
         }
-        eventQueue.insertHead(EventPtr(new SeekEvent(position)));
+        setPendingSeek(EventPtr(new SeekEvent(position, seekRelativeEvent->mode())));
     }
 
     void processGpuEvent(const EventPtr &eventPtr)
@@ -454,9 +1170,188 @@ public:
         eventQueue.insertHead(EventPtr(new SeekEvent(position)));
     }
 
+    void processSwitchTrackEvent(const EventPtr &eventPtr)
+    {
+        auto *selectedMediaTrackEvent = dynamic_cast<SelectedMediaTrackEvent *>(eventPtr.data());
+        auto index = selectedMediaTrackEvent->index();
+        switch (selectedMediaTrackEvent->type()) {
+        case Event::EventType::AudioTarck:
+            meidaIndex.audioindex = index;
+            switchStream(AVMEDIA_TYPE_AUDIO, index);
+            break;
+        case Event::EventType::VideoTrack:
+            meidaIndex.videoindex = index;
+            switchStream(AVMEDIA_TYPE_VIDEO, index);
+            break;
+        case Event::EventType::SubtitleTrack:
+            meidaIndex.subtitleindex = index;
+            switchStream(AVMEDIA_TYPE_SUBTITLE, index);
+            break;
+        default: break;
+        }
+    }
+
+    void processSwitchGpuEvent(const EventPtr &eventPtr)
+    {
+        auto *gpuEvent = dynamic_cast<GpuEvent *>(eventPtr.data());
+        if (gpuDecode == gpuEvent->use()) {
+            return;
+        }
+        gpuDecode = gpuEvent->use();
+        if (videoInfo->isIndexVaild()) {
+            switchStream(AVMEDIA_TYPE_VIDEO, videoInfo->index(), true);
+        }
+    }
+
+    auto contextInfo(AVMediaType mediaType) -> AVContextInfo *&
+    {
+        switch (mediaType) {
+        case AVMEDIA_TYPE_AUDIO: return audioInfo;
+        case AVMEDIA_TYPE_VIDEO: return videoInfo;
+        default: break;
+        }
+        return subtitleInfo;
+    }
+
+    // Swaps the stream of one media type while the others keep playing. The new codec is
+    // opened before the old decoder stops, so a failure leaves playback untouched.
+    auto switchStream(AVMediaType mediaType, int index, bool reopen = false) -> bool
+    {
+        QElapsedTimer timer;
+        timer.start();
+        auto *&info = contextInfo(mediaType);
+        if (!reopen && index == info->index()) {
+            return true;
+        }
+        if (index < 0 || index >= formatCtx->streams()
+            || formatCtx->stream(index)->codecpar->codec_type != mediaType) {
+            qWarning() << "Invalid stream index:" << index;
+            return false;
+        }
+        QScopedPointer<AVContextInfo> newInfo(new AVContextInfo);
+        if (!setMediaIndex(newInfo.data(), index)) {
+            qWarning() << "Switch stream failed:" << index;
+            return false;
+        }
+
+        auto position = playingPosition();
+        switch (mediaType) {
+        case AVMEDIA_TYPE_AUDIO: audioDecoder->stopDecoder(); break;
+        case AVMEDIA_TYPE_VIDEO: videoDecoder->stopDecoder(); break;
+        default: subtitleDecoder->stopDecoder(); break;
+        }
+        replaceObject(info, newInfo);
+        releaseRetiredObjects();
+
+        formatCtx->discardStreamExcluded(
+            {audioInfo->index(), videoInfo->index(), subtitleInfo->index()});
+        switch (mediaType) {
+        case AVMEDIA_TYPE_AUDIO: audioDecoder->startDecoder(formatCtx, audioInfo); break;
+        case AVMEDIA_TYPE_VIDEO:
+            initKeyframeIndex();
+            subtitleDecoder->setVideoResolutionRatio(resolutionRatio());
+            videoDecoder->startDecoder(formatCtx, videoInfo);
+            break;
+        default:
+            subtitleDecoder->setVideoResolutionRatio(resolutionRatio());
+            subtitleDecoder->startDecoder(formatCtx, subtitleInfo);
+            break;
+        }
+        clockDomain.master()->invalidate();
+        replayFrom(position, index);
+        addPropertyChangeEvent(new MediaTrackEvent(mediaTracks()));
+
+        qInfo() << "Switch" << av_get_media_type_string(mediaType) << "stream to" << index
+                << "elapsed:" << timer.elapsed() << "ms";
+        return true;
+    }
+
+    [[nodiscard]] auto playingPosition() const -> qint64
+    {
+        auto *masterClock = clockDomain.master();
+        return masterClock != nullptr && masterClock->isVaild() ? masterClock->pts() : position.load();
+    }
+
+    auto mediaTracks() -> QVector<StreamInfo>
+    {
+        auto tracks = formatCtx->audioTracks();
+        tracks.append(formatCtx->videoTracks());
+        tracks.append(formatCtx->subtitleTracks());
+        for (auto &track : tracks) {
+            track.selected = track.index == audioInfo->index()
+                             || track.index == videoInfo->index()
+                             || track.index == subtitleInfo->index();
+        }
+        return tracks;
+    }
+
+    // The demuxer goes back to position, the streams which keep playing skip the packets
+    // they already got and the switched stream starts at position.
+    void replayFrom(qint64 position, int streamIndex)
+    {
+        replayTs = demuxedTs;
+        replayTs.remove(streamIndex);
+        switchedIndex = streamIndex;
+        switchedPosition = position;
+        formatCtx->seek(position, true);
+    }
+
+    void resetReplay()
+    {
+        demuxedTs.clear();
+        replayTs.clear();
+        switchedIndex = -1;
+    }
+
+    void setDemuxedTs(const PacketPtr &packetPtr)
+    {
+        auto *avPacket = packetPtr->avPacket();
+        auto ts = avPacket->dts != AV_NOPTS_VALUE ? avPacket->dts : avPacket->pts;
+        if (ts != AV_NOPTS_VALUE) {
+            demuxedTs.insert(avPacket->stream_index, ts);
+        }
+    }
+
+    auto isReplayed(const PacketPtr &packetPtr) -> bool
+    {
+        if (replayTs.isEmpty() && switchedIndex < 0) {
+            return false;
+        }
+        auto *avPacket = packetPtr->avPacket();
+        auto streamIndex = avPacket->stream_index;
+        auto ts = avPacket->dts != AV_NOPTS_VALUE ? avPacket->dts : avPacket->pts;
+        if (streamIndex == switchedIndex) {
+            auto *stream = formatCtx->stream(streamIndex);
+            // A video decoder has to start at the keyframe, late frames are dropped by the clock
+            if (stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO && ts != AV_NOPTS_VALUE
+                && av_rescale_q(ts + std::max<int64_t>(avPacket->duration, 0),
+                                stream->time_base,
+                                AV_TIME_BASE_Q)
+                       < switchedPosition) {
+                return true;
+            }
+            switchedIndex = -1;
+            return false;
+        }
+        auto it = replayTs.find(streamIndex);
+        if (it == replayTs.end()) {
+            return false;
+        }
+        if (ts != AV_NOPTS_VALUE && ts <= it.value()) {
+            return true;
+        }
+        replayTs.erase(it);
+        return false;
+    }
+
     void processOpenMediaEvent(const EventPtr &eventPtr)
     {
         auto *openMediaEvent = dynamic_cast<OpenMediaEvent *>(eventPtr.data());
+        if (closePending) {
+            // Opened once the previous media has finished closing
+            pendingFilepath = openMediaEvent->filepath();
+            return;
+        }
         filepath = openMediaEvent->filepath();
         q_ptr->onPlay();
     }
@@ -464,24 +1359,51 @@ public:
     void processCloseMediaEvent()
     {
         q_ptr->buildConnect(false);
+        pendingFilepath.clear();
+        q_ptr->setNextMedia({});
+        // Also aborts blocking input operations through the interrupt callback
         runing.store(false);
+        audioDecoder->wakeFinished();
+        videoDecoder->wakeFinished();
         wakePause();
         if (q_ptr->isRunning()) {
             q_ptr->quit();
         }
-        while (q_ptr->isRunning()) {
-            qApp->processEvents();
+        if (!q_ptr->wait(QDeadlineTimer(closeTimeout.load()))) {
+            qWarning() << "Close timeout, finish it in the background";
+            closePending = true;
+            return;
         }
+        finishClose();
+    }
+
+    void finishClose()
+    {
         for (auto *render : videoRenders) {
             render->resetAllFrame();
         }
+        gopCache->close();
         formatCtx->close();
     }
 
-    static void processSpeedEvent(const EventPtr &eventPtr)
+    void finishPendingClose()
+    {
+        if (!closePending) {
+            return;
+        }
+        closePending = false;
+        finishClose();
+        if (!pendingFilepath.isEmpty()) {
+            filepath = pendingFilepath;
+            pendingFilepath.clear();
+            q_ptr->onPlay();
+        }
+    }
+
+    void processSpeedEvent(const EventPtr &eventPtr)
     {
         auto *speedEvent = dynamic_cast<SpeedEvent *>(eventPtr.data());
-        Clock::setSpeed(speedEvent->speed());
+        clockDomain.setSpeed(speedEvent->speed());
     }
 
     void processVolumeEvent(const EventPtr &eventPtr) const
@@ -497,6 +1419,9 @@ public:
     AVContextInfo *videoInfo;
     AVContextInfo *subtitleInfo;
 
+    // Shared by the clocks of this player only
+    ClockDomain clockDomain;
+    PacketPool packetPool;
     AudioDecoder *audioDecoder;
     VideoDecoder *videoDecoder;
     SubtitleDecoder *subtitleDecoder;
@@ -504,25 +1429,69 @@ public:
     MediaIndex meidaIndex;
 
     QString filepath;
+    // Guards the media objects against the getters while they are replaced
+    mutable QMutex contextMutex;
+    QMutex nextMutex;
+    QString nextFilepath;
+    static constexpr auto s_prefetchPacketCount = 64;
+    static constexpr auto s_drainSliceMs = 50;
+    static constexpr qint64 s_prefetchLead = 5 * AV_TIME_BASE; // demux time left, microsecond
+    // Only touched on the demux thread
+    QSharedPointer<NextMedia> nextMediaPtr;
+    bool mediaChanging = false;
+    QList<QObject *> retiredObjects;
+    // Only touched on the thread the player lives in
+    QString pendingFilepath;
+    bool closePending = false;
+    std::atomic<qint64> closeTimeout = 3000; // millisecond
     std::atomic_bool isOpen = true;
     std::atomic_bool runing = true;
-    bool gpuDecode = true;
-    qint64 position = 0;
+    std::atomic_bool gpuDecode = true;
+    // Written by the display threads
+    std::atomic<qint64> position = 0;
     std::atomic<MediaState> mediaState = MediaState::Stopped;
 
     std::atomic_bool paused = false;
     QMutex mutex;
     QWaitCondition waitCondition;
 
-    Utils::ThreadSafeQueue<PropertyChangeEventPtr> propertyChangeEventQueue;
-    std::atomic<size_t> maxPropertyEventQueueSize = 100;
+    PropertyChannel *propertyChannel;
+    GopCache *gopCache;
+    // Frame stepping and reverse playback, only touched on the player thread
+    qint64 stepPosition = -1; // microsecond, the frame shown, -1 if none
+    std::atomic_bool reversePlaying = false;
+    QElapsedTimer reverseTimer;
+    // Presented video frames, only touched on the video display thread
+    QElapsedTimer fpsTimer;
+    qint64 frameCount = 0;
     Utils::ThreadSafeQueue<EventPtr> eventQueue;
     std::atomic<size_t> maxEventQueueSize = 100;
 
+    // Stream switching, dts in stream time base by stream index
+    QHash<int, qint64> demuxedTs;
+    QHash<int, qint64> replayTs;
+    int switchedIndex = -1;
+    qint64 switchedPosition = 0; // microsecond
+
+    EventPtr pendingSeekPtr;
+    QElapsedTimer seekTimer;
+    std::atomic<qint64> minSeekInterval = 50; // millisecond
+    std::atomic<quint64> coalescedSeeks = 0;
+
     QScopedPointer<Utils::Speed> speedPtr;
     QElapsedTimer speedTimer;
 
+    // Trick play, timestamps are microsecond
+    static constexpr qint64 s_trickPlayInterval = 100 * 1000; // wall time per keyframe
+    std::atomic<double> trickPlaySpeed = 4.0;
+    std::atomic_bool trickPlaying = false;
+    qint64 trickPlayNext = 0;
+    qint64 trickPlayLast = 0;
+
     QVector<VideoRender *> videoRenders = {};
+
+    // Destroyed first, waits for a running prefetch
+    Utils::TaskGroup prefetchTasks;
 };
 
 Player::Player(QObject *parent)
@@ -537,6 +1506,9 @@ Player::Player(QObject *parent)
 Player::~Player()
 {
     addEvent(EventPtr(new CloseMediaEvent));
+    // The thread must not outlive the player, the interrupt callback keeps this short
+    wait();
+    d_ptr->finishPendingClose();
 }
 
 auto Player::filePath() const -> QString &
@@ -553,12 +1525,8 @@ void Player::onPlay()
 
 void Player::onPositionChanged(qint64 position)
 {
-    auto diff = (position - d_ptr->position) / AV_TIME_BASE;
-    if (qAbs(diff) < 1) {
-        return;
-    }
-    d_ptr->position = position;
-    d_ptr->addPropertyChangeEvent(new PositionEvent(position));
+    d_ptr->position.store(position);
+    d_ptr->propertyChannel->setPosition(position);
 }
 
 auto Player::isOpen() -> bool
@@ -566,9 +1534,9 @@ auto Player::isOpen() -> bool
     return d_ptr->isOpen;
 }
 
-auto Player::speed() -> double
+auto Player::speed() const -> double
 {
-    return Clock::speed();
+    return d_ptr->clockDomain.speed();
 }
 
 auto Player::isGpuDecode() -> bool
@@ -583,6 +1551,7 @@ auto Player::mediaState() -> MediaState
 
 auto Player::duration() const -> qint64
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->formatCtx->duration();
 }
 
@@ -593,36 +1562,43 @@ auto Player::position() const -> qint64
 
 auto Player::fames() const -> qint64
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->videoInfo->isIndexVaild() ? d_ptr->videoInfo->fames() : 0;
 }
 
 auto Player::resolutionRatio() const -> QSize
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->resolutionRatio();
 }
 
 auto Player::fps() const -> double
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->videoInfo->isIndexVaild() ? d_ptr->videoInfo->fps() : 0;
 }
 
 auto Player::mediaInfo() -> MediaInfo
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->formatCtx->mediaInfo();
 }
 
 auto Player::audioIndex() const -> int
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->audioInfo->index();
 }
 
 auto Player::videoIndex() const -> int
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->videoInfo->index();
 }
 
 auto Player::subtitleIndex() const -> int
 {
+    QMutexLocker locker(&d_ptr->contextMutex);
     return d_ptr->subtitleInfo->index();
 }
 
@@ -640,22 +1616,17 @@ auto Player::videoRenders() -> QVector<VideoRender *>
 
 void Player::setPropertyEventQueueMaxSize(size_t size)
 {
-    d_ptr->maxPropertyEventQueueSize.store(size);
+    d_ptr->propertyChannel->setMaxEventSize(size);
 }
 
 auto Player::propertEventyQueueMaxSize() const -> size_t
 {
-    return d_ptr->maxPropertyEventQueueSize.load();
-}
-
-auto Player::propertyChangeEventSize() const -> size_t
-{
-    return d_ptr->propertyChangeEventQueue.size();
+    return d_ptr->propertyChannel->maxEventSize();
 }
 
-auto Player::takePropertyChangeEvent() -> PropertyChangeEventPtr
+auto Player::propertyChannel() const -> PropertyChannel *
 {
-    return d_ptr->propertyChangeEventQueue.take();
+    return d_ptr->propertyChannel;
 }
 
 void Player::setEventQueueMaxSize(size_t size)
@@ -673,8 +1644,186 @@ auto Player::eventQueueMaxSize() const -> size_t
     return d_ptr->eventQueue.size();
 }
 
+void Player::setMinSeekInterval(qint64 msec)
+{
+    d_ptr->minSeekInterval.store(msec);
+}
+
+auto Player::minSeekInterval() const -> qint64
+{
+    return d_ptr->minSeekInterval.load();
+}
+
+auto Player::coalescedSeeks() const -> quint64
+{
+    return d_ptr->coalescedSeeks.load();
+}
+
+void Player::setQueuePolicy(AVMediaType mediaType, const QueuePolicy &policy)
+{
+    switch (mediaType) {
+    case AVMEDIA_TYPE_AUDIO: d_ptr->audioDecoder->setQueuePolicy(policy); break;
+    case AVMEDIA_TYPE_VIDEO: d_ptr->videoDecoder->setQueuePolicy(policy); break;
+    case AVMEDIA_TYPE_SUBTITLE: d_ptr->subtitleDecoder->setQueuePolicy(policy); break;
+    default: break;
+    }
+}
+
+auto Player::queuePolicy(AVMediaType mediaType) const -> QueuePolicy
+{
+    switch (mediaType) {
+    case AVMEDIA_TYPE_AUDIO: return d_ptr->audioDecoder->queueStats().policy;
+    case AVMEDIA_TYPE_VIDEO: return d_ptr->videoDecoder->queueStats().policy;
+    case AVMEDIA_TYPE_SUBTITLE: return d_ptr->subtitleDecoder->queueStats().policy;
+    default: break;
+    }
+    return {};
+}
+
+auto Player::queueStats() const -> PlayerQueueStats
+{
+    PlayerQueueStats stats;
+    stats.audio = d_ptr->audioDecoder->queueStats();
+    stats.video = d_ptr->videoDecoder->queueStats();
+    stats.subtitle = d_ptr->subtitleDecoder->queueStats();
+    stats.liveBytes = d_ptr->packetPool.liveBytes();
+    return stats;
+}
+
+void Player::setFrameSkipEnabled(bool enabled)
+{
+    d_ptr->videoDecoder->setFrameSkipEnabled(enabled);
+}
+
+auto Player::isFrameSkipEnabled() const -> bool
+{
+    return d_ptr->videoDecoder->isFrameSkipEnabled();
+}
+
+auto Player::frameSkipStats() const -> FrameSkipStats
+{
+    return d_ptr->videoDecoder->frameSkipStats();
+}
+
+auto Player::avSyncOffset() const -> qint64
+{
+    return d_ptr->videoDecoder->avOffset();
+}
+
+void Player::setAudioLatencyCompensation(qint64 latency)
+{
+    d_ptr->audioDecoder->setLatencyCompensation(latency);
+}
+
+auto Player::audioLatencyCompensation() const -> qint64
+{
+    return d_ptr->audioDecoder->latencyCompensation();
+}
+
+void Player::setAudioOutputProfile(const AudioOutputProfile &profile)
+{
+    d_ptr->audioDecoder->setOutputProfile(profile);
+}
+
+auto Player::audioOutputProfile() const -> AudioOutputProfile
+{
+    return d_ptr->audioDecoder->outputProfile();
+}
+
+auto Player::audioOutputStats() const -> AudioOutputStats
+{
+    return d_ptr->audioDecoder->outputStats();
+}
+
+void Player::setAudioSoftSyncEnabled(bool enabled)
+{
+    d_ptr->audioDecoder->setSoftSyncEnabled(enabled);
+}
+
+auto Player::isAudioSoftSyncEnabled() const -> bool
+{
+    return d_ptr->audioDecoder->isSoftSyncEnabled();
+}
+
+auto Player::audioSyncStats() const -> AudioSyncStats
+{
+    return d_ptr->audioDecoder->syncStats();
+}
+
+void Player::setTrickPlaySpeed(double speed)
+{
+    d_ptr->trickPlaySpeed.store(speed);
+}
+
+auto Player::trickPlaySpeed() const -> double
+{
+    return d_ptr->trickPlaySpeed.load();
+}
+
+auto Player::isTrickPlaying() const -> bool
+{
+    return d_ptr->trickPlaying.load();
+}
+
+auto Player::isReversePlaying() const -> bool
+{
+    return d_ptr->reversePlaying.load();
+}
+
+auto Player::gopCache() const -> GopCache *
+{
+    return d_ptr->gopCache;
+}
+
+void Player::setIoTimeouts(const FormatContext::Timeouts &timeouts)
+{
+    QMutexLocker locker(&d_ptr->contextMutex);
+    d_ptr->formatCtx->setTimeouts(timeouts);
+}
+
+auto Player::ioTimeouts() const -> FormatContext::Timeouts
+{
+    QMutexLocker locker(&d_ptr->contextMutex);
+    return d_ptr->formatCtx->timeouts();
+}
+
+void Player::setCloseTimeout(qint64 msec)
+{
+    d_ptr->closeTimeout.store(msec);
+}
+
+auto Player::closeTimeout() const -> qint64
+{
+    return d_ptr->closeTimeout.load();
+}
+
+void Player::setNextMedia(const QString &filepath)
+{
+    QMutexLocker locker(&d_ptr->nextMutex);
+    d_ptr->nextFilepath = filepath;
+}
+
+auto Player::nextMedia() const -> QString
+{
+    QMutexLocker locker(&d_ptr->nextMutex);
+    return d_ptr->nextFilepath;
+}
+
 auto Player::addEvent(const EventPtr &eventPtr) -> bool
 {
+    switch (eventPtr->type()) {
+    case Event::EventType::AudioTarck:
+    case Event::EventType::VideoTrack:
+    case Event::EventType::SubtitleTrack:
+    case Event::EventType::Gpu:
+        // Switched on the demux thread without reopening the media
+        if (isRunning() && d_ptr->isOpen.load()) {
+            d_ptr->addEvent(eventPtr);
+            return true;
+        }
+        break;
+    default: break;
+    }
     if (eventPtr->type() < Event::EventType::Pause) {
         QMetaObject::invokeMethod(
             this,
@@ -708,12 +1857,12 @@ void Player::buildConnect(bool state)
                 &AudioDecoder::positionChanged,
                 this,
                 &Player::onPositionChanged,
-                Qt::UniqueConnection);
+                static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection));
         connect(d_ptr->videoDecoder,
                 &VideoDecoder::positionChanged,
                 this,
                 &Player::onPositionChanged,
-                Qt::UniqueConnection);
+                static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection));
     } else {
         disconnect(d_ptr->audioDecoder,
                    &AudioDecoder::positionChanged,
@@ -1,7 +1,12 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
+#include "audiooutputprofile.hpp"
+#include "audiosync.hpp"
+#include "formatcontext.h"
+#include "frameskip.hpp"
 #include "mediainfo.hpp"
+#include "queuepolicy.hpp"
 
 #include <ffmpeg/event/event.hpp>
 
@@ -9,6 +14,8 @@
 
 namespace Ffmpeg {
 
+class GopCache;
+class PropertyChannel;
 class VideoRender;
 
 class FFMPEG_EXPORT Player : public QThread
@@ -20,7 +27,7 @@ public:
 
     [[nodiscard]] auto filePath() const -> QString &;
     auto isOpen() -> bool;
-    static auto speed() -> double;
+    [[nodiscard]] auto speed() const -> double;
     auto isGpuDecode() -> bool;
     auto mediaState() -> MediaState;
 
@@ -40,23 +47,72 @@ public:
 
     void setPropertyEventQueueMaxSize(size_t size);
     [[nodiscard]] auto propertEventyQueueMaxSize() const -> size_t;
-    [[nodiscard]] auto propertyChangeEventSize() const -> size_t;
-    auto takePropertyChangeEvent() -> PropertyChangeEventPtr;
+    // Position, state and the other property changes, read on the thread of the player
+    [[nodiscard]] auto propertyChannel() const -> PropertyChannel *;
 
     void setEventQueueMaxSize(size_t size);
     [[nodiscard]] auto eventQueueMaxSize() const -> size_t;
     [[nodiscard]] auto eventSize() const -> size_t;
     auto addEvent(const EventPtr &eventPtr) -> bool;
 
+    // Seeks queued faster than the interval collapse to the latest one
+    void setMinSeekInterval(qint64 msec);
+    [[nodiscard]] auto minSeekInterval() const -> qint64;
+    [[nodiscard]] auto coalescedSeeks() const -> quint64;
+
+    // Budgets of the packet queues between the demuxer and the decoders
+    void setQueuePolicy(AVMediaType mediaType, const QueuePolicy &policy);
+    [[nodiscard]] auto queuePolicy(AVMediaType mediaType) const -> QueuePolicy;
+    [[nodiscard]] auto queueStats() const -> PlayerQueueStats;
+
+    // Video frames skipped before decoding when the display falls behind
+    void setFrameSkipEnabled(bool enabled);
+    [[nodiscard]] auto isFrameSkipEnabled() const -> bool;
+    [[nodiscard]] auto frameSkipStats() const -> FrameSkipStats;
+
+    // How far the shown video is ahead of the audio heard, averaged, microsecond
+    [[nodiscard]] auto avSyncOffset() const -> qint64;
+    // Output latency of the audio device the sink does not report, microsecond
+    void setAudioLatencyCompensation(qint64 latency);
+    [[nodiscard]] auto audioLatencyCompensation() const -> qint64;
+    // Buffering of the audio sink, low latency trades underruns for 20-40 ms to the device
+    void setAudioOutputProfile(const AudioOutputProfile &profile);
+    [[nodiscard]] auto audioOutputProfile() const -> AudioOutputProfile;
+    [[nodiscard]] auto audioOutputStats() const -> AudioOutputStats;
+    // Audio slaved to another clock resamples small drifts away instead of resetting
+    void setAudioSoftSyncEnabled(bool enabled);
+    [[nodiscard]] auto isAudioSoftSyncEnabled() const -> bool;
+    [[nodiscard]] auto audioSyncStats() const -> AudioSyncStats;
+
+    // From this speed on only spaced keyframes are demuxed and decoded and the audio is
+    // muted, <= 0 turns trick play off
+    void setTrickPlaySpeed(double speed);
+    [[nodiscard]] auto trickPlaySpeed() const -> double;
+    [[nodiscard]] auto isTrickPlaying() const -> bool;
+
+    // Frame stepping and reverse playback, driven by StepFrameEvent and ReverseEvent
+    [[nodiscard]] auto isReversePlaying() const -> bool;
+    [[nodiscard]] auto gopCache() const -> GopCache *;
+
+    // Deadlines of open, probe and read on the input, closing aborts them at once
+    void setIoTimeouts(const FormatContext::Timeouts &timeouts);
+    [[nodiscard]] auto ioTimeouts() const -> FormatContext::Timeouts;
+    // How long closing waits for the player thread, it finishes in the background after
+    void setCloseTimeout(qint64 msec);
+    [[nodiscard]] auto closeTimeout() const -> qint64;
+
+    // Opened a few seconds before the current media ends and played on without stopping,
+    // empty clears it
+    void setNextMedia(const QString &filepath);
+    [[nodiscard]] auto nextMedia() const -> QString;
+
 public slots:
     void onPlay();
 
 private slots:
+    // Called on the display threads
     void onPositionChanged(qint64 position);
 
-signals:
-    void eventIncrease();
-
 protected:
     void run() override;
 
@@ -151,6 +151,10 @@ void PreviewOneTask::run()
         return;
     }
     videoInfoPtr->openCodec(); // 软解
+    auto keyframeIndex = formatCtxPtr->keyframeIndex();
+    if (!keyframeIndex.isNull() && keyframeIndex->streamIndex() != d_ptr->videoIndex) {
+        formatCtxPtr->setKeyframeIndex(KeyframeIndex::fromFile(d_ptr->filepath, d_ptr->videoIndex));
+    }
     formatCtxPtr->seek(d_ptr->timestamp);
     videoInfoPtr->codecCtx()->flush();
     formatCtxPtr->discardStreamExcluded({d_ptr->videoIndex});
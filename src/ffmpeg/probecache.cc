@@ -0,0 +1,516 @@
+#include "probecache.hpp"
+
+#include <utils/utils.h>
+
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QSaveFile>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace Ffmpeg {
+
+static constexpr quint32 s_magic = 0x51465043; // QFPC
+static constexpr quint32 s_version = 1;
+static constexpr qint64 s_maxCacheBytes = 16 * 1024 * 1024;
+static constexpr qint64 s_maxCacheAge = 30LL * 24 * 3600; // second
+
+struct CodecParameters
+{
+    qint32 codecType = AVMEDIA_TYPE_UNKNOWN;
+    qint32 codecId = AV_CODEC_ID_NONE;
+    quint32 codecTag = 0;
+    QByteArray extradata;
+    qint32 format = -1;
+    qint64 bitRate = 0;
+    qint32 profile = -99;
+    qint32 level = -99;
+    // Video
+    qint32 width = 0;
+    qint32 height = 0;
+    qint32 sampleAspectRatioNum = 0;
+    qint32 sampleAspectRatioDen = 1;
+    qint32 fieldOrder = AV_FIELD_UNKNOWN;
+    qint32 colorRange = AVCOL_RANGE_UNSPECIFIED;
+    qint32 colorPrimaries = AVCOL_PRI_UNSPECIFIED;
+    qint32 colorTrc = AVCOL_TRC_UNSPECIFIED;
+    qint32 colorSpace = AVCOL_SPC_UNSPECIFIED;
+    qint32 chromaLocation = AVCHROMA_LOC_UNSPECIFIED;
+    qint32 videoDelay = 0;
+    // Audio
+    qint32 chLayoutOrder = AV_CHANNEL_ORDER_UNSPEC;
+    qint32 channels = 0;
+    quint64 channelMask = 0;
+    qint32 sampleRate = 0;
+    qint32 blockAlign = 0;
+    qint32 frameSize = 0;
+    qint32 initialPadding = 0;
+    // Stream
+    qint32 timeBaseNum = 0;
+    qint32 timeBaseDen = 1;
+    qint32 avgFrameRateNum = 0;
+    qint32 avgFrameRateDen = 1;
+    qint32 realFrameRateNum = 0;
+    qint32 realFrameRateDen = 1;
+    qint64 startTime = AV_NOPTS_VALUE;
+    qint64 duration = AV_NOPTS_VALUE;
+};
+
+static auto operator<<(QDataStream &out, const CodecParameters &p) -> QDataStream &
+{
+    out << p.codecType << p.codecId << p.codecTag << p.extradata << p.format << p.bitRate
+        << p.profile << p.level << p.width << p.height << p.sampleAspectRatioNum
+        << p.sampleAspectRatioDen << p.fieldOrder << p.colorRange << p.colorPrimaries
+        << p.colorTrc << p.colorSpace << p.chromaLocation << p.videoDelay << p.chLayoutOrder
+        << p.channels << p.channelMask << p.sampleRate << p.blockAlign << p.frameSize
+        << p.initialPadding << p.timeBaseNum << p.timeBaseDen << p.avgFrameRateNum
+        << p.avgFrameRateDen << p.realFrameRateNum << p.realFrameRateDen << p.startTime
+        << p.duration;
+    return out;
+}
+
+static auto operator>>(QDataStream &in, CodecParameters &p) -> QDataStream &
+{
+    in >> p.codecType >> p.codecId >> p.codecTag >> p.extradata >> p.format >> p.bitRate
+        >> p.profile >> p.level >> p.width >> p.height >> p.sampleAspectRatioNum
+        >> p.sampleAspectRatioDen >> p.fieldOrder >> p.colorRange >> p.colorPrimaries
+        >> p.colorTrc >> p.colorSpace >> p.chromaLocation >> p.videoDelay >> p.chLayoutOrder
+        >> p.channels >> p.channelMask >> p.sampleRate >> p.blockAlign >> p.frameSize
+        >> p.initialPadding >> p.timeBaseNum >> p.timeBaseDen >> p.avgFrameRateNum
+        >> p.avgFrameRateDen >> p.realFrameRateNum >> p.realFrameRateDen >> p.startTime
+        >> p.duration;
+    return in;
+}
+
+static auto codecParametersFromStream(AVStream *stream) -> CodecParameters
+{
+    const auto *codecpar = stream->codecpar;
+    CodecParameters p;
+    p.codecType = codecpar->codec_type;
+    p.codecId = codecpar->codec_id;
+    p.codecTag = codecpar->codec_tag;
+    if (codecpar->extradata != nullptr && codecpar->extradata_size > 0) {
+        p.extradata = QByteArray(reinterpret_cast<const char *>(codecpar->extradata),
+                                 codecpar->extradata_size);
+    }
+    p.format = codecpar->format;
+    p.bitRate = codecpar->bit_rate;
+    p.profile = codecpar->profile;
+    p.level = codecpar->level;
+    p.width = codecpar->width;
+    p.height = codecpar->height;
+    p.sampleAspectRatioNum = codecpar->sample_aspect_ratio.num;
+    p.sampleAspectRatioDen = codecpar->sample_aspect_ratio.den;
+    p.fieldOrder = codecpar->field_order;
+    p.colorRange = codecpar->color_range;
+    p.colorPrimaries = codecpar->color_primaries;
+    p.colorTrc = codecpar->color_trc;
+    p.colorSpace = codecpar->color_space;
+    p.chromaLocation = codecpar->chroma_location;
+    p.videoDelay = codecpar->video_delay;
+    p.chLayoutOrder = codecpar->ch_layout.order;
+    p.channels = codecpar->ch_layout.nb_channels;
+    if (codecpar->ch_layout.order == AV_CHANNEL_ORDER_NATIVE
+        || codecpar->ch_layout.order == AV_CHANNEL_ORDER_AMBISONIC) {
+        p.channelMask = codecpar->ch_layout.u.mask;
+    } else if (codecpar->ch_layout.order == AV_CHANNEL_ORDER_CUSTOM) {
+        p.chLayoutOrder = AV_CHANNEL_ORDER_UNSPEC;
+    }
+    p.sampleRate = codecpar->sample_rate;
+    p.blockAlign = codecpar->block_align;
+    p.frameSize = codecpar->frame_size;
+    p.initialPadding = codecpar->initial_padding;
+    p.timeBaseNum = stream->time_base.num;
+    p.timeBaseDen = stream->time_base.den;
+    p.avgFrameRateNum = stream->avg_frame_rate.num;
+    p.avgFrameRateDen = stream->avg_frame_rate.den;
+    p.realFrameRateNum = stream->r_frame_rate.num;
+    p.realFrameRateDen = stream->r_frame_rate.den;
+    p.startTime = stream->start_time;
+    p.duration = stream->duration;
+    return p;
+}
+
+static void applyCodecParameters(const CodecParameters &p, AVStream *stream)
+{
+    auto *codecpar = stream->codecpar;
+    if (codecpar->codec_id == AV_CODEC_ID_NONE) {
+        codecpar->codec_id = static_cast<AVCodecID>(p.codecId);
+        codecpar->codec_tag = p.codecTag;
+    }
+    if ((codecpar->extradata == nullptr || codecpar->extradata_size <= 0)
+        && !p.extradata.isEmpty()) {
+        codecpar->extradata = static_cast<uint8_t *>(
+            av_mallocz(p.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+        if (codecpar->extradata != nullptr) {
+            memcpy(codecpar->extradata, p.extradata.constData(), p.extradata.size());
+            codecpar->extradata_size = static_cast<int>(p.extradata.size());
+        }
+    }
+    if (codecpar->format < 0) {
+        codecpar->format = p.format;
+    }
+    if (codecpar->bit_rate <= 0) {
+        codecpar->bit_rate = p.bitRate;
+    }
+    if (codecpar->profile < 0) {
+        codecpar->profile = p.profile;
+    }
+    if (codecpar->level < 0) {
+        codecpar->level = p.level;
+    }
+
+    switch (codecpar->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (codecpar->width <= 0 || codecpar->height <= 0) {
+            codecpar->width = p.width;
+            codecpar->height = p.height;
+        }
+        if (codecpar->sample_aspect_ratio.num == 0) {
+            codecpar->sample_aspect_ratio = AVRational{p.sampleAspectRatioNum,
+                                                       p.sampleAspectRatioDen};
+        }
+        if (codecpar->field_order == AV_FIELD_UNKNOWN) {
+            codecpar->field_order = static_cast<AVFieldOrder>(p.fieldOrder);
+        }
+        if (codecpar->color_range == AVCOL_RANGE_UNSPECIFIED) {
+            codecpar->color_range = static_cast<AVColorRange>(p.colorRange);
+        }
+        if (codecpar->color_primaries == AVCOL_PRI_UNSPECIFIED) {
+            codecpar->color_primaries = static_cast<AVColorPrimaries>(p.colorPrimaries);
+        }
+        if (codecpar->color_trc == AVCOL_TRC_UNSPECIFIED) {
+            codecpar->color_trc = static_cast<AVColorTransferCharacteristic>(p.colorTrc);
+        }
+        if (codecpar->color_space == AVCOL_SPC_UNSPECIFIED) {
+            codecpar->color_space = static_cast<AVColorSpace>(p.colorSpace);
+        }
+        if (codecpar->chroma_location == AVCHROMA_LOC_UNSPECIFIED) {
+            codecpar->chroma_location = static_cast<AVChromaLocation>(p.chromaLocation);
+        }
+        if (codecpar->video_delay <= 0) {
+            codecpar->video_delay = p.videoDelay;
+        }
+        if (stream->avg_frame_rate.num == 0) {
+            stream->avg_frame_rate = AVRational{p.avgFrameRateNum, p.avgFrameRateDen};
+        }
+        if (stream->r_frame_rate.num == 0) {
+            stream->r_frame_rate = AVRational{p.realFrameRateNum, p.realFrameRateDen};
+        }
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        if (codecpar->ch_layout.nb_channels <= 0 && p.channels > 0) {
+            av_channel_layout_uninit(&codecpar->ch_layout);
+            if (p.chLayoutOrder == AV_CHANNEL_ORDER_NATIVE) {
+                av_channel_layout_from_mask(&codecpar->ch_layout, p.channelMask);
+            } else {
+                av_channel_layout_default(&codecpar->ch_layout, p.channels);
+            }
+        }
+        if (codecpar->sample_rate <= 0) {
+            codecpar->sample_rate = p.sampleRate;
+        }
+        if (codecpar->block_align <= 0) {
+            codecpar->block_align = p.blockAlign;
+        }
+        if (codecpar->frame_size <= 0) {
+            codecpar->frame_size = p.frameSize;
+        }
+        if (codecpar->initial_padding <= 0) {
+            codecpar->initial_padding = p.initialPadding;
+        }
+        break;
+    default: break;
+    }
+
+    if (stream->start_time == AV_NOPTS_VALUE) {
+        stream->start_time = p.startTime;
+    }
+    if (stream->duration == AV_NOPTS_VALUE) {
+        stream->duration = p.duration;
+    }
+}
+
+struct ProbeEntry
+{
+    qint64 fileSize = 0;
+    qint64 lastModified = 0;
+    qint64 startTime = AV_NOPTS_VALUE;
+    qint64 duration = AV_NOPTS_VALUE;
+    qint64 bitRate = 0;
+    QByteArray mediaInfoJson;
+    QVector<CodecParameters> codecParameters;
+
+    // Memory only, StreamInfo holds images and display strings
+    bool hasMediaInfo = false;
+    MediaInfo mediaInfo;
+};
+
+class ProbeCache::ProbeCachePrivate
+{
+public:
+    explicit ProbeCachePrivate(ProbeCache *q)
+        : q_ptr(q)
+    {
+        cache.setMaxCost(64);
+    }
+
+    static auto cacheKey(const QFileInfo &fileInfo) -> QString
+    {
+        return fileInfo.absoluteFilePath();
+    }
+
+    static auto cacheDirectory() -> QString
+    {
+        const auto path = Utils::cachePath() + "/probe";
+        Utils::generateDirectorys(path);
+        return path;
+    }
+
+    static auto cacheFilePath(const QFileInfo &fileInfo) -> QString
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(fileInfo.absoluteFilePath().toUtf8());
+        return cacheDirectory() + "/" + hash.result().toHex() + ".probe";
+    }
+
+    // Oldest entries first, above s_maxCacheBytes or older than s_maxCacheAge
+    static void trimCache()
+    {
+        QDir dir(cacheDirectory());
+        auto fileInfos = dir.entryInfoList({"*.probe"}, QDir::Files, QDir::Time | QDir::Reversed);
+        qint64 totalBytes = 0;
+        for (const auto &fileInfo : std::as_const(fileInfos)) {
+            totalBytes += fileInfo.size();
+        }
+        const auto expired = QDateTime::currentDateTime().addSecs(-s_maxCacheAge);
+        for (const auto &fileInfo : std::as_const(fileInfos)) {
+            if (totalBytes <= s_maxCacheBytes && fileInfo.lastModified() >= expired) {
+                break;
+            }
+            if (QFile::remove(fileInfo.absoluteFilePath())) {
+                totalBytes -= fileInfo.size();
+            }
+        }
+    }
+
+    static auto isSameFile(const ProbeEntry &entry, const QFileInfo &fileInfo) -> bool
+    {
+        return entry.fileSize == fileInfo.size()
+               && entry.lastModified == fileInfo.lastModified().toMSecsSinceEpoch();
+    }
+
+    // Called with mutex locked, returns nullptr if neither memory nor disk has a valid entry
+    auto find(const QString &filepath) -> ProbeEntry *
+    {
+        QFileInfo fileInfo(filepath);
+        if (!enabled || !fileInfo.isFile()) {
+            return nullptr;
+        }
+        const auto key = cacheKey(fileInfo);
+        auto *entry = cache.object(key);
+        if (entry != nullptr) {
+            if (isSameFile(*entry, fileInfo)) {
+                return entry;
+            }
+            cache.remove(key);
+        }
+        QScopedPointer<ProbeEntry> entryPtr(new ProbeEntry);
+        if (!read(cacheFilePath(fileInfo), *entryPtr) || !isSameFile(*entryPtr, fileInfo)) {
+            return nullptr;
+        }
+        entry = entryPtr.take();
+        cache.insert(key, entry);
+        return entry;
+    }
+
+    static auto read(const QString &filepath, ProbeEntry &entry) -> bool
+    {
+        QFile file(filepath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_6_0);
+        quint32 magic = 0;
+        quint32 version = 0;
+        in >> magic >> version;
+        if (magic != s_magic || version != s_version) {
+            return false;
+        }
+        in >> entry.fileSize >> entry.lastModified >> entry.startTime >> entry.duration
+            >> entry.bitRate >> entry.mediaInfoJson >> entry.codecParameters;
+        return in.status() == QDataStream::Ok;
+    }
+
+    static auto write(const QString &filepath, const ProbeEntry &entry) -> bool
+    {
+        QSaveFile file(filepath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << file.errorString();
+            return false;
+        }
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << s_magic << s_version << entry.fileSize << entry.lastModified << entry.startTime
+            << entry.duration << entry.bitRate << entry.mediaInfoJson << entry.codecParameters;
+        return file.commit();
+    }
+
+    ProbeCache *q_ptr;
+
+    QMutex mutex;
+    QCache<QString, ProbeEntry> cache;
+    std::atomic_bool enabled = true;
+    std::atomic_bool fastOpen = true;
+};
+
+ProbeCache::ProbeCache(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new ProbeCachePrivate(this))
+{}
+
+ProbeCache::~ProbeCache() = default;
+
+void ProbeCache::setEnabled(bool enabled)
+{
+    d_ptr->enabled.store(enabled);
+}
+
+auto ProbeCache::isEnabled() const -> bool
+{
+    return d_ptr->enabled.load();
+}
+
+void ProbeCache::setFastOpen(bool fastOpen)
+{
+    d_ptr->fastOpen.store(fastOpen);
+}
+
+auto ProbeCache::isFastOpen() const -> bool
+{
+    return d_ptr->fastOpen.load();
+}
+
+void ProbeCache::setMaxCaches(int max)
+{
+    Q_ASSERT(max > 0);
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->cache.setMaxCost(max);
+}
+
+auto ProbeCache::contains(const QString &filepath) -> bool
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    return d_ptr->find(filepath) != nullptr;
+}
+
+void ProbeCache::insert(const QString &filepath, AVFormatContext *formatCtx)
+{
+    QFileInfo fileInfo(filepath);
+    if (!d_ptr->enabled.load() || !fileInfo.isFile()) {
+        return;
+    }
+
+    QScopedPointer<ProbeEntry> entryPtr(new ProbeEntry);
+    entryPtr->fileSize = fileInfo.size();
+    entryPtr->lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    entryPtr->startTime = formatCtx->start_time;
+    entryPtr->duration = formatCtx->duration;
+    entryPtr->bitRate = formatCtx->bit_rate;
+    entryPtr->mediaInfo = MediaInfo(formatCtx);
+    entryPtr->hasMediaInfo = true;
+    entryPtr->mediaInfoJson = QJsonDocument(entryPtr->mediaInfo.toJson())
+                                  .toJson(QJsonDocument::Compact);
+    for (uint i = 0; i < formatCtx->nb_streams; i++) {
+        entryPtr->codecParameters.append(codecParametersFromStream(formatCtx->streams[i]));
+    }
+    if (ProbeCachePrivate::write(ProbeCachePrivate::cacheFilePath(fileInfo), *entryPtr)) {
+        ProbeCachePrivate::trimCache();
+    }
+
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->cache.insert(ProbeCachePrivate::cacheKey(fileInfo), entryPtr.take());
+}
+
+auto ProbeCache::apply(const QString &filepath, AVFormatContext *formatCtx) -> bool
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    auto *entry = d_ptr->find(filepath);
+    if (entry == nullptr || entry->codecParameters.size() != static_cast<int>(formatCtx->nb_streams)) {
+        return false;
+    }
+    for (uint i = 0; i < formatCtx->nb_streams; i++) {
+        const auto &p = entry->codecParameters.at(i);
+        const auto *codecpar = formatCtx->streams[i]->codecpar;
+        if (codecpar->codec_type != p.codecType
+            || (codecpar->codec_id != AV_CODEC_ID_NONE && codecpar->codec_id != p.codecId)) {
+            return false;
+        }
+    }
+    for (uint i = 0; i < formatCtx->nb_streams; i++) {
+        applyCodecParameters(entry->codecParameters.at(i), formatCtx->streams[i]);
+    }
+    if (formatCtx->start_time == AV_NOPTS_VALUE) {
+        formatCtx->start_time = entry->startTime;
+    }
+    if (formatCtx->duration == AV_NOPTS_VALUE || formatCtx->duration <= 0) {
+        formatCtx->duration = entry->duration;
+    }
+    if (formatCtx->bit_rate <= 0) {
+        formatCtx->bit_rate = entry->bitRate;
+    }
+    return true;
+}
+
+void ProbeCache::remove(const QString &filepath)
+{
+    QFileInfo fileInfo(filepath);
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->cache.remove(ProbeCachePrivate::cacheKey(fileInfo));
+    QFile::remove(ProbeCachePrivate::cacheFilePath(fileInfo));
+}
+
+void ProbeCache::clear()
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->cache.clear();
+    QDir(ProbeCachePrivate::cacheDirectory()).removeRecursively();
+}
+
+auto ProbeCache::mediaInfo(const QString &filepath, MediaInfo &mediaInfo) -> bool
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    auto *entry = d_ptr->find(filepath);
+    if (entry == nullptr || !entry->hasMediaInfo) {
+        return false;
+    }
+    mediaInfo = entry->mediaInfo;
+    return true;
+}
+
+void ProbeCache::setMediaInfo(const QString &filepath, const MediaInfo &mediaInfo)
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    auto *entry = d_ptr->find(filepath);
+    if (entry == nullptr) {
+        return;
+    }
+    entry->mediaInfo = mediaInfo;
+    entry->hasMediaInfo = true;
+}
+
+auto ProbeCache::mediaInfoJson(const QString &filepath) -> QJsonObject
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    auto *entry = d_ptr->find(filepath);
+    if (entry == nullptr) {
+        return {};
+    }
+    return QJsonDocument::fromJson(entry->mediaInfoJson).object();
+}
+
+} // namespace Ffmpeg
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ffmepg_global.h"
+#include "mediainfo.hpp"
+
+#include <utils/singleton.hpp>
+
+struct AVFormatContext;
+
+namespace Ffmpeg {
+
+// Process wide and on disk cache of probe results, keyed by path, size and mtime.
+// With fast open, FormatContext probes with a reduced probesize/analyzeduration and
+// completes the codec parameters from the cache.
+class FFMPEG_EXPORT ProbeCache : public QObject
+{
+    Q_OBJECT
+public:
+    void setEnabled(bool enabled);
+    [[nodiscard]] auto isEnabled() const -> bool;
+
+    void setFastOpen(bool fastOpen);
+    [[nodiscard]] auto isFastOpen() const -> bool;
+
+    void setMaxCaches(int max);
+
+    auto contains(const QString &filepath) -> bool;
+    void insert(const QString &filepath, AVFormatContext *formatCtx);
+    // Fills what the reduced probe left unset, false if the streams do not match the cache
+    auto apply(const QString &filepath, AVFormatContext *formatCtx) -> bool;
+    void remove(const QString &filepath);
+    void clear();
+
+    auto mediaInfo(const QString &filepath, MediaInfo &mediaInfo) -> bool;
+    void setMediaInfo(const QString &filepath, const MediaInfo &mediaInfo);
+    auto mediaInfoJson(const QString &filepath) -> QJsonObject;
+
+private:
+    explicit ProbeCache(QObject *parent = nullptr);
+    ~ProbeCache() override;
+
+    class ProbeCachePrivate;
+    QScopedPointer<ProbeCachePrivate> d_ptr;
+
+    SINGLETON(ProbeCache)
+};
+
+} // namespace Ffmpeg
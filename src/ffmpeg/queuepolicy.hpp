@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QtCore>
+
+namespace Ffmpeg {
+
+// Limits for the packet queue in front of a decoder, any budget <= 0 is unlimited and
+// reads back as 0 from the queue stats.
+struct QueuePolicy
+{
+    size_t maxPackets = 0;
+    qint64 maxBytes = 0;
+    qint64 maxDuration = 0; // microsecond
+
+    static auto videoDefault() -> QueuePolicy { return {1024, 64 * 1024 * 1024, 2 * 1000 * 1000}; }
+    // For truehd audio, the byte budget should be large enough
+    static auto audioDefault() -> QueuePolicy { return {4096, 16 * 1024 * 1024, 4 * 1000 * 1000}; }
+    static auto subtitleDefault() -> QueuePolicy { return {256, 4 * 1024 * 1024, 0}; }
+};
+
+struct QueueStats
+{
+    size_t packets = 0;
+    qint64 bytes = 0;
+    qint64 duration = 0; // microsecond
+    QueuePolicy policy;
+};
+
+struct PlayerQueueStats
+{
+    QueueStats audio;
+    QueueStats video;
+    QueueStats subtitle;
+    qint64 liveBytes = 0; // demuxed packet data alive anywhere, decoders and prefetch included
+
+    [[nodiscard]] auto bytes() const -> qint64 { return audio.bytes + video.bytes + subtitle.bytes; }
+};
+
+} // namespace Ffmpeg
@@ -88,6 +88,7 @@ public:
     AVSubtitle subtitle;
     qint64 pts = 0;
     qint64 duration = 0;
+    qint64 serial = 0;
     QString text;
 
     Subtitle::Type type = Subtitle::Unknown;
@@ -112,6 +113,16 @@ void Subtitle::setDefault(qint64 pts, qint64 duration, const QString &text)
     d_ptr->text = text;
 }
 
+void Subtitle::setSerial(qint64 serial)
+{
+    d_ptr->serial = serial;
+}
+
+auto Subtitle::serial() const -> qint64
+{
+    return d_ptr->serial;
+}
+
 void Subtitle::parse(SwsContext **swsContext)
 {
     switch (d_ptr->subtitle.format) {
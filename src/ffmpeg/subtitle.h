@@ -27,6 +27,9 @@ public:
     auto pts() -> qint64;                                              // microseconds
     auto duration() -> qint64;                                         // microseconds
 
+    void setSerial(qint64 serial);
+    [[nodiscard]] auto serial() const -> qint64;
+
     void parse(SwsContext **swsContext);
     [[nodiscard]] auto texts() const -> QByteArrayList;
 
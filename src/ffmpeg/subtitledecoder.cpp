@@ -1,4 +1,7 @@
 #include "subtitledecoder.h"
+#include "avcontextinfo.h"
+#include "clock.hpp"
+#include "codeccontext.h"
 #include "ffmpegutils.hpp"
 #include "subtitle.h"
 #include "subtitledisplay.hpp"
@@ -26,19 +29,30 @@ public:
             auto eventPtr = q_ptr->m_eventQueue.take();
             switch (eventPtr->type()) {
             case Event::EventType::Pause: decoderSubtitleFrame->addEvent(eventPtr); break;
-            case Event::EventType::Seek: {
-                auto *seekEvent = static_cast<SeekEvent *>(eventPtr.data());
-                seekEvent->countDown();
-                q_ptr->clear();
-                decoderSubtitleFrame->addEvent(eventPtr);
-            } break;
+            case Event::EventType::Seek: decoderSubtitleFrame->addEvent(eventPtr); break;
             default: break;
             }
         }
     }
 
+    // The first packet of a new serial. After a seek, whose event is always queued before it,
+    // the codec is flushed. The next media starts once the current one is done.
+    void processSerialChanged(qint64 packetSerial)
+    {
+        processEvent();
+        auto mediaChanged = serial >= 0 && !q_ptr->m_clockDomain->isStale(serial);
+        q_ptr->switchMedia(packetSerial);
+        if (!mediaChanged) {
+            q_ptr->m_contextInfo->codecCtx()->flush();
+            decoderSubtitleFrame->clear();
+        }
+        serial = packetSerial;
+    }
+
     SubtitleDecoder *q_ptr;
 
+    qint64 serial = -1;
+
     SubtitleDisplay *decoderSubtitleFrame;
 };
 
@@ -52,11 +66,43 @@ SubtitleDecoder::~SubtitleDecoder()
     stopDecoder();
 }
 
+void SubtitleDecoder::setClockDomain(ClockDomain *clockDomain)
+{
+    Decoder<PacketPtr>::setClockDomain(clockDomain);
+    d_ptr->decoderSubtitleFrame->setClockDomain(clockDomain);
+}
+
+auto SubtitleDecoder::waitForFinished(QDeadlineTimer deadline) -> bool
+{
+    return Decoder<PacketPtr>::waitForFinished(deadline)
+           && d_ptr->decoderSubtitleFrame->waitForFinished(deadline);
+}
+
+void SubtitleDecoder::wakeFinished()
+{
+    Decoder<PacketPtr>::wakeFinished();
+    d_ptr->decoderSubtitleFrame->wakeFinished();
+}
+
 void SubtitleDecoder::setVideoResolutionRatio(const QSize &size)
 {
     d_ptr->decoderSubtitleFrame->setVideoResolutionRatio(size);
 }
 
+void SubtitleDecoder::setNextMedia(qint64 serial,
+                                   FormatContext *formatContext,
+                                   AVContextInfo *contextInfo)
+{
+    d_ptr->decoderSubtitleFrame->setNextMedia(serial, formatContext, contextInfo);
+    Decoder<PacketPtr>::setNextMedia(serial, formatContext, contextInfo);
+}
+
+auto SubtitleDecoder::isMediaChangePending() -> bool
+{
+    return Decoder<PacketPtr>::isMediaChangePending()
+           || d_ptr->decoderSubtitleFrame->isMediaChangePending();
+}
+
 void SubtitleDecoder::setVideoRenders(const QVector<VideoRender *> &videoRenders)
 {
     d_ptr->decoderSubtitleFrame->setVideoRenders(videoRenders);
@@ -65,6 +111,7 @@ void SubtitleDecoder::setVideoRenders(const QVector<VideoRender *> &videoRenders
 void SubtitleDecoder::runDecoder()
 {
     d_ptr->decoderSubtitleFrame->startDecoder(m_formatContext, m_contextInfo);
+    d_ptr->serial = -1;
 
     while (m_runing) {
         d_ptr->processEvent();
@@ -73,6 +120,18 @@ void SubtitleDecoder::runDecoder()
         if (packetPtr.isNull()) {
             continue;
         }
+        if (isEndOfStream(packetPtr)) {
+            d_ptr->decoderSubtitleFrame->appendEndOfStream();
+            setFinished();
+            continue;
+        }
+        // Stale packets of an earlier seek
+        if (m_clockDomain->isStale(packetPtr->serial())) {
+            continue;
+        }
+        if (packetPtr->serial() != d_ptr->serial) {
+            d_ptr->processSerialChanged(packetPtr->serial());
+        }
         //qDebug() << "packet ass :" << QString::fromUtf8(packetPtr->avPacket()->data);
         SubtitlePtr subtitlePtr(new Subtitle);
         if (!m_contextInfo->decodeSubtitle2(subtitlePtr, packetPtr)) {
@@ -83,12 +142,10 @@ void SubtitleDecoder::runDecoder()
         subtitlePtr->setDefault(packetPtr->pts(),
                                 packetPtr->duration(),
                                 reinterpret_cast<const char *>(packetPtr->avPacket()->data));
+        subtitlePtr->setSerial(packetPtr->serial());
 
         d_ptr->decoderSubtitleFrame->append(subtitlePtr);
     }
-    while (m_runing && d_ptr->decoderSubtitleFrame->size() != 0) {
-        msleep(s_waitQueueEmptyMilliseconds);
-    }
     d_ptr->decoderSubtitleFrame->stopDecoder();
 }
 
@@ -14,10 +14,21 @@ public:
     explicit SubtitleDecoder(QObject *parent = nullptr);
     ~SubtitleDecoder() override;
 
+    void setClockDomain(ClockDomain *clockDomain) override;
+
+    // Also waits for the display behind the decoder
+    auto waitForFinished(QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever))
+        -> bool override;
+    void wakeFinished() override;
+
     void setVideoResolutionRatio(const QSize &size);
 
     void setVideoRenders(const QVector<VideoRender *> &videoRenders);
 
+    // Also hands the next media to the display stage
+    void setNextMedia(qint64 serial, FormatContext *formatContext, AVContextInfo *contextInfo);
+    auto isMediaChangePending() -> bool;
+
 protected:
     void runDecoder() override;
 
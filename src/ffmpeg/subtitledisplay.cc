@@ -48,7 +48,6 @@ public:
                 clock->setPaused(paused);
             } break;
             case Event::EventType::Seek: {
-                q_ptr->clear();
                 ass->flushASSEvents();
                 firstFrame = false;
             }
@@ -57,6 +56,17 @@ public:
         }
     }
 
+    [[nodiscard]] auto createAss(AVContextInfo *contextInfo) const -> Ass *
+    {
+        auto *ctx = contextInfo->codecCtx()->avCodecCtx();
+        auto *ass = new Ass;
+        if (ctx->subtitle_header != nullptr) {
+            ass->init(ctx->subtitle_header, ctx->subtitle_header_size);
+        }
+        ass->setWindowSize(videoResolutionRatio);
+        return ass;
+    }
+
     SubtitleDisplay *q_ptr;
 
     Clock *clock;
@@ -79,6 +89,12 @@ SubtitleDisplay::~SubtitleDisplay()
     stopDecoder();
 }
 
+void SubtitleDisplay::setClockDomain(ClockDomain *clockDomain)
+{
+    Decoder<SubtitlePtr>::setClockDomain(clockDomain);
+    d_ptr->clock->setDomain(clockDomain);
+}
+
 void SubtitleDisplay::setVideoResolutionRatio(const QSize &size)
 {
     if (!size.isValid()) {
@@ -96,14 +112,10 @@ void SubtitleDisplay::setVideoRenders(const QVector<VideoRender *> &videoRenders
 void SubtitleDisplay::runDecoder()
 {
     quint64 dropNum = 0;
-    auto *ctx = m_contextInfo->codecCtx()->avCodecCtx();
-    QScopedPointer<Ass> assPtr(new Ass);
-    if (ctx->subtitle_header != nullptr) {
-        assPtr->init(ctx->subtitle_header, ctx->subtitle_header_size);
-    }
-    assPtr->setWindowSize(d_ptr->videoResolutionRatio);
+    QScopedPointer<Ass> assPtr(d_ptr->createAss(m_contextInfo));
     SwsContext *swsContext = nullptr;
     bool firstFrame = false;
+    qint64 serial = -1;
     while (m_runing.load()) {
         d_ptr->processEvent(assPtr.data(), firstFrame);
 
@@ -111,6 +123,21 @@ void SubtitleDisplay::runDecoder()
         if (subtitlePtr.isNull()) {
             continue;
         }
+        if (isEndOfStream(subtitlePtr)) {
+            setFinished();
+            continue;
+        }
+        if (m_clockDomain->isStale(subtitlePtr->serial())) {
+            continue;
+        }
+        if (subtitlePtr->serial() != serial) {
+            d_ptr->processEvent(assPtr.data(), firstFrame);
+            serial = subtitlePtr->serial();
+            if (switchMedia(serial)) {
+                assPtr.reset(d_ptr->createAss(m_contextInfo));
+                firstFrame = false;
+            }
+        }
         if (!firstFrame) {
             qDebug() << "Subtitle firstFrame: "
                      << QTime::fromMSecsSinceStartOfDay(subtitlePtr->pts() / 1000)
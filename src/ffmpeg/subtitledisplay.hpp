@@ -15,6 +15,8 @@ public:
     explicit SubtitleDisplay(QObject *parent = nullptr);
     ~SubtitleDisplay() override;
 
+    void setClockDomain(ClockDomain *clockDomain) override;
+
     void setVideoResolutionRatio(const QSize &size);
 
     void setVideoRenders(const QVector<VideoRender *> &videoRenders);
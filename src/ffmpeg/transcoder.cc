@@ -13,12 +13,13 @@
 #include "transcodercontext.hpp"
 
 #include <event/errorevent.hpp>
+#include <event/propertychannel.hpp>
 #include <event/trackevent.hpp>
 #include <event/valueevent.hpp>
 #include <filter/filter.hpp>
 #include <filter/filtercontext.hpp>
+#include <utils/executor.hpp>
 #include <utils/fps.hpp>
-#include <utils/threadsafequeue.hpp>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -99,10 +100,9 @@ public:
         , inFormatContext(new FormatContext(q_ptr))
         , outFormatContext(new FormatContext(q_ptr))
         , fpsPtr(new Utils::Fps)
+        , taskGroup(new Utils::TaskGroup(2))
     {
-        threadPool = new QThreadPool(q_ptr);
-        threadPool->setMaxThreadCount(2);
-
+        propertyChannel = new PropertyChannel(q_ptr);
         QObject::connect(AVErrorManager::instance(),
                          &AVErrorManager::error,
                          q_ptr,
@@ -370,20 +370,19 @@ public:
                           const FramePtr &framePtr,
                           bool flush) const -> bool
     {
-        std::vector<PacketPtr> packetPtrs{};
-        if (flush) {
-            FramePtr frame_tmp_ptr(new Frame);
-            frame_tmp_ptr->destroyFrame();
-            packetPtrs = transcodeCtx->encContextInfoPtr->encodeFrame(frame_tmp_ptr);
-        } else {
-            packetPtrs = transcodeCtx->encContextInfoPtr->encodeFrame(framePtr);
-        }
         auto outStreamIndex = transcodeCtx->outStreamIndex;
-        for (const auto &packetPtr : std::as_const(packetPtrs)) {
+        auto writePacket = [&](const PacketPtr &packetPtr) {
             packetPtr->setStreamIndex(outStreamIndex);
             packetPtr->rescaleTs(transcodeCtx->encContextInfoPtr->timebase(),
                                  outFormatContext->stream(outStreamIndex)->time_base);
             outFormatContext->writePacket(packetPtr.data());
+        };
+        if (flush) {
+            FramePtr frame_tmp_ptr(new Frame);
+            frame_tmp_ptr->destroyFrame();
+            transcodeCtx->encContextInfoPtr->encodeFrame(frame_tmp_ptr, writePacket);
+        } else {
+            transcodeCtx->encContextInfoPtr->encodeFrame(framePtr, writePacket);
         }
         return true;
     }
@@ -407,7 +406,7 @@ public:
     void loop()
     {
         while (runing.load()) {
-            PacketPtr packetPtr(new Packet);
+            auto packetPtr = packetPool.acquire();
             if (!inFormatContext->readFrame(packetPtr.get())) {
                 break;
             }
@@ -427,18 +426,18 @@ public:
                 outFormatContext->writePacket(packetPtr.data());
             } else {
                 packetPtr->rescaleTs(inTimebase, transcodeCtx->decContextInfoPtr->timebase());
-                auto framePtrs = transcodeCtx->decContextInfoPtr->decodeFrame(packetPtr);
-                for (const auto &framePtr : std::as_const(framePtrs)) {
+                transcodeCtx->decContextInfoPtr->decodeFrame(packetPtr, [&](const FramePtr &framePtr) {
                     if (!transcodeCtx->filterPtr->isInitialized()) {
                         initFilters(stream_index, framePtr);
                     }
                     filterEncodeWriteframe(framePtr, stream_index);
-                }
+                });
 
                 calculatePts(packetPtr.data(), decContextInfoPtr.data());
-                addPropertyChangeEvent(new PositionEvent(packetPtr->pts()));
+                propertyChannel->setPosition(packetPtr->pts());
                 if (transcodeCtx->decContextInfoPtr->mediaType() == AVMEDIA_TYPE_VIDEO) {
                     fpsPtr->update();
+                    propertyChannel->setFps(fpsPtr->getFps());
                 }
             }
         }
@@ -446,11 +445,7 @@ public:
 
     void addPropertyChangeEvent(PropertyChangeEvent *event)
     {
-        propertyChangeEventQueue.append(PropertyChangeEventPtr(event));
-        while (propertyChangeEventQueue.size() > maxPropertyEventQueueSize.load()) {
-            propertyChangeEventQueue.take();
-        }
-        emit q_ptr->eventIncrease();
+        propertyChannel->addEvent(event);
     }
 
     void reset()
@@ -510,14 +505,16 @@ public:
 
     std::atomic_bool runing = true;
     QScopedPointer<Utils::Fps> fpsPtr;
+    // One packet in flight at a time, a couple of shells are enough
+    PacketPool packetPool{4};
 
     bool gpuDecode = true;
 
-    Utils::ThreadSafeQueue<PropertyChangeEventPtr> propertyChangeEventQueue;
-    std::atomic<size_t> maxPropertyEventQueueSize = 100;
+    PropertyChannel *propertyChannel;
 
     std::vector<FramePtr> previewFrames;
-    QThreadPool *threadPool;
+    // Parsing and previews on the shared executor
+    QScopedPointer<Utils::TaskGroup> taskGroup;
 };
 
 Transcoder::Transcoder(QObject *parent)
@@ -529,8 +526,9 @@ Transcoder::Transcoder(QObject *parent)
 
 Transcoder::~Transcoder()
 {
-    d_ptr->threadPool->clear();
+    d_ptr->taskGroup->clear();
     stopTranscode();
+    d_ptr->taskGroup->waitForDone();
 }
 
 void Transcoder::setInFilePath(const QString &filePath)
@@ -541,7 +539,7 @@ void Transcoder::setInFilePath(const QString &filePath)
 void Transcoder::parseInputFile()
 {
     d_ptr->reset();
-    d_ptr->threadPool->start([this] { d_ptr->openInputFile(true); });
+    d_ptr->taskGroup->start([this] { d_ptr->openInputFile(true); });
 }
 
 auto Transcoder::duration() const -> qint64
@@ -560,7 +558,7 @@ auto Transcoder::mediaInfo() -> MediaInfo
 
 void Transcoder::startPreviewFrames(int count)
 {
-    d_ptr->threadPool->start(new PreviewCountTask(d_ptr->inFilePath, count, this));
+    d_ptr->taskGroup->start(new PreviewCountTask(d_ptr->inFilePath, count, this));
 }
 
 void Transcoder::setPreviewFrames(const std::vector<QSharedPointer<Frame>> &framePtrs)
@@ -651,22 +649,17 @@ auto Transcoder::fps() -> float
 
 void Transcoder::setPropertyEventQueueMaxSize(size_t size)
 {
-    d_ptr->maxPropertyEventQueueSize.store(size);
+    d_ptr->propertyChannel->setMaxEventSize(size);
 }
 
 auto Transcoder::propertEventyQueueMaxSize() const -> size_t
 {
-    return d_ptr->maxPropertyEventQueueSize.load();
-}
-
-auto Transcoder::propertyChangeEventSize() const -> size_t
-{
-    return d_ptr->propertyChangeEventQueue.size();
+    return d_ptr->propertyChannel->maxEventSize();
 }
 
-auto Transcoder::takePropertyChangeEvent() -> PropertyChangeEventPtr
+auto Transcoder::propertyChannel() const -> PropertyChannel *
 {
-    return d_ptr->propertyChangeEventQueue.take();
+    return d_ptr->propertyChannel;
 }
 
 void Transcoder::run()
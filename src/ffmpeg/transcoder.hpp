@@ -16,6 +16,7 @@ namespace Ffmpeg {
 
 class AVError;
 class Frame;
+class PropertyChannel;
 class FFMPEG_EXPORT Transcoder : public QThread
 {
     Q_OBJECT
@@ -51,11 +52,8 @@ public:
 
     void setPropertyEventQueueMaxSize(size_t size);
     [[nodiscard]] auto propertEventyQueueMaxSize() const -> size_t;
-    [[nodiscard]] auto propertyChangeEventSize() const -> size_t;
-    auto takePropertyChangeEvent() -> PropertyChangeEventPtr;
-
-signals:
-    void eventIncrease();
+    // Position, fps and the other property changes, read on the thread of the transcoder
+    [[nodiscard]] auto propertyChannel() const -> PropertyChannel *;
 
 protected:
     void run() override;
@@ -1,5 +1,7 @@
 #include "videodecoder.h"
 #include "avcontextinfo.h"
+#include "clock.hpp"
+#include "codeccontext.h"
 #include "ffmpegutils.hpp"
 #include "videodisplay.hpp"
 #include "videoformat.hpp"
@@ -8,6 +10,10 @@
 
 #include <QDebug>
 
+extern "C" {
+#include <libavutil/time.h>
+}
+
 namespace Ffmpeg {
 
 class VideoDecoder::VideoDecoderPrivate
@@ -19,7 +25,7 @@ public:
         decoderVideoFrame = new VideoDisplay(q_ptr);
     }
 
-    void processEvent() const
+    void processEvent()
     {
         while (q_ptr->m_runing.load() && !q_ptr->m_eventQueue.empty()) {
             auto eventPtr = q_ptr->m_eventQueue.take();
@@ -27,8 +33,11 @@ public:
             case Event::EventType::Pause: decoderVideoFrame->addEvent(eventPtr); break;
             case Event::EventType::Seek: {
                 auto *seekEvent = static_cast<SeekEvent *>(eventPtr.data());
-                seekEvent->countDown();
-                q_ptr->clear();
+                seekTarget = seekEvent->mode() == SeekMode::Exact ? seekEvent->position() : -1;
+                // Scrub only decodes keyframes until the next seek
+                scrubbing = seekEvent->mode() == SeekMode::Scrub;
+                skipController.reset(av_gettime_relative());
+                applySkipFrame();
                 decoderVideoFrame->addEvent(eventPtr);
             } break;
             default: break;
@@ -36,8 +45,120 @@ public:
         }
     }
 
+    // The first packet of a new serial. After a seek, whose event is always queued before it,
+    // the codec is flushed. The next media starts once the current one is drained.
+    void processSerialChanged(qint64 packetSerial)
+    {
+        processEvent();
+        if (serial >= 0 && !q_ptr->m_clockDomain->isStale(serial)) {
+            drainCodec();
+            seekTarget = -1;
+            if (q_ptr->switchMedia(packetSerial)) {
+                // The codec of the next media starts without the skip level
+                applySkipFrame();
+            }
+        } else {
+            q_ptr->switchMedia(packetSerial);
+            q_ptr->m_contextInfo->codecCtx()->flush();
+            decoderVideoFrame->clear();
+        }
+        serial = packetSerial;
+    }
+
+    // return the number of frames out of the codec
+    auto decodePacket(const PacketPtr &packetPtr) -> int
+    {
+        int frames = 0;
+        q_ptr->m_contextInfo->decodeFrame(packetPtr, [&](const FramePtr &framePtr) {
+            frames++;
+            framePtr->setSerial(serial);
+            calculatePts(framePtr.data(), q_ptr->m_contextInfo, q_ptr->m_formatContext);
+            if (discardBeforeTarget(framePtr)) {
+                return;
+            }
+            decoderVideoFrame->append(framePtr);
+        });
+        return frames;
+    }
+
+    // Feedback from the display, checked before every packet
+    void updateSkipLevel()
+    {
+        bool changed = false;
+        auto keyframesOnly = this->keyframesOnly.load(std::memory_order_relaxed);
+        if (keyframesOnly != keyframesOnlyApplied) {
+            keyframesOnlyApplied = keyframesOnly;
+            applySkipFrame();
+        }
+        // Trick play already decodes keyframes only
+        if (frameSkipEnabled.load(std::memory_order_relaxed) && !keyframesOnlyApplied) {
+            changed = skipController.update(decoderVideoFrame->lateness(), av_gettime_relative());
+        } else if (skipController.level() != SkipLevel::None) {
+            skipController.reset(av_gettime_relative());
+            changed = true;
+        }
+        if (changed) {
+            qInfo() << "Video skip level:" << static_cast<int>(skipController.level())
+                    << "lateness:" << decoderVideoFrame->lateness();
+            applySkipFrame();
+        }
+    }
+
+    void applySkipFrame()
+    {
+        auto level = skipController.level();
+        skipLevel.store(level, std::memory_order_relaxed);
+        q_ptr->m_contextInfo->codecCtx()->setSkipFrame(
+            scrubbing || keyframesOnlyApplied ? AVDISCARD_NONKEY : toDiscard(level));
+    }
+
+    static auto toDiscard(SkipLevel level) -> AVDiscard
+    {
+        switch (level) {
+        case SkipLevel::NonRef: return AVDISCARD_NONREF;
+        case SkipLevel::Bidir: return AVDISCARD_BIDIR;
+        case SkipLevel::NonKey: return AVDISCARD_NONKEY;
+        default: break;
+        }
+        return AVDISCARD_DEFAULT;
+    }
+
+    // The frames left in the codec keep the serial of the current media
+    void drainCodec()
+    {
+        if (serial < 0) {
+            return;
+        }
+        decodePacket(PacketPtr(new Packet));
+        q_ptr->m_contextInfo->codecCtx()->flush();
+    }
+
+    // Exact seek, frames which end before the target are never shown
+    auto discardBeforeTarget(const FramePtr &framePtr) -> bool
+    {
+        if (seekTarget < 0) {
+            return false;
+        }
+        if (framePtr->pts() + framePtr->duration() <= seekTarget) {
+            return true;
+        }
+        seekTarget = -1;
+        return false;
+    }
+
     VideoDecoder *q_ptr;
 
+    qint64 seekTarget = -1;
+    qint64 serial = -1;
+
+    bool scrubbing = false;
+    bool keyframesOnlyApplied = false;
+    std::atomic_bool keyframesOnly = false;
+    FrameSkipController skipController;
+    std::atomic_bool frameSkipEnabled = true;
+    std::atomic<SkipLevel> skipLevel = SkipLevel::None;
+    std::atomic<quint64> skippedFrames = 0;
+
     VideoDisplay *decoderVideoFrame;
 };
 
@@ -48,7 +169,12 @@ VideoDecoder::VideoDecoder(QObject *parent)
     connect(d_ptr->decoderVideoFrame,
             &VideoDisplay::positionChanged,
             this,
-            &VideoDecoder::positionChanged);
+            &VideoDecoder::positionChanged,
+            Qt::DirectConnection);
+    connect(d_ptr->decoderVideoFrame,
+            &VideoDisplay::seekLanded,
+            this,
+            &VideoDecoder::seekLanded);
 }
 
 VideoDecoder::~VideoDecoder()
@@ -56,11 +182,77 @@ VideoDecoder::~VideoDecoder()
     stopDecoder();
 }
 
+void VideoDecoder::setClockDomain(ClockDomain *clockDomain)
+{
+    Decoder<PacketPtr>::setClockDomain(clockDomain);
+    d_ptr->decoderVideoFrame->setClockDomain(clockDomain);
+}
+
+auto VideoDecoder::waitForFinished(QDeadlineTimer deadline) -> bool
+{
+    return Decoder<PacketPtr>::waitForFinished(deadline)
+           && d_ptr->decoderVideoFrame->waitForFinished(deadline);
+}
+
+void VideoDecoder::wakeFinished()
+{
+    Decoder<PacketPtr>::wakeFinished();
+    d_ptr->decoderVideoFrame->wakeFinished();
+}
+
 void VideoDecoder::setVideoRenders(const QVector<VideoRender *> &videoRenders)
 {
     d_ptr->decoderVideoFrame->setVideoRenders(videoRenders);
 }
 
+auto VideoDecoder::frameQueueSize() -> size_t
+{
+    return d_ptr->decoderVideoFrame->size();
+}
+
+void VideoDecoder::setNextMedia(qint64 serial,
+                                FormatContext *formatContext,
+                                AVContextInfo *contextInfo)
+{
+    d_ptr->decoderVideoFrame->setNextMedia(serial, formatContext, contextInfo);
+    Decoder<PacketPtr>::setNextMedia(serial, formatContext, contextInfo);
+}
+
+auto VideoDecoder::isMediaChangePending() -> bool
+{
+    return Decoder<PacketPtr>::isMediaChangePending()
+           || d_ptr->decoderVideoFrame->isMediaChangePending();
+}
+
+void VideoDecoder::setFrameSkipEnabled(bool enabled)
+{
+    d_ptr->frameSkipEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+auto VideoDecoder::isFrameSkipEnabled() const -> bool
+{
+    return d_ptr->frameSkipEnabled.load(std::memory_order_relaxed);
+}
+
+auto VideoDecoder::frameSkipStats() const -> FrameSkipStats
+{
+    FrameSkipStats stats;
+    stats.level = d_ptr->skipLevel.load(std::memory_order_relaxed);
+    stats.skippedFrames = d_ptr->skippedFrames.load(std::memory_order_relaxed);
+    stats.droppedFrames = d_ptr->decoderVideoFrame->droppedFrames();
+    return stats;
+}
+
+auto VideoDecoder::avOffset() const -> qint64
+{
+    return d_ptr->decoderVideoFrame->avOffset();
+}
+
+void VideoDecoder::setKeyframesOnly(bool keyframesOnly)
+{
+    d_ptr->keyframesOnly.store(keyframesOnly, std::memory_order_relaxed);
+}
+
 void VideoDecoder::setMasterClock()
 {
     d_ptr->decoderVideoFrame->setMasterClock();
@@ -69,6 +261,12 @@ void VideoDecoder::setMasterClock()
 void VideoDecoder::runDecoder()
 {
     d_ptr->decoderVideoFrame->startDecoder(m_formatContext, m_contextInfo);
+    d_ptr->serial = -1;
+    d_ptr->scrubbing = false;
+    d_ptr->keyframesOnlyApplied = false;
+    d_ptr->skipController.reset(av_gettime_relative());
+    d_ptr->skipLevel.store(SkipLevel::None, std::memory_order_relaxed);
+    d_ptr->skippedFrames.store(0, std::memory_order_relaxed);
 
     while (m_runing) {
         d_ptr->processEvent();
@@ -77,16 +275,29 @@ void VideoDecoder::runDecoder()
         if (packetPtr.isNull()) {
             continue;
         }
-        auto framePtrs = m_contextInfo->decodeFrame(packetPtr);
-        for (const auto &framePtr : framePtrs) {
-            calculatePts(framePtr.data(), m_contextInfo, m_formatContext);
-            d_ptr->decoderVideoFrame->append(framePtr);
+        if (isEndOfStream(packetPtr)) {
+            d_ptr->drainCodec();
+            d_ptr->decoderVideoFrame->appendEndOfStream();
+            setFinished();
+            continue;
+        }
+        // Stale packets of an earlier seek
+        if (m_clockDomain->isStale(packetPtr->serial())) {
+            continue;
+        }
+        if (packetPtr->serial() != d_ptr->serial) {
+            d_ptr->processSerialChanged(packetPtr->serial());
+        }
+        d_ptr->updateSkipLevel();
+        // With frame threads the output lags, but each packet yields one frame on average,
+        // so a packet without output while skipping is counted as a skipped frame
+        auto frames = d_ptr->decodePacket(packetPtr);
+        if (frames == 0 && d_ptr->skipController.level() != SkipLevel::None) {
+            d_ptr->skippedFrames.fetch_add(1, std::memory_order_relaxed);
         }
-    }
-    while (m_runing && d_ptr->decoderVideoFrame->size() != 0) {
-        msleep(s_waitQueueEmptyMilliseconds);
     }
     d_ptr->decoderVideoFrame->stopDecoder();
+    qInfo() << "Video Skipped Num:" << d_ptr->skippedFrames.load();
 }
 
 } // namespace Ffmpeg
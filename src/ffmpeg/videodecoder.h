@@ -2,6 +2,7 @@
 #define VIDEODECODER_H
 
 #include "decoder.h"
+#include "frameskip.hpp"
 #include "packet.h"
 
 namespace Ffmpeg {
@@ -15,12 +16,37 @@ public:
     explicit VideoDecoder(QObject *parent = nullptr);
     ~VideoDecoder() override;
 
+    void setClockDomain(ClockDomain *clockDomain) override;
+
+    // Also waits for the display behind the decoder
+    auto waitForFinished(QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever))
+        -> bool override;
+    void wakeFinished() override;
+
     void setVideoRenders(const QVector<VideoRender *> &videoRenders);
 
     void setMasterClock();
 
+    // Also hands the next media to the display stage
+    void setNextMedia(qint64 serial, FormatContext *formatContext, AVContextInfo *contextInfo);
+    auto isMediaChangePending() -> bool;
+
+    // Decoded frames not rendered yet
+    auto frameQueueSize() -> size_t;
+
+    // Skips frames before decoding while the display falls behind, on by default
+    void setFrameSkipEnabled(bool enabled);
+    [[nodiscard]] auto isFrameSkipEnabled() const -> bool;
+    [[nodiscard]] auto frameSkipStats() const -> FrameSkipStats;
+
+    [[nodiscard]] auto avOffset() const -> qint64; // microsecond
+
+    // Trick play, only keyframes are decoded until it is turned off
+    void setKeyframesOnly(bool keyframesOnly);
+
 signals:
     void positionChanged(qint64 position); // microsecond
+    void seekLanded(const Ffmpeg::EventPtr &eventPtr, qint64 position);
 
 protected:
     void runDecoder() override;
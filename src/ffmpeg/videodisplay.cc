@@ -9,6 +9,8 @@
 #include <QTime>
 #include <QWaitCondition>
 
+#include <optional>
+
 extern "C" {
 #include <libavutil/time.h>
 }
@@ -32,10 +34,9 @@ public:
         }
     }
 
-    void processEvent(bool &firstFrame) const
+    void processEvent(bool &firstFrame)
     {
         while (q_ptr->m_runing.load() && !q_ptr->m_eventQueue.empty()) {
-            qDebug() << "DecoderVideoFrame::processEvent";
             auto eventPtr = q_ptr->m_eventQueue.take();
             switch (eventPtr->type()) {
             case Event::EventType::Pause: {
@@ -44,8 +45,8 @@ public:
                 clock->setPaused(paused);
             } break;
             case Event::EventType::Seek: {
-                q_ptr->clear();
                 firstFrame = false;
+                seekEventPtr = eventPtr;
             }
             default: break;
             }
@@ -55,6 +56,11 @@ public:
     VideoDisplay *q_ptr;
 
     Clock *clock;
+    EventPtr seekEventPtr;
+
+    std::atomic<qint64> lateness = 0;
+    std::atomic<quint64> dropNum = 0;
+    std::atomic<qint64> avOffset = 0;
 
     QMutex mutex;
     QWaitCondition waitCondition;
@@ -73,6 +79,12 @@ VideoDisplay::~VideoDisplay()
     stopDecoder();
 }
 
+void VideoDisplay::setClockDomain(ClockDomain *clockDomain)
+{
+    Decoder<FramePtr>::setClockDomain(clockDomain);
+    d_ptr->clock->setDomain(clockDomain);
+}
+
 void VideoDisplay::setVideoRenders(const QVector<VideoRender *> &videoRenders)
 {
     QMutexLocker locker(&d_ptr->mutex_render);
@@ -81,7 +93,22 @@ void VideoDisplay::setVideoRenders(const QVector<VideoRender *> &videoRenders)
 
 void VideoDisplay::setMasterClock()
 {
-    Clock::setMaster(d_ptr->clock);
+    m_clockDomain->setMaster(d_ptr->clock);
+}
+
+auto VideoDisplay::lateness() const -> qint64
+{
+    return d_ptr->lateness.load(std::memory_order_relaxed);
+}
+
+auto VideoDisplay::droppedFrames() const -> quint64
+{
+    return d_ptr->dropNum.load(std::memory_order_relaxed);
+}
+
+auto VideoDisplay::avOffset() const -> qint64
+{
+    return d_ptr->avOffset.load(std::memory_order_relaxed);
 }
 
 void VideoDisplay::runDecoder()
@@ -89,8 +116,12 @@ void VideoDisplay::runDecoder()
     for (auto *render : d_ptr->videoRenders) {
         render->resetFps();
     }
-    quint64 dropNum = 0;
+    d_ptr->lateness.store(0, std::memory_order_relaxed);
+    d_ptr->dropNum.store(0, std::memory_order_relaxed);
+    d_ptr->avOffset.store(0, std::memory_order_relaxed);
+    std::optional<qint64> avOffset;
     bool firstFrame = false;
+    qint64 serial = -1;
     while (m_runing.load()) {
         d_ptr->processEvent(firstFrame);
 
@@ -98,12 +129,30 @@ void VideoDisplay::runDecoder()
         if (framePtr.isNull()) {
             continue;
         }
+        if (isEndOfStream(framePtr)) {
+            setFinished();
+            continue;
+        }
+        if (m_clockDomain->isStale(framePtr->serial())) {
+            continue;
+        }
+        if (framePtr->serial() != serial) {
+            d_ptr->processEvent(firstFrame);
+            serial = framePtr->serial();
+            if (switchMedia(serial)) {
+                firstFrame = false;
+            }
+        }
         if (!firstFrame) {
             qDebug() << "Video firstFrame: "
                      << QTime::fromMSecsSinceStartOfDay(framePtr->pts() / 1000)
                             .toString("hh:mm:ss.zzz");
             firstFrame = true;
             d_ptr->clock->reset(framePtr->pts());
+            if (!d_ptr->seekEventPtr.isNull()) {
+                emit seekLanded(d_ptr->seekEventPtr, framePtr->pts());
+                d_ptr->seekEventPtr.reset();
+            }
         }
         auto pts = framePtr->pts();
         d_ptr->clock->update(pts, av_gettime_relative());
@@ -112,9 +161,10 @@ void VideoDisplay::runDecoder()
             continue;
         }
         auto emitPosition = qScopeGuard([=]() { emit positionChanged(pts); });
+        d_ptr->lateness.store(qMax<qint64>(0, -delay), std::memory_order_relaxed);
         if (!d_ptr->clock->adjustDelay(delay)) {
             qDebug() << "Video Delay: " << delay;
-            dropNum++;
+            d_ptr->dropNum.fetch_add(1, std::memory_order_relaxed);
             continue;
         }
         if (delay > 0) {
@@ -122,8 +172,19 @@ void VideoDisplay::runDecoder()
             d_ptr->waitCondition.wait(&d_ptr->mutex, delay / 1000);
         }
         d_ptr->renderFrame(framePtr);
+
+        // Measured once the frame is up, against where the master is now
+        auto *masterClock = m_clockDomain->master();
+        if (masterClock == d_ptr->clock || masterClock->serial() != serial) {
+            avOffset.reset();
+        } else {
+            auto offset = pts - masterClock->position(av_gettime_relative());
+            avOffset = avOffset ? *avOffset + (offset - *avOffset) / 8 : offset;
+        }
+        d_ptr->avOffset.store(avOffset.value_or(0), std::memory_order_relaxed);
     }
-    qInfo() << "Video Drop Num:" << dropNum;
+    qInfo() << "Video Drop Num:" << d_ptr->dropNum.load()
+            << "A/V offset:" << d_ptr->avOffset.load() << "us";
 }
 
 } // namespace Ffmpeg
@@ -15,12 +15,23 @@ public:
     explicit VideoDisplay(QObject *parent = nullptr);
     ~VideoDisplay() override;
 
+    void setClockDomain(ClockDomain *clockDomain) override;
+
     void setVideoRenders(const QVector<VideoRender *> &videoRenders);
 
     void setMasterClock();
 
+    // How far the last frame was behind the master clock, any thread
+    [[nodiscard]] auto lateness() const -> qint64; // microsecond
+    [[nodiscard]] auto droppedFrames() const -> quint64;
+    // Averaged distance of the shown frames to the master clock, positive when the video
+    // is ahead, 0 when the video is the master
+    [[nodiscard]] auto avOffset() const -> qint64; // microsecond
+
 signals:
     void positionChanged(qint64 position); // microsecond
+    // Reports the first frame after a seek
+    void seekLanded(const Ffmpeg::EventPtr &eventPtr, qint64 position);
 
 protected:
     void runDecoder() override;
@@ -9,8 +9,9 @@
 #include <ffmpeg/videodecoder.h>
 #include <ffmpeg/videoframeconverter.hpp>
 
+#include <utils/executor.hpp>
+
 #include <QPainter>
-#include <QRunnable>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -23,10 +24,8 @@ class VideoPreviewWidget::VideoPreviewWidgetPrivate
 public:
     explicit VideoPreviewWidgetPrivate(VideoPreviewWidget *q)
         : q_ptr(q)
-    {
-        threadPool = new QThreadPool(q_ptr);
-        threadPool->setMaxThreadCount(2);
-    }
+        , taskGroup(new Utils::TaskGroup(2))
+    {}
     ~VideoPreviewWidgetPrivate()
     {
         qDebug() << "Task ID: " << taskId.loadRelaxed() << "Vaild Count: " << vaildCount;
@@ -43,7 +42,7 @@ public:
 
     QAtomicInt taskId = 0;
     qint64 vaildCount = 0;
-    QThreadPool *threadPool;
+    QScopedPointer<Utils::TaskGroup> taskGroup;
 };
 
 VideoPreviewWidget::VideoPreviewWidget(QWidget *parent)
@@ -55,7 +54,10 @@ VideoPreviewWidget::VideoPreviewWidget(QWidget *parent)
 
 VideoPreviewWidget::~VideoPreviewWidget()
 {
+    // A running task stops on the task id change
+    d_ptr->taskId.ref();
     clearAllTask();
+    d_ptr->taskGroup->waitForDone();
 }
 
 void VideoPreviewWidget::startPreview(const QString &filepath,
@@ -66,7 +68,7 @@ void VideoPreviewWidget::startPreview(const QString &filepath,
     Q_ASSERT(videoIndex >= 0);
     d_ptr->taskId.ref();
     clearAllTask();
-    d_ptr->threadPool->start(
+    d_ptr->taskGroup->start(
         new PreviewOneTask(filepath, videoIndex, timestamp, d_ptr->taskId.loadRelaxed(), this));
     d_ptr->timestamp = timestamp;
     d_ptr->duration = duration;
@@ -78,7 +80,7 @@ void VideoPreviewWidget::startPreview(const QString &filepath,
 
 void VideoPreviewWidget::clearAllTask()
 {
-    d_ptr->threadPool->clear();
+    d_ptr->taskGroup->clear();
 }
 
 void VideoPreviewWidget::setDisplayImage(const QSharedPointer<Frame> &framePtr,
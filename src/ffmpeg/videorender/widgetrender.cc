@@ -85,7 +85,6 @@ public:
 
     auto fliterFrame(const FramePtr &framePtr) -> FramePtr
     {
-        static FrameParam lastFrameParam;
         FrameParam frameParam(framePtr.data());
 
         auto *avframe = framePtr->avFrame();
@@ -141,6 +140,7 @@ public:
 
     QColor backgroundColor = Qt::black;
 
+    FrameParam lastFrameParam;
     QSize lastScaleSize;
     MediaConfig::Equalizer equalizer;
     ToneMapping::Type tonemapType;
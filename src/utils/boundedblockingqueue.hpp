@@ -4,6 +4,7 @@
 #include <QWaitCondition>
 
 #include <deque>
+#include <functional>
 
 namespace Utils {
 
@@ -13,7 +14,14 @@ class BoundedBlockingQueue
     Q_DISABLE_COPY_MOVE(BoundedBlockingQueue);
 
 public:
+    struct Cost
+    {
+        qint64 bytes = 0;
+        qint64 duration = 0;
+    };
+
     using ClearCallback = std::function<void(T &)>;
+    using CostCallback = std::function<Cost(const T &)>;
 
     explicit BoundedBlockingQueue(int maxSize)
         : m_maxSize(maxSize)
@@ -22,40 +30,40 @@ public:
     void append(const T &x)
     {
         QMutexLocker locker(&m_mutex);
-        while (m_queue.size() >= m_maxSize) {
+        while (isFull()) {
             m_notFull.wait(&m_mutex);
         }
-        m_queue.push_back(x);
+        push(x, false);
         m_notEmpty.wakeOne();
     }
 
     void append(T &&x)
     {
         QMutexLocker locker(&m_mutex);
-        while (m_queue.size() >= m_maxSize) {
+        while (isFull()) {
             m_notFull.wait(&m_mutex);
         }
-        m_queue.push_back(std::move(x));
+        push(std::move(x), false);
         m_notEmpty.wakeOne();
     }
 
     void insertHead(const T &x)
     {
         QMutexLocker locker(&m_mutex);
-        while (m_queue.size() >= m_maxSize) {
+        while (isFull()) {
             m_notFull.wait(&m_mutex);
         }
-        m_queue.push_front(x);
+        push(x, true);
         m_notEmpty.wakeOne();
     }
 
     void insertHead(T &&x)
     {
         QMutexLocker locker(&m_mutex);
-        while (m_queue.size() >= m_maxSize) {
+        while (isFull()) {
             m_notFull.wait(&m_mutex);
         }
-        m_queue.push_front(std::move(x));
+        push(std::move(x), true);
         m_notEmpty.wakeOne();
     }
 
@@ -65,7 +73,10 @@ public:
         while (m_queue.empty()) {
             m_notEmpty.wait(&m_mutex);
         }
-        T front(std::move(m_queue.front()));
+        auto &item = m_queue.front();
+        m_bytes -= item.cost.bytes;
+        m_duration -= item.cost.duration;
+        T front(std::move(item.value));
         m_queue.pop_front();
         m_notFull.wakeOne();
         return front;
@@ -77,16 +88,33 @@ public:
         if (callback) {
             while (!m_queue.empty()) {
                 if (callback) {
-                    callback(m_queue.front());
+                    callback(m_queue.front().value);
                 }
                 m_queue.pop_front();
             }
         } else if (!m_queue.empty()) {
             m_queue.clear();
         }
+        m_bytes = 0;
+        m_duration = 0;
         m_notFull.wakeAll();
     }
 
+    // Wakes a consumer blocked in take(), which then returns a null T() once. Only an empty
+    // queue gets the null item, a consumer with items queued is not disturbed. This is what
+    // Decoder::wakeup() did with insertHead(T()); SpscRing::interrupt() returns null even then.
+    void interrupt()
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_queue.empty()) {
+            m_queue.push_front(Item{T(), Cost()});
+            m_notEmpty.wakeOne();
+        }
+    }
+
+    // Same as clear(), for the SpscRing interface
+    void reset() { clear(); }
+
     [[nodiscard]] auto empty() const -> bool
     {
         QMutexLocker locker(&m_mutex);
@@ -96,7 +124,7 @@ public:
     [[nodiscard]] auto full() const -> bool
     {
         QMutexLocker locker(&m_mutex);
-        return m_queue.size() >= m_maxSize;
+        return isFull();
     }
 
     [[nodiscard]] auto size() const -> size_t
@@ -109,6 +137,7 @@ public:
     {
         QMutexLocker locker(&m_mutex);
         m_maxSize = maxSize;
+        m_notFull.wakeAll();
     }
 
     [[nodiscard]] auto maxSize() const -> size_t
@@ -117,12 +146,99 @@ public:
         return m_maxSize;
     }
 
+    // Items are weighed by the callback when they enter the queue, a budget <= 0 is unlimited.
+    // At least one item is always accepted, so a single oversized item can not stall the queue.
+    void setCostCallback(CostCallback callback)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_costCallback = std::move(callback);
+    }
+
+    void setMaxBytes(qint64 maxBytes)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxBytes = maxBytes;
+        m_notFull.wakeAll();
+    }
+
+    [[nodiscard]] auto maxBytes() const -> qint64
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_maxBytes;
+    }
+
+    void setMaxDuration(qint64 maxDuration)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxDuration = maxDuration;
+        m_notFull.wakeAll();
+    }
+
+    [[nodiscard]] auto maxDuration() const -> qint64
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_maxDuration;
+    }
+
+    [[nodiscard]] auto bytes() const -> qint64
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_bytes;
+    }
+
+    [[nodiscard]] auto duration() const -> qint64
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_duration;
+    }
+
 private:
+    struct Item
+    {
+        T value;
+        Cost cost;
+    };
+
+    [[nodiscard]] auto isFull() const -> bool
+    {
+        if (m_queue.empty()) {
+            return false;
+        }
+        if (m_queue.size() >= m_maxSize) {
+            return true;
+        }
+        if (m_maxBytes > 0 && m_bytes >= m_maxBytes) {
+            return true;
+        }
+        return m_maxDuration > 0 && m_duration >= m_maxDuration;
+    }
+
+    template<typename U>
+    void push(U &&x, bool head)
+    {
+        Cost cost;
+        if (m_costCallback) {
+            cost = m_costCallback(x);
+        }
+        m_bytes += cost.bytes;
+        m_duration += cost.duration;
+        if (head) {
+            m_queue.push_front(Item{std::forward<U>(x), cost});
+        } else {
+            m_queue.push_back(Item{std::forward<U>(x), cost});
+        }
+    }
+
     mutable QMutex m_mutex;
     QWaitCondition m_notEmpty;
     QWaitCondition m_notFull;
-    std::deque<T> m_queue;
-    int m_maxSize;
+    std::deque<Item> m_queue;
+    size_t m_maxSize;
+    qint64 m_maxBytes = 0;
+    qint64 m_maxDuration = 0;
+    qint64 m_bytes = 0;
+    qint64 m_duration = 0;
+    CostCallback m_costCallback;
 };
 
 } // namespace Utils
@@ -0,0 +1,242 @@
+#include "executor.hpp"
+
+#include <QDeadlineTimer>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <deque>
+#include <memory>
+
+namespace Utils {
+
+namespace {
+
+auto runnableJob(QRunnable *runnable) -> Executor::Job
+{
+    // Deleted after running, or with the job if it is dropped before
+    std::shared_ptr<QRunnable> holder(runnable, [](QRunnable *runnable) {
+        if (runnable->autoDelete()) {
+            delete runnable;
+        }
+    });
+    return [holder] { holder->run(); };
+}
+
+} // namespace
+
+class Executor::ExecutorPrivate
+{
+public:
+    explicit ExecutorPrivate(Executor *q)
+        : q_ptr(q)
+    {
+        auto count = qMax(1, QThread::idealThreadCount());
+        for (int i = 0; i < count; ++i) {
+            auto *thread = QThread::create([this] { runWorker(); });
+            thread->setObjectName(QString("Executor-%1").arg(i));
+            thread->start();
+            workers.append(thread);
+        }
+    }
+
+    ~ExecutorPrivate()
+    {
+        {
+            QMutexLocker locker(&mutex);
+            stopping = true;
+            waitCondition.wakeAll();
+        }
+        for (auto *thread : std::as_const(workers)) {
+            thread->wait();
+            delete thread;
+        }
+    }
+
+    void post(Job &&job, Priority priority)
+    {
+        QMutexLocker locker(&mutex);
+        switch (priority) {
+        case Priority::Background: backgroundJobs.push_back(std::move(job)); break;
+        default: jobs.push_back(std::move(job)); break;
+        }
+        waitCondition.wakeOne();
+    }
+
+    // With the mutex locked
+    auto takeJob(Job &job) -> bool
+    {
+        auto &queue = jobs.empty() ? backgroundJobs : jobs;
+        if (queue.empty()) {
+            return false;
+        }
+        job = std::move(queue.front());
+        queue.pop_front();
+        return true;
+    }
+
+    void runWorker()
+    {
+        QMutexLocker locker(&mutex);
+        while (!stopping) {
+            Job job;
+            if (!takeJob(job)) {
+                waitCondition.wait(&mutex);
+                continue;
+            }
+            locker.unlock();
+            job();
+            job = nullptr;
+            locker.relock();
+        }
+    }
+
+    Executor *q_ptr;
+
+    QList<QThread *> workers;
+
+    mutable QMutex mutex;
+    QWaitCondition waitCondition;
+    std::deque<Job> jobs;
+    std::deque<Job> backgroundJobs;
+    bool stopping = false;
+};
+
+Executor::Executor()
+    : d_ptr(new ExecutorPrivate(this))
+{}
+
+Executor::~Executor() = default;
+
+void Executor::post(Job job, Priority priority)
+{
+    d_ptr->post(std::move(job), priority);
+}
+
+void Executor::post(QRunnable *runnable, Priority priority)
+{
+    d_ptr->post(runnableJob(runnable), priority);
+}
+
+auto Executor::workerCount() const -> int
+{
+    return static_cast<int>(d_ptr->workers.size());
+}
+
+auto Executor::pendingCount() const -> qint64
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    return static_cast<qint64>(d_ptr->jobs.size() + d_ptr->backgroundJobs.size());
+}
+
+class TaskGroup::TaskGroupPrivate
+{
+public:
+    // With the mutex locked
+    void startNext(const QSharedPointer<TaskGroupPrivate> &self)
+    {
+        while (active < maxConcurrency && !jobs.empty()) {
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            active++;
+            Executor::instance()->post(
+                [self, job = std::move(job)] {
+                    job();
+                    self->finished(self);
+                },
+                priority);
+        }
+    }
+
+    void finished(const QSharedPointer<TaskGroupPrivate> &self)
+    {
+        QMutexLocker locker(&mutex);
+        active--;
+        startNext(self);
+        if (active == 0 && jobs.empty()) {
+            waitCondition.wakeAll();
+        }
+    }
+
+    Executor::Priority priority = Executor::Priority::Normal;
+    int maxConcurrency = 1;
+    int active = 0;
+    std::deque<Executor::Job> jobs;
+
+    mutable QMutex mutex;
+    QWaitCondition waitCondition;
+};
+
+TaskGroup::TaskGroup(int maxConcurrency, Executor::Priority priority)
+    : d_ptr(new TaskGroupPrivate)
+{
+    // Constructed first, so a static group is destroyed before the executor
+    Executor::instance();
+    d_ptr->maxConcurrency = qMax(1, maxConcurrency);
+    d_ptr->priority = priority;
+}
+
+TaskGroup::~TaskGroup()
+{
+    clear();
+    waitForDone();
+}
+
+void TaskGroup::start(Executor::Job job)
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->jobs.push_back(std::move(job));
+    d_ptr->startNext(d_ptr);
+}
+
+void TaskGroup::start(QRunnable *runnable)
+{
+    start(runnableJob(runnable));
+}
+
+void TaskGroup::clear()
+{
+    std::deque<Executor::Job> jobs;
+    {
+        QMutexLocker locker(&d_ptr->mutex);
+        jobs.swap(d_ptr->jobs);
+        if (d_ptr->active == 0) {
+            d_ptr->waitCondition.wakeAll();
+        }
+    }
+    // The dropped runnables are deleted outside of the lock
+}
+
+auto TaskGroup::waitForDone(int msecs) -> bool
+{
+    QDeadlineTimer deadline(msecs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever)
+                                    : QDeadlineTimer(msecs));
+    QMutexLocker locker(&d_ptr->mutex);
+    while (d_ptr->active > 0 || !d_ptr->jobs.empty()) {
+        if (!d_ptr->waitCondition.wait(&d_ptr->mutex, deadline)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TaskGroup::setMaxConcurrency(int maxConcurrency)
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    d_ptr->maxConcurrency = qMax(1, maxConcurrency);
+    d_ptr->startNext(d_ptr);
+}
+
+auto TaskGroup::maxConcurrency() const -> int
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    return d_ptr->maxConcurrency;
+}
+
+auto TaskGroup::activeCount() const -> int
+{
+    QMutexLocker locker(&d_ptr->mutex);
+    return d_ptr->active;
+}
+
+} // namespace Utils
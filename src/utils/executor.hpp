@@ -0,0 +1,70 @@
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include "singleton.hpp"
+#include "utils_global.h"
+
+#include <QRunnable>
+#include <QSharedPointer>
+
+#include <functional>
+
+namespace Utils {
+
+// Process wide executor for short jobs, one worker per core sharing a single queue.
+// Background jobs run only when nothing else is queued.
+class UTILS_EXPORT Executor
+{
+public:
+    enum class Priority { Normal, Background };
+
+    using Job = std::function<void()>;
+
+    void post(Job job, Priority priority = Priority::Normal);
+    // Takes the runnable if autoDelete() is true
+    void post(QRunnable *runnable, Priority priority = Priority::Normal);
+
+    [[nodiscard]] auto workerCount() const -> int;
+    [[nodiscard]] auto pendingCount() const -> qint64;
+
+private:
+    Executor();
+    ~Executor();
+
+    class ExecutorPrivate;
+    QScopedPointer<ExecutorPrivate> d_ptr;
+
+    SINGLETON(Executor)
+};
+
+// Jobs of one owner on the shared executor, replaces a private QThreadPool.
+// Runs at most maxConcurrency jobs at once; the destructor drops the queued jobs
+// and waits for the running ones.
+class UTILS_EXPORT TaskGroup
+{
+    Q_DISABLE_COPY_MOVE(TaskGroup)
+public:
+    explicit TaskGroup(int maxConcurrency = 1,
+                       Executor::Priority priority = Executor::Priority::Normal);
+    ~TaskGroup();
+
+    void start(Executor::Job job);
+    // Takes the runnable if autoDelete() is true
+    void start(QRunnable *runnable);
+
+    // Drops the jobs not started yet
+    void clear();
+    auto waitForDone(int msecs = -1) -> bool;
+
+    void setMaxConcurrency(int maxConcurrency);
+    [[nodiscard]] auto maxConcurrency() const -> int;
+    [[nodiscard]] auto activeCount() const -> int;
+
+private:
+    class TaskGroupPrivate;
+    QSharedPointer<TaskGroupPrivate> d_ptr;
+};
+
+} // namespace Utils
+
+#endif // EXECUTOR_HPP
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <QMutex>
+#include <QSharedPointer>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace Utils {
+
+// Recycles heap objects handed out as QSharedPointer. The deleter puts the object back
+// on whatever thread drops the last reference; recycle() resets it and may refuse it.
+// Objects still in use when the pool is destroyed are deleted normally.
+template<typename T>
+class ObjectPool
+{
+    Q_DISABLE_COPY_MOVE(ObjectPool);
+
+public:
+    using RecycleCallback = std::function<bool(T *)>;
+
+    struct Stats
+    {
+        quint64 acquired = 0;
+        quint64 reused = 0;
+
+        [[nodiscard]] auto allocated() const -> quint64 { return acquired - reused; }
+        [[nodiscard]] auto hitRate() const -> double
+        {
+            return acquired > 0 ? static_cast<double>(reused) / acquired : 0.0;
+        }
+    };
+
+    explicit ObjectPool(size_t capacity = 32, RecycleCallback recycle = nullptr)
+        : m_shared(QSharedPointer<Shared>::create())
+    {
+        m_shared->capacity = capacity;
+        m_shared->recycle = std::move(recycle);
+    }
+
+    ~ObjectPool()
+    {
+        QMutexLocker locker(&m_shared->mutex);
+        m_shared->closed = true;
+        for (auto *object : m_shared->objects) {
+            delete object;
+        }
+        m_shared->objects.clear();
+    }
+
+    auto acquire() -> QSharedPointer<T>
+    {
+        T *object = nullptr;
+        {
+            QMutexLocker locker(&m_shared->mutex);
+            if (!m_shared->objects.empty()) {
+                object = m_shared->objects.back();
+                m_shared->objects.pop_back();
+            }
+        }
+        m_shared->acquired.fetch_add(1, std::memory_order_relaxed);
+        if (object != nullptr) {
+            m_shared->reused.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            object = new T;
+        }
+        return QSharedPointer<T>(object, [shared = m_shared](T *object) {
+            release(shared, object);
+        });
+    }
+
+    // Idle objects kept at most, the ones in use are not limited
+    void setCapacity(size_t capacity)
+    {
+        QMutexLocker locker(&m_shared->mutex);
+        m_shared->capacity = capacity;
+        while (m_shared->objects.size() > capacity) {
+            delete m_shared->objects.back();
+            m_shared->objects.pop_back();
+        }
+    }
+
+    [[nodiscard]] auto capacity() const -> size_t
+    {
+        QMutexLocker locker(&m_shared->mutex);
+        return m_shared->capacity;
+    }
+
+    [[nodiscard]] auto idleCount() const -> size_t
+    {
+        QMutexLocker locker(&m_shared->mutex);
+        return m_shared->objects.size();
+    }
+
+    [[nodiscard]] auto stats() const -> Stats
+    {
+        Stats stats;
+        stats.acquired = m_shared->acquired.load(std::memory_order_relaxed);
+        stats.reused = m_shared->reused.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct Shared
+    {
+        mutable QMutex mutex;
+        std::vector<T *> objects;
+        size_t capacity = 0;
+        bool closed = false;
+        RecycleCallback recycle;
+        std::atomic<quint64> acquired = 0;
+        std::atomic<quint64> reused = 0;
+    };
+
+    static void release(const QSharedPointer<Shared> &shared, T *object)
+    {
+        // Reset outside the lock, it may free buffers
+        if (!shared->recycle || shared->recycle(object)) {
+            QMutexLocker locker(&shared->mutex);
+            if (!shared->closed && shared->objects.size() < shared->capacity) {
+                shared->objects.push_back(object);
+                return;
+            }
+        }
+        delete object;
+    }
+
+    QSharedPointer<Shared> m_shared;
+};
+
+} // namespace Utils
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace Utils {
+
+// Value that readers copy without blocking the writer, they retry if a write overlapped.
+// Writers are serialized by spinning on the odd sequence, so writes must be short.
+// The payload lives in relaxed atomic words, which keeps the torn copies a reader throws
+// away free of data races.
+template<typename T>
+class SeqLock
+{
+    Q_DISABLE_COPY_MOVE(SeqLock);
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock()
+        : SeqLock(T{})
+    {}
+
+    explicit SeqLock(const T &value) { writeWords(value); }
+
+    // Any thread, never blocks a writer
+    auto load() const -> T
+    {
+        for (;;) {
+            auto begin = m_sequence.load(std::memory_order_acquire);
+            if ((begin & 1U) != 0U) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto value = readWords();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == begin) {
+                return value;
+            }
+        }
+    }
+
+    void store(const T &value)
+    {
+        lockWrite();
+        writeWords(value);
+        unlockWrite();
+    }
+
+    // Read, modify and write as one write, returns the new value
+    template<typename Function>
+    auto update(Function &&function) -> T
+    {
+        lockWrite();
+        auto value = readWords();
+        function(value);
+        writeWords(value);
+        unlockWrite();
+        return value;
+    }
+
+    // Even when no write is in progress, grows by two per write
+    [[nodiscard]] auto sequence() const -> quint64
+    {
+        return m_sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t s_wordCount = (sizeof(T) + sizeof(quint64) - 1) / sizeof(quint64);
+
+    void lockWrite()
+    {
+        auto sequence = m_sequence.load(std::memory_order_relaxed);
+        for (;;) {
+            if ((sequence & 1U) == 0U
+                && m_sequence.compare_exchange_weak(sequence,
+                                                    sequence + 1,
+                                                    std::memory_order_acquire,
+                                                    std::memory_order_relaxed)) {
+                break;
+            }
+            std::this_thread::yield();
+            sequence = m_sequence.load(std::memory_order_relaxed);
+        }
+        // The odd sequence is visible before any word changes
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void unlockWrite() { m_sequence.fetch_add(1, std::memory_order_release); }
+
+    auto readWords() const -> T
+    {
+        std::array<quint64, s_wordCount> words;
+        for (size_t i = 0; i < s_wordCount; ++i) {
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(static_cast<void *>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+    void writeWords(const T &value)
+    {
+        std::array<quint64, s_wordCount> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        for (size_t i = 0; i < s_wordCount; ++i) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<quint64> m_sequence = 0;
+    std::array<std::atomic<quint64>, s_wordCount> m_words{};
+};
+
+} // namespace Utils
@@ -0,0 +1,408 @@
+#pragma once
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace Utils {
+
+// Ring for exactly one producer and one consumer thread. Both sides only touch their own
+// index unless the ring is empty or full, then they sleep on a condition that the other
+// side signals only if somebody is waiting. interrupt() and cancel() wake the consumer
+// instead of a null item. Has the BoundedBlockingQueue interface, so it can replace it.
+template<typename T>
+class SpscRing
+{
+    Q_DISABLE_COPY_MOVE(SpscRing);
+
+public:
+    struct Cost
+    {
+        qint64 bytes = 0;
+        qint64 duration = 0;
+    };
+
+    using CostCallback = std::function<Cost(const T &)>;
+
+    static constexpr size_t s_cacheLineSize = 64;
+    static constexpr size_t s_maxCapacity = 1 << 16;
+    // Yields before sleeping, the other side is usually just behind
+    static constexpr int s_spinCount = 16;
+
+    explicit SpscRing(int maxSize)
+    {
+        setMaxSize(maxSize);
+        allocate();
+    }
+
+    // Producer, blocks while full, false if cancelled
+    auto push(T &&x) -> bool
+    {
+        for (int spin = 0;; ++spin) {
+            if (m_cancelled.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (!isFull()) {
+                break;
+            }
+            if (spin < s_spinCount) {
+                std::this_thread::yield();
+            } else {
+                waitNotFull();
+            }
+        }
+        write(std::move(x));
+        return true;
+    }
+
+    auto push(const T &x) -> bool { return push(T(x)); }
+
+    auto tryPush(T &&x) -> bool
+    {
+        if (m_cancelled.load(std::memory_order_acquire) || isFull()) {
+            return false;
+        }
+        write(std::move(x));
+        return true;
+    }
+
+    // Consumer, blocks while empty, false if cancelled or interrupted
+    auto pop(T &x) -> bool
+    {
+        for (int spin = 0;; ++spin) {
+            if (m_cancelled.load(std::memory_order_acquire)
+                || m_interrupted.exchange(false, std::memory_order_acq_rel)) {
+                return false;
+            }
+            if (read(x)) {
+                return true;
+            }
+            if (spin < s_spinCount) {
+                std::this_thread::yield();
+            } else {
+                waitNotEmpty();
+            }
+        }
+    }
+
+    auto tryPop(T &x) -> bool
+    {
+        if (m_cancelled.load(std::memory_order_acquire)) {
+            return false;
+        }
+        return read(x);
+    }
+
+    void append(const T &x) { push(x); }
+    void append(T &&x) { push(std::move(x)); }
+
+    // Returns T() if cancelled or interrupted
+    auto take() -> T
+    {
+        T x{};
+        pop(x);
+        return x;
+    }
+
+    // Any thread, the blocked or next pop returns false once
+    void interrupt()
+    {
+        m_interrupted.store(true, std::memory_order_release);
+        QMutexLocker locker(&m_mutex);
+        m_notEmpty.wakeAll();
+    }
+
+    // Any thread, both sides fail until reset()
+    void cancel()
+    {
+        m_cancelled.store(true, std::memory_order_release);
+        QMutexLocker locker(&m_mutex);
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    [[nodiscard]] auto isCancelled() const -> bool
+    {
+        return m_cancelled.load(std::memory_order_acquire);
+    }
+
+    // Neither side may run, drops the items and grows the ring to the max size
+    void reset()
+    {
+        if (capacity() < boundedMaxSize()) {
+            allocate();
+        } else {
+            for (auto &item : m_items) {
+                item.value = T();
+            }
+        }
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_clearTo.store(0, std::memory_order_relaxed);
+        m_headCache = 0;
+        m_tailCache = 0;
+        m_pushedBytes = m_pushedDuration = 0;
+        m_poppedBytes.store(0, std::memory_order_relaxed);
+        m_poppedDuration.store(0, std::memory_order_relaxed);
+        m_interrupted.store(false, std::memory_order_relaxed);
+        m_cancelled.store(false, std::memory_order_release);
+    }
+
+    // Producer, the consumer drops the queued items on its next pop
+    void clear()
+    {
+        m_clearTo.store(m_tail.load(std::memory_order_relaxed), std::memory_order_release);
+        notifyConsumer();
+    }
+
+    [[nodiscard]] auto empty() const -> bool { return size() == 0; }
+
+    [[nodiscard]] auto full() const -> bool { return size() >= maxSize(); }
+
+    [[nodiscard]] auto size() const -> size_t
+    {
+        auto head = qMax(m_head.load(std::memory_order_acquire),
+                         m_clearTo.load(std::memory_order_acquire));
+        auto tail = m_tail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    [[nodiscard]] auto capacity() const -> size_t { return m_mask + 1; }
+
+    // Any thread, a size above the capacity takes effect on the next reset()
+    void setMaxSize(int maxSize)
+    {
+        m_maxSize.store(static_cast<size_t>(qMax(1, maxSize)), std::memory_order_relaxed);
+        wakeProducer();
+    }
+
+    [[nodiscard]] auto maxSize() const -> size_t { return m_maxSize.load(std::memory_order_relaxed); }
+
+    // Set before the producer starts
+    void setCostCallback(CostCallback callback) { m_costCallback = std::move(callback); }
+
+    void setMaxBytes(qint64 maxBytes)
+    {
+        m_maxBytes.store(maxBytes, std::memory_order_relaxed);
+        wakeProducer();
+    }
+
+    [[nodiscard]] auto maxBytes() const -> qint64 { return m_maxBytes.load(std::memory_order_relaxed); }
+
+    void setMaxDuration(qint64 maxDuration)
+    {
+        m_maxDuration.store(maxDuration, std::memory_order_relaxed);
+        wakeProducer();
+    }
+
+    [[nodiscard]] auto maxDuration() const -> qint64
+    {
+        return m_maxDuration.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto bytes() const -> qint64
+    {
+        return m_pushedBytesShared.load(std::memory_order_relaxed)
+               - m_poppedBytes.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto duration() const -> qint64
+    {
+        return m_pushedDurationShared.load(std::memory_order_relaxed)
+               - m_poppedDuration.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Item
+    {
+        T value{};
+        Cost cost;
+    };
+
+    void allocate()
+    {
+        size_t capacity = 2;
+        while (capacity < boundedMaxSize()) {
+            capacity <<= 1;
+        }
+        m_items = std::vector<Item>(capacity);
+        m_mask = capacity - 1;
+    }
+
+    [[nodiscard]] auto boundedMaxSize() const -> size_t { return qMin(maxSize(), s_maxCapacity); }
+
+    // Producer side
+    [[nodiscard]] auto isFull() -> bool
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache >= capacity() || liveCount(tail) >= maxSize()) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+        }
+        // The producer must never reach a slot the consumer still owns
+        if (tail - m_headCache >= capacity()) {
+            return true;
+        }
+        auto count = liveCount(tail);
+        // At least one item is always accepted
+        if (count == 0) {
+            return false;
+        }
+        if (count >= maxSize()) {
+            return true;
+        }
+        auto maxBytes = m_maxBytes.load(std::memory_order_relaxed);
+        if (maxBytes > 0
+            && m_pushedBytes - m_poppedBytes.load(std::memory_order_acquire) >= maxBytes) {
+            return true;
+        }
+        auto maxDuration = m_maxDuration.load(std::memory_order_relaxed);
+        return maxDuration > 0
+               && m_pushedDuration - m_poppedDuration.load(std::memory_order_acquire)
+                      >= maxDuration;
+    }
+
+    // Items not cleared yet, from the producer's view
+    [[nodiscard]] auto liveCount(size_t tail) const -> size_t
+    {
+        return tail - qMax(m_headCache, m_clearTo.load(std::memory_order_relaxed));
+    }
+
+    void write(T &&x)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto &item = m_items[tail & m_mask];
+        item.cost = m_costCallback ? m_costCallback(x) : Cost();
+        item.value = std::move(x);
+        m_pushedBytes += item.cost.bytes;
+        m_pushedDuration += item.cost.duration;
+        m_pushedBytesShared.store(m_pushedBytes, std::memory_order_relaxed);
+        m_pushedDurationShared.store(m_pushedDuration, std::memory_order_relaxed);
+        m_tail.store(tail + 1, std::memory_order_release);
+        notifyConsumer();
+    }
+
+    // Consumer side
+    auto read(T &x) -> bool
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        auto clearTo = m_clearTo.load(std::memory_order_acquire);
+        if (head < clearTo) {
+            for (; head < clearTo; ++head) {
+                release(m_items[head & m_mask]);
+            }
+            m_head.store(head, std::memory_order_release);
+            notifyProducer();
+        }
+        if (head >= m_tailCache) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head >= m_tailCache) {
+                return false;
+            }
+        }
+        auto &item = m_items[head & m_mask];
+        x = std::move(item.value);
+        release(item);
+        m_head.store(head + 1, std::memory_order_release);
+        notifyProducer();
+        return true;
+    }
+
+    void release(Item &item)
+    {
+        item.value = T();
+        m_poppedBytes.fetch_add(item.cost.bytes, std::memory_order_release);
+        m_poppedDuration.fetch_add(item.cost.duration, std::memory_order_release);
+    }
+
+    void waitNotFull()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_producerWaiting.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!m_cancelled.load(std::memory_order_acquire) && isFull()) {
+            m_notFull.wait(&m_mutex);
+        }
+        m_producerWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    void waitNotEmpty()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_consumerWaiting.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!m_cancelled.load(std::memory_order_acquire)
+               && !m_interrupted.load(std::memory_order_acquire) && !readable()) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        m_consumerWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto readable() const -> bool
+    {
+        auto head = qMax(m_head.load(std::memory_order_relaxed),
+                         m_clearTo.load(std::memory_order_acquire));
+        return head < m_tail.load(std::memory_order_acquire)
+               || m_head.load(std::memory_order_relaxed) < head;
+    }
+
+    void notifyConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerWaiting.load(std::memory_order_relaxed)) {
+            QMutexLocker locker(&m_mutex);
+            m_notEmpty.wakeOne();
+        }
+    }
+
+    void notifyProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producerWaiting.load(std::memory_order_relaxed)) {
+            QMutexLocker locker(&m_mutex);
+            m_notFull.wakeOne();
+        }
+    }
+
+    void wakeProducer()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_notFull.wakeAll();
+    }
+
+    std::vector<Item> m_items;
+    size_t m_mask = 0;
+    CostCallback m_costCallback;
+
+    // Consumer
+    alignas(s_cacheLineSize) std::atomic<size_t> m_head = 0;
+    size_t m_tailCache = 0;
+    std::atomic<qint64> m_poppedBytes = 0;
+    std::atomic<qint64> m_poppedDuration = 0;
+
+    // Producer
+    alignas(s_cacheLineSize) std::atomic<size_t> m_tail = 0;
+    size_t m_headCache = 0;
+    qint64 m_pushedBytes = 0;
+    qint64 m_pushedDuration = 0;
+    std::atomic<qint64> m_pushedBytesShared = 0;
+    std::atomic<qint64> m_pushedDurationShared = 0;
+    std::atomic<size_t> m_clearTo = 0;
+
+    alignas(s_cacheLineSize) std::atomic<size_t> m_maxSize = 1;
+    std::atomic<qint64> m_maxBytes = 0;
+    std::atomic<qint64> m_maxDuration = 0;
+    std::atomic_bool m_interrupted = false;
+    std::atomic_bool m_cancelled = false;
+    std::atomic_bool m_producerWaiting = false;
+    std::atomic_bool m_consumerWaiting = false;
+
+    alignas(s_cacheLineSize) QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+};
+
+} // namespace Utils
@@ -439,6 +439,13 @@ auto Utils::logPath() -> QString
     return path;
 }
 
+auto Utils::cachePath() -> QString
+{
+    const auto path = configLocation() + "/cache";
+    generateDirectorys(path);
+    return path;
+}
+
 auto Utils::configPath() -> QString
 {
     const auto path = configLocation() + "/config";
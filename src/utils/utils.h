@@ -21,6 +21,7 @@ UTILS_EXPORT auto configPath() -> QString;
 UTILS_EXPORT auto configFilePath() -> QString;
 UTILS_EXPORT auto crashPath() -> QString;
 UTILS_EXPORT auto logPath() -> QString;
+UTILS_EXPORT auto cachePath() -> QString;
 
 UTILS_EXPORT auto systemInfo() -> QString;
 UTILS_EXPORT void setHighDpiEnvironmentVariable();
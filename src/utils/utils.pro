@@ -7,6 +7,7 @@ TARGET = $$replaceLibName(utils)
 
 SOURCES += \
     countdownlatch.cc \
+    executor.cc \
     fps.cc \
     hostosinfo.cpp \
     logasync.cpp \
@@ -16,13 +17,17 @@ SOURCES += \
 HEADERS += \
     boundedblockingqueue.hpp \
     countdownlatch.hpp \
+    executor.hpp \
     fps.hpp \
     hostosinfo.h \
     logasync.h \
+    objectpool.hpp \
     osspecificaspects.h \
     range.hpp \
+    seqlock.hpp \
     singleton.hpp \
     speed.hpp \
+    spscring.hpp \
     threadsafequeue.hpp \
     utils_global.h \
     utils.h
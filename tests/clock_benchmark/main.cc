@@ -0,0 +1,197 @@
+// Contention on the playback clocks, four threads as in a playing player: the audio
+// master, video and subtitle decoders update their clocks while the player reads them.
+// clock_benchmark [milliseconds]
+
+#include <ffmpeg/clock.hpp>
+#include <utils/seqlock.hpp>
+
+#include <QMutex>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Fields a reader must see from one write, like pts, drift and last update of a clock
+struct Sample
+{
+    qint64 pts = 0;
+    qint64 drift = 0;
+    qint64 time = 0;
+    qint64 serial = 0;
+};
+
+auto isConsistent(const Sample &sample) -> bool
+{
+    return sample.drift == -sample.pts && sample.time == sample.pts * 3
+           && sample.serial == sample.pts / 1000;
+}
+
+auto makeSample(qint64 value) -> Sample
+{
+    return {value, -value, value * 3, value / 1000};
+}
+
+// The previous clock, every access under one mutex
+class MutexSnapshot
+{
+public:
+    auto load() const -> Sample
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_sample;
+    }
+
+    void store(const Sample &sample)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_sample = sample;
+    }
+
+private:
+    mutable QMutex m_mutex;
+    Sample m_sample;
+};
+
+// Keeps the reads of the player thread from being optimized away
+std::atomic<qint64> s_sink = 0;
+
+struct Result
+{
+    std::vector<qint64> ops;
+    qint64 torn = 0;
+};
+
+auto now() -> qint64
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+template<typename Snapshot>
+auto snapshotBenchmark(int milliseconds) -> Result
+{
+    Snapshot snapshot;
+    std::atomic_bool running = true;
+    Result result;
+    result.ops.resize(4);
+    std::atomic<qint64> torn = 0;
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] {
+        qint64 value = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            snapshot.store(makeSample(++value));
+        }
+        result.ops[0] = value;
+    });
+    for (int i = 1; i < 4; ++i) {
+        threads.emplace_back([&, i] {
+            qint64 count = 0;
+            qint64 bad = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                bad += isConsistent(snapshot.load()) ? 0 : 1;
+                ++count;
+            }
+            result.ops[i] = count;
+            torn.fetch_add(bad);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    running.store(false);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    result.torn = torn.load();
+    return result;
+}
+
+auto clockBenchmark(int milliseconds) -> Result
+{
+    Ffmpeg::ClockDomain domain;
+    Ffmpeg::Clock audioClock;
+    Ffmpeg::Clock videoClock;
+    Ffmpeg::Clock subtitleClock;
+    for (auto *clock : {&audioClock, &videoClock, &subtitleClock}) {
+        clock->setDomain(&domain);
+        clock->reset(0);
+    }
+    domain.setMaster(&audioClock);
+
+    std::atomic_bool running = true;
+    Result result;
+    result.ops.resize(4);
+    auto start = now();
+
+    // Each decoder shows a frame at its pts and, except the master, syncs to the master
+    auto decoder = [&](Ffmpeg::Clock *clock, int index, bool adjust) {
+        qint64 count = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            auto time = now();
+            clock->update(time - start, time);
+            qint64 delay = 0;
+            if (clock != domain.master() && clock->getDelayWithMaster(delay) && adjust) {
+                clock->adjustDelay(delay);
+            }
+            ++count;
+        }
+        result.ops[index] = count;
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] { decoder(&audioClock, 0, false); });
+    threads.emplace_back([&] { decoder(&videoClock, 1, true); });
+    threads.emplace_back([&] { decoder(&subtitleClock, 2, false); });
+    threads.emplace_back([&] {
+        qint64 count = 0;
+        qint64 sum = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            if (audioClock.isVaild()) {
+                sum += audioClock.pts() + videoClock.ptsDrift();
+            }
+            ++count;
+        }
+        result.ops[3] = count;
+        s_sink.fetch_add(sum, std::memory_order_relaxed);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    running.store(false);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return result;
+}
+
+auto print(const char *name, const Result &result, int milliseconds) -> bool
+{
+    auto seconds = milliseconds / 1000.0;
+    std::printf("%-14s", name);
+    for (auto ops : result.ops) {
+        std::printf("  %8.2f M/s", ops / seconds / 1e6);
+    }
+    auto ok = result.torn == 0;
+    std::printf("  %lld torn  %s\n", static_cast<long long>(result.torn), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    int milliseconds = 1000;
+    if (argc > 1) {
+        milliseconds = std::max(1, std::atoi(argv[1]));
+    }
+    std::printf("%d ms per run, operations per thread\n", milliseconds);
+
+    bool ok = true;
+    std::printf("%-14s  %12s  %12s  %12s  %12s\n", "", "writer", "reader", "reader", "reader");
+    ok &= print("QMutex", snapshotBenchmark<MutexSnapshot>(milliseconds), milliseconds);
+    ok &= print("SeqLock", snapshotBenchmark<Utils::SeqLock<Sample>>(milliseconds), milliseconds);
+
+    std::printf("%-14s  %12s  %12s  %12s  %12s\n", "", "audio", "video", "subtitle", "player");
+    ok &= print("Clock", clockBenchmark(milliseconds), milliseconds);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
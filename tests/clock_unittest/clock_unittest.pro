@@ -0,0 +1,22 @@
+include(../../common.pri)
+
+QT       += core testlib
+QT       -= gui
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+TARGET = clock_unittest
+
+LIBS += -L$$APP_OUTPUT_PATH/../libs \
+    -l$$replaceLibName(ffmpeg) \
+    -l$$replaceLibName(utils)
+
+include(../../src/3rdparty/3rdparty.pri)
+
+SOURCES += \
+    main.cc
+
+DESTDIR = $$APP_OUTPUT_PATH
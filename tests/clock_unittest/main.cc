@@ -0,0 +1,281 @@
+// Correctness of Ffmpeg::Clock, the drift against the master, the seek and media serials,
+// and the snapshots read while the decoders update their clocks from other threads.
+
+#include <ffmpeg/clock.hpp>
+#include <utils/seqlock.hpp>
+
+#include <QTest>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Fields a reader must see from one write, like pts, drift and last update of a clock
+struct Sample
+{
+    qint64 pts = 0;
+    qint64 drift = 0;
+    qint64 time = 0;
+    qint64 serial = 0;
+};
+
+static auto isConsistent(const Sample &sample) -> bool
+{
+    return sample.drift == -sample.pts && sample.time == sample.pts * 3
+           && sample.serial == sample.pts / 1000;
+}
+
+class ClockTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init()
+    {
+        m_domain.reset(new Ffmpeg::ClockDomain);
+        m_master.reset(new Ffmpeg::Clock);
+        m_slave.reset(new Ffmpeg::Clock);
+        m_master->setDomain(m_domain.get());
+        m_slave->setDomain(m_domain.get());
+        m_domain->setMaster(m_master.get());
+    }
+
+    void seqLockSnapshot()
+    {
+        Utils::SeqLock<Sample> snapshot;
+        std::atomic_bool running = true;
+        std::atomic<qint64> torn = 0;
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; ++i) {
+            readers.emplace_back([&] {
+                qint64 bad = 0;
+                while (running.load(std::memory_order_relaxed)) {
+                    bad += isConsistent(snapshot.load()) ? 0 : 1;
+                }
+                torn.fetch_add(bad);
+            });
+        }
+        for (qint64 value = 1; value <= 200000; ++value) {
+            if (value % 2 == 0) {
+                snapshot.store({value, -value, value * 3, value / 1000});
+            } else {
+                snapshot.update([value](Sample &sample) {
+                    sample = {value, -value, value * 3, value / 1000};
+                });
+            }
+        }
+        running.store(false);
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        QCOMPARE(torn.load(), qint64(0));
+        QCOMPARE(snapshot.load().pts, qint64(200000));
+        QCOMPARE(snapshot.sequence(), quint64(400000));
+    }
+
+    void resetTakesDomainSerial()
+    {
+        m_domain->serialRef();
+        m_domain->mediaSerialRef();
+        QCOMPARE(m_slave->serial(), qint64(0));
+        m_slave->reset(1000);
+        QCOMPARE(m_slave->serial(), qint64(2));
+        QCOMPARE(m_slave->pts(), qint64(1000));
+        QCOMPARE(m_slave->ptsDrift(), qint64(0));
+        QVERIFY(m_slave->isVaild());
+        QVERIFY(!m_slave->paused());
+
+        m_domain->serialRef();
+        m_slave->resetSerial();
+        QCOMPARE(m_slave->serial(), qint64(3));
+        QCOMPARE(m_slave->pts(), qint64(1000));
+    }
+
+    void seekMakesStale()
+    {
+        m_slave->reset(0);
+        qint64 delay = -1;
+        QVERIFY(m_slave->getDelayWithMaster(delay));
+        QCOMPARE(delay, qint64(0));
+
+        m_domain->serialRef();
+        QVERIFY(m_domain->isStale(m_slave->serial()));
+        QVERIFY(!m_slave->getDelayWithMaster(delay));
+
+        m_slave->reset(0);
+        QVERIFY(!m_domain->isStale(m_slave->serial()));
+        QVERIFY(m_slave->getDelayWithMaster(delay));
+    }
+
+    void mediaSerialKeepsValid()
+    {
+        m_slave->reset(0);
+        m_domain->mediaSerialRef();
+        QCOMPARE(m_domain->serial(), qint64(1));
+        // The previous media plays out before the decoders switch
+        QVERIFY(!m_domain->isStale(m_slave->serial()));
+        qint64 delay = -1;
+        QVERIFY(m_slave->getDelayWithMaster(delay));
+
+        m_domain->serialRef();
+        QVERIFY(m_domain->isStale(0));
+        QVERIFY(m_domain->isStale(1));
+        QVERIFY(!m_domain->isStale(2));
+
+        m_domain->serialReset();
+        QCOMPARE(m_domain->serial(), qint64(0));
+        QVERIFY(!m_domain->isStale(0));
+    }
+
+    void driftAgainstMaster()
+    {
+        m_master->update(1000, 100);
+        m_slave->update(2000, 100);
+        // The first update only sets the clocks
+        QCOMPARE(m_master->ptsDrift(), qint64(0));
+        QCOMPARE(m_slave->ptsDrift(), qint64(0));
+
+        m_master->update(1500, 600);
+        QCOMPARE(m_master->ptsDrift(), qint64(0));
+        m_slave->update(2600, 700);
+        // 2600 - 1500 - (700 - 600)
+        QCOMPARE(m_slave->ptsDrift(), qint64(1000));
+        qint64 delay = 0;
+        QVERIFY(m_slave->getDelayWithMaster(delay));
+        QCOMPARE(delay, qint64(1000));
+
+        m_domain->setSpeed(2.0);
+        m_slave->update(2700, 700);
+        // 2700 - 1500 - (700 - 600) * 2
+        QCOMPARE(m_slave->ptsDrift(), qint64(1000));
+    }
+
+    void masterDrift()
+    {
+        m_master->update(1000, 100);
+        m_master->update(1400, 600);
+        // 1400 - 1000 - (600 - 100)
+        QCOMPARE(m_master->ptsDrift(), qint64(-100));
+        m_master->update(1900, 1000);
+        QCOMPARE(m_master->ptsDrift(), qint64(0));
+    }
+
+    void freeWheelOnMasterSerial()
+    {
+        m_master->update(1000, 100);
+        m_slave->update(2000, 100);
+        // The slave already plays the next media, the master the previous one
+        m_domain->mediaSerialRef();
+        m_slave->resetSerial();
+        m_slave->update(2300, 300);
+        // 2300 - 2000 - (300 - 100)
+        QCOMPARE(m_slave->ptsDrift(), qint64(100));
+        m_slave->update(2500, 400);
+        QCOMPARE(m_slave->ptsDrift(), qint64(200));
+
+        m_master->resetSerial();
+        m_slave->update(2600, 500);
+        // 2600 - 1000 - (500 - 100)
+        QCOMPARE(m_slave->ptsDrift(), qint64(1200));
+    }
+
+    void freeWheelOnInvalidMaster()
+    {
+        m_master->update(1000, 100);
+        m_slave->update(2000, 100);
+        m_master->invalidate();
+        QVERIFY(!m_master->isVaild());
+        m_slave->update(2300, 300);
+        QCOMPARE(m_slave->ptsDrift(), qint64(100));
+    }
+
+    void pausedClockKeepsDrift()
+    {
+        m_master->update(1000, 100);
+        m_master->update(1400, 600);
+        m_master->setPaused(true);
+        m_master->update(5000, 700);
+        QCOMPARE(m_master->ptsDrift(), qint64(-100));
+        QCOMPARE(m_master->pts(), qint64(5000));
+
+        m_master->setPaused(false);
+        QVERIFY(!m_master->isVaild());
+        QCOMPARE(m_master->ptsDrift(), qint64(0));
+    }
+
+    void lateResetKeepsSerial()
+    {
+        m_domain->mediaSerialRef();
+        m_slave->reset(1000);
+        m_slave->setPaused(true);
+        qint64 delay = -200 * 1000;
+        // The slave drops the frame, the master plays it at once
+        QVERIFY(!m_slave->adjustDelay(delay));
+        QCOMPARE(m_slave->serial(), qint64(1));
+        QCOMPARE(m_slave->ptsDrift(), qint64(0));
+        QCOMPARE(m_slave->pts(), qint64(1000));
+        QVERIFY(!m_slave->paused());
+
+        delay = -200 * 1000;
+        QVERIFY(m_master->adjustDelay(delay));
+        QCOMPARE(delay, qint64(0));
+
+        delay = 50 * 1000;
+        QVERIFY(m_slave->adjustDelay(delay));
+        QCOMPARE(delay, qint64(0));
+        delay = 150 * 1000;
+        QVERIFY(m_slave->adjustDelay(delay));
+        QCOMPARE(delay, qint64(50 * 1000));
+    }
+
+    void concurrentUpdate()
+    {
+        // The master keeps no drift, so the drift of the slave only depends on its own pts
+        // and is wrong if the master is read from two different updates
+        static constexpr qint64 s_offset = 5000;
+        m_master->update(1, 1);
+        m_slave->update(1 + s_offset, 1);
+        m_slave->update(2 + s_offset, 2);
+        QCOMPARE(m_slave->ptsDrift(), s_offset);
+
+        std::atomic_bool running = true;
+        std::atomic<qint64> wrong = 0;
+        std::vector<std::thread> threads;
+        threads.emplace_back([&] {
+            for (qint64 time = 2; running.load(std::memory_order_relaxed); ++time) {
+                m_master->update(time, time);
+            }
+        });
+        for (int i = 0; i < 2; ++i) {
+            threads.emplace_back([&] {
+                qint64 bad = 0;
+                while (running.load(std::memory_order_relaxed)) {
+                    qint64 delay = 0;
+                    if (!m_slave->getDelayWithMaster(delay) || delay != s_offset) {
+                        ++bad;
+                    }
+                    bad += m_master->ptsDrift() == 0 ? 0 : 1;
+                }
+                wrong.fetch_add(bad);
+            });
+        }
+        for (qint64 time = 3; time < 200000; ++time) {
+            m_slave->update(time + s_offset, time);
+        }
+        running.store(false);
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        QCOMPARE(wrong.load(), qint64(0));
+        QCOMPARE(m_slave->ptsDrift(), s_offset);
+        QCOMPARE(m_slave->lastUpdated(), qint64(199999));
+    }
+
+private:
+    QScopedPointer<Ffmpeg::ClockDomain> m_domain;
+    QScopedPointer<Ffmpeg::Clock> m_master;
+    QScopedPointer<Ffmpeg::Clock> m_slave;
+};
+
+QTEST_GUILESS_MAIN(ClockTest)
+
+#include "main.moc"
@@ -0,0 +1,59 @@
+// Throughput of the decoder queues, one producer and one consumer thread.
+// queue_benchmark [items]
+
+#include <utils/boundedblockingqueue.hpp>
+#include <utils/spscring.hpp>
+
+#include <QSharedPointer>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using Item = QSharedPointer<qint64>;
+
+template<typename Queue>
+auto benchmark(const char *name, int size, qint64 count) -> bool
+{
+    Queue queue(size);
+    qint64 sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        for (qint64 i = 0; i < count; ++i) {
+            auto item = queue.take();
+            sum += *item;
+        }
+    });
+    for (qint64 i = 0; i < count; ++i) {
+        queue.append(Item::create(i));
+    }
+    consumer.join();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto ok = sum == count * (count - 1) / 2;
+    std::printf("%-22s size %5d  %8.2f M items/s  %7.1f ns/item  %s\n",
+                name,
+                size,
+                count / elapsed / 1e6,
+                elapsed * 1e9 / count,
+                ok ? "ok" : "FAILED");
+    return ok;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    qint64 count = 5 * 1000 * 1000;
+    if (argc > 1) {
+        count = std::max(1LL, std::atoll(argv[1]));
+    }
+    std::printf("%lld items\n", static_cast<long long>(count));
+
+    bool ok = true;
+    for (int size : {10, 200, 4096}) {
+        ok &= benchmark<Utils::BoundedBlockingQueue<Item>>("BoundedBlockingQueue", size, count);
+        ok &= benchmark<Utils::SpscRing<Item>>("SpscRing", size, count);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,16 @@
+include(../../common.pri)
+
+QT       += core
+QT       -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+TARGET = queue_benchmark
+
+SOURCES += \
+    main.cc
+
+DESTDIR = $$APP_OUTPUT_PATH
@@ -0,0 +1,224 @@
+// Correctness of Utils::SpscRing, single threaded for the index and budget bookkeeping and
+// with one producer and one consumer thread for the blocking paths.
+
+#include <utils/spscring.hpp>
+
+#include <QSharedPointer>
+#include <QTest>
+
+#include <thread>
+
+using Item = QSharedPointer<qint64>;
+using Ring = Utils::SpscRing<Item>;
+
+static auto makeItem(qint64 value) -> Item
+{
+    return Item::create(value);
+}
+
+class SpscRingTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void wraparound()
+    {
+        Ring ring(4);
+        QCOMPARE(ring.capacity(), size_t(4));
+        qint64 next = 0;
+        for (int round = 0; round < 100; ++round) {
+            for (int i = 0; i < 3; ++i) {
+                QVERIFY(ring.tryPush(makeItem(round * 3 + i)));
+            }
+            QCOMPARE(ring.size(), size_t(3));
+            for (int i = 0; i < 3; ++i) {
+                Item item;
+                QVERIFY(ring.tryPop(item));
+                QCOMPARE(*item, next++);
+            }
+            QVERIFY(ring.empty());
+        }
+    }
+
+    void fullAtMaxSize()
+    {
+        Ring ring(3);
+        QCOMPARE(ring.capacity(), size_t(4));
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(ring.tryPush(makeItem(i)));
+        }
+        QVERIFY(ring.full());
+        QVERIFY(!ring.tryPush(makeItem(3)));
+
+        Item item;
+        QVERIFY(ring.tryPop(item));
+        QCOMPARE(*item, qint64(0));
+        QVERIFY(ring.tryPush(makeItem(3)));
+        QVERIFY(!ring.tryPush(makeItem(4)));
+    }
+
+    void clear()
+    {
+        Ring ring(8);
+        ring.setCostCallback([](const Item &item) { return Ring::Cost{*item, 1}; });
+        for (int i = 1; i <= 5; ++i) {
+            QVERIFY(ring.tryPush(makeItem(i)));
+        }
+        ring.clear();
+        QVERIFY(ring.empty());
+
+        QVERIFY(ring.tryPush(makeItem(10)));
+        QCOMPARE(ring.size(), size_t(1));
+        Item item;
+        QVERIFY(ring.tryPop(item));
+        QCOMPARE(*item, qint64(10));
+        QVERIFY(!ring.tryPop(item));
+        // The consumer released the cleared items with its read
+        QCOMPARE(ring.bytes(), qint64(0));
+        QCOMPARE(ring.duration(), qint64(0));
+    }
+
+    void clearWraparound()
+    {
+        Ring ring(4);
+        for (int round = 0; round < 50; ++round) {
+            QVERIFY(ring.tryPush(makeItem(round)));
+            QVERIFY(ring.tryPush(makeItem(round)));
+            ring.clear();
+            QVERIFY(ring.tryPush(makeItem(-round)));
+            Item item;
+            QVERIFY(ring.tryPop(item));
+            QCOMPARE(*item, qint64(-round));
+            QVERIFY(ring.empty());
+        }
+    }
+
+    void interrupt()
+    {
+        Ring ring(4);
+        ring.interrupt();
+        QVERIFY(ring.take().isNull());
+
+        // Only once, and a queued item is kept for the next take
+        QVERIFY(ring.tryPush(makeItem(1)));
+        ring.interrupt();
+        QVERIFY(ring.take().isNull());
+        auto item = ring.take();
+        QVERIFY(!item.isNull());
+        QCOMPARE(*item, qint64(1));
+    }
+
+    void interruptBlockedConsumer()
+    {
+        Ring ring(4);
+        Item item = makeItem(0);
+        std::thread consumer([&] { item = ring.take(); });
+        QTest::qWait(50);
+        ring.interrupt();
+        consumer.join();
+        QVERIFY(item.isNull());
+    }
+
+    void cancelAndReset()
+    {
+        Ring ring(4);
+        QVERIFY(ring.tryPush(makeItem(1)));
+        ring.cancel();
+        QVERIFY(ring.isCancelled());
+        QVERIFY(!ring.push(makeItem(2)));
+        Item item;
+        QVERIFY(!ring.pop(item));
+
+        ring.reset();
+        QVERIFY(!ring.isCancelled());
+        QVERIFY(ring.empty());
+        QVERIFY(ring.push(makeItem(3)));
+        QVERIFY(ring.pop(item));
+        QCOMPARE(*item, qint64(3));
+    }
+
+    void resetGrowsCapacity()
+    {
+        Ring ring(4);
+        ring.setMaxSize(100);
+        QCOMPARE(ring.capacity(), size_t(4));
+        ring.reset();
+        QCOMPARE(ring.capacity(), size_t(128));
+        for (int i = 0; i < 100; ++i) {
+            QVERIFY(ring.tryPush(makeItem(i)));
+        }
+        QVERIFY(!ring.tryPush(makeItem(100)));
+    }
+
+    void costBudget()
+    {
+        Ring ring(100);
+        ring.setCostCallback([](const Item &item) { return Ring::Cost{*item, *item * 10}; });
+        ring.setMaxBytes(10);
+
+        QVERIFY(ring.tryPush(makeItem(6)));
+        QVERIFY(ring.tryPush(makeItem(6)));
+        QCOMPARE(ring.bytes(), qint64(12));
+        QCOMPARE(ring.duration(), qint64(120));
+        QVERIFY(!ring.tryPush(makeItem(1)));
+
+        Item item;
+        QVERIFY(ring.tryPop(item));
+        QCOMPARE(ring.bytes(), qint64(6));
+        QCOMPARE(ring.duration(), qint64(60));
+        QVERIFY(ring.tryPush(makeItem(1)));
+
+        ring.setMaxBytes(0);
+        ring.setMaxDuration(100);
+        QCOMPARE(ring.duration(), qint64(70));
+        QVERIFY(ring.tryPush(makeItem(3)));
+        QVERIFY(!ring.tryPush(makeItem(1)));
+
+        while (ring.tryPop(item)) {}
+        QCOMPARE(ring.bytes(), qint64(0));
+        QCOMPARE(ring.duration(), qint64(0));
+    }
+
+    void oversizedItemAccepted()
+    {
+        Ring ring(4);
+        ring.setCostCallback([](const Item &item) { return Ring::Cost{*item, 0}; });
+        ring.setMaxBytes(1);
+        // At least one item is always accepted
+        QVERIFY(ring.tryPush(makeItem(1000)));
+        QVERIFY(!ring.tryPush(makeItem(1)));
+    }
+
+    void producerConsumer()
+    {
+        constexpr qint64 count = 200000;
+        Ring ring(8);
+        ring.setCostCallback([](const Item &) { return Ring::Cost{1, 1}; });
+        ring.setMaxBytes(6);
+
+        std::thread producer([&] {
+            for (qint64 i = 0; i < count; ++i) {
+                ring.push(makeItem(i));
+            }
+        });
+        bool ordered = true;
+        for (qint64 i = 0; i < count; ++i) {
+            auto item = ring.take();
+            if (item.isNull() || *item != i) {
+                ordered = false;
+                break;
+            }
+        }
+        if (!ordered) {
+            ring.cancel();
+        }
+        producer.join();
+        QVERIFY(ordered);
+        QVERIFY(ring.empty());
+        QCOMPARE(ring.bytes(), qint64(0));
+        QCOMPARE(ring.duration(), qint64(0));
+    }
+};
+
+QTEST_GUILESS_MAIN(SpscRingTest)
+
+#include "main.moc"
@@ -0,0 +1,16 @@
+include(../../common.pri)
+
+QT       += core testlib
+QT       -= gui
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+TARGET = spscring_unittest
+
+SOURCES += \
+    main.cc
+
+DESTDIR = $$APP_OUTPUT_PATH
@@ -2,4 +2,8 @@ TEMPLATE = subdirs
 CONFIG += ordered
 
 SUBDIRS += \
-    subtitle_unittest
+    subtitle_unittest \
+    queue_benchmark \
+    spscring_unittest \
+    clock_benchmark \
+    clock_unittest